@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "lib/CpuProfiler.h"
+#include "lib/FrameBench.h"
+#include "lib/FrameCapture.h"
+#include "lib/MicroBench.h"
+#include "lib/TaskQueue.h"
+#include "lib/TaskQueueProbe.h"
+#include "MicroBenchSuite.h"
+
+// headless benchmarks of the app's CPU paths; they need no window, D3D12 device or FBX SDK,
+// so this builds anywhere CMake does (see CMakeLists.txt), next to the app's d3d12test.sln
+
+// the app's scene and worker count (main.cpp)
+const int cModelGridSize = 1;
+const int cThreadCount = 3;
+
+// what one CPU_PROFILE_SCOPE should cost, timestamps included
+const double cProfilerZoneBudgetNanoseconds = 20.0;
+
+// d3d12bench --frame-bench [frameCount] [--replay capture]
+// runs the frame loop headless on the null graphics backend and prints per-stage timings;
+// with a capture (d3d12test --capture) its frames drive the scene instead of the built-in animation
+// fails if the recorded command stream changes between frames
+int RunFrameBench(int frameCount, const char* replayPath)
+{
+	auto desc = FrameBench::DefaultDesc(cModelGridSize, cThreadCount);
+	if (frameCount > 0)
+	{
+		desc.FrameCount = frameCount;
+	}
+
+	FrameCaptureReader replay;
+	if (replayPath != nullptr)
+	{
+		if (!replay.Open(replayPath))
+		{
+			printf("[replay] cannot read %s\n", replayPath);
+			return 1;
+		}
+		if (replay.TransformCount() > 0)
+		{
+			desc.MeshCountPerModel = std::max(1, replay.AnimationFrameCount() / replay.TransformCount());
+		}
+	}
+
+	FrameBench bench;
+	bench.Setup(desc);
+	if (replay.IsOpen() && !bench.SetReplay(&replay))
+	{
+		printf("[replay] the capture was taken from a different scene\n");
+		return 1;
+	}
+	const auto isDeterministic = bench.Run();
+
+	bench.Dump();
+	CpuProfiler::Instance().Dump();
+	return isDeterministic ? 0 : 1;
+}
+
+// d3d12bench --micro-bench [out.json] [--filter name] [--min-ms milliseconds]
+// runs the hot-path microbenchmarks (MicroBenchSuite.h) and optionally writes the results as Google Benchmark JSON
+int RunMicroBench(const char* jsonPath, const char* filter, double minMilliseconds)
+{
+	auto desc = MicroBenchRunner::DefaultDesc();
+	if (filter != nullptr)
+	{
+		desc.Filter = filter;
+	}
+	if (minMilliseconds > 0.0)
+	{
+		desc.MinMilliseconds = minMilliseconds;
+	}
+
+	MicroBenchRunner runner(desc);
+	AddMicroBenchmarks(&runner, cThreadCount);
+	runner.Run();
+
+	if (jsonPath != nullptr && !runner.WriteJson(jsonPath))
+	{
+		printf("cannot write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
+
+// d3d12bench --task-latency
+// prints enqueue-to-start latency for each idle policy and exits
+void RunTaskLatencyProbe()
+{
+	const int policies[][2] = { { 0, 0 }, { 0, 16 }, { 2000, 0 }, { 2000, 16 } };
+
+	for (const auto mode : { TaskQueue::Mode::SharedQueue, TaskQueue::Mode::WorkStealing, TaskQueue::Mode::LockFree })
+	{
+		for (const auto& policy : policies)
+		{
+			auto desc = TaskQueue::DefaultDesc(cThreadCount, mode);
+			desc.IdleSpinCount = policy[0];
+			desc.IdleYieldCount = policy[1];
+
+			TaskQueue queue;
+			queue.Setup(desc);
+
+			const auto report = MeasureTaskStartLatency(&queue, 2000, 8, 1000);
+			printf(
+				"%s spin: %4d, yield: %2d, p50: %7.2f us, p99: %7.2f us, p999: %7.2f us, max: %7.2f us\n",
+				TaskQueueModeName(mode), policy[0], policy[1], report.P50, report.P99, report.P999, report.Max);
+		}
+	}
+}
+
+// d3d12bench --task-jitter
+// prints the enqueue-to-start latency spread with workers unpinned, pinned, and pinned with the main thread's
+// core reserved, then exits; the reserved runs go last because they leave this thread pinned to core 0
+void RunTaskJitterProbe()
+{
+	struct Policy
+	{
+		const char* Name;
+		bool PinWorkers;
+		bool ReserveMainThreadCore;
+	};
+	const Policy policies[] =
+	{
+		{ "unpinned", false, false },
+		{ "pinned  ", true, false },
+		{ "reserved", true, true },
+	};
+
+	for (const auto& policy : policies)
+	{
+		for (const auto mode : { TaskQueue::Mode::SharedQueue, TaskQueue::Mode::WorkStealing, TaskQueue::Mode::LockFree })
+		{
+			auto desc = TaskQueue::DefaultDesc(cThreadCount, mode);
+			desc.PinWorkers = policy.PinWorkers;
+			desc.ReserveMainThreadCore = policy.ReserveMainThreadCore;
+
+			TaskQueue queue;
+			queue.Setup(desc);
+
+			const auto report = MeasureTaskStartLatency(&queue, 2000, 8, 1000);
+			printf(
+				"%s %s p50: %7.2f us, p99: %7.2f us, p999: %7.2f us, max: %7.2f us, jitter (p99 - p50): %7.2f us\n",
+				TaskQueueModeName(mode), policy.Name, report.P50, report.P99, report.P999, report.Max, report.P99 - report.P50);
+		}
+	}
+}
+
+// d3d12bench --task-throughput
+// prints tasks per second for 1/2/4/8 producer threads against cThreadCount workers and exits
+void RunTaskThroughputProbe()
+{
+	for (const auto mode : { TaskQueue::Mode::SharedQueue, TaskQueue::Mode::WorkStealing, TaskQueue::Mode::LockFree })
+	{
+		for (const auto producerCount : { 1, 2, 4, 8 })
+		{
+			TaskQueue queue;
+			queue.Setup(cThreadCount, mode);
+
+			const auto tasksPerSecond = MeasureTaskThroughput(&queue, producerCount, 100000 / producerCount);
+			printf(
+				"%s producers: %d, consumers: %d, %10.0f tasks/s\n",
+				TaskQueueModeName(mode), producerCount, cThreadCount, tasksPerSecond);
+		}
+	}
+}
+
+// d3d12bench --profiler-overhead
+// prints the cost of one empty CPU_PROFILE_SCOPE against the ~20 ns budget, split into its two timestamp reads
+// and the profiler's own bookkeeping, and exits
+void RunProfilerOverheadProbe()
+{
+	const auto iterationCount = 1000000;
+	auto& profiler = CpuProfiler::Instance();
+
+	for (auto i = 0; i < 3; ++i)
+	{
+		const auto begin = CpuProfiler::Ticks();
+		for (auto j = 0; j < iterationCount; ++j)
+		{
+			CPU_PROFILE_SCOPE("empty");
+		}
+		const auto end = CpuProfiler::Ticks();
+
+		// keep the event rings drained like a frame loop would
+		profiler.EndFrame();
+		profiler.Reset();
+
+		long long sum = 0;
+		const auto ticksBegin = CpuProfiler::Ticks();
+		for (auto j = 0; j < iterationCount; ++j)
+		{
+			sum += CpuProfiler::Ticks();
+		}
+		const auto ticksEnd = CpuProfiler::Ticks();
+		MicroBenchDoNotOptimize(sum);
+
+		const auto zone = CpuProfiler::TicksToMilliseconds(end - begin) * 1000000.0 / iterationCount;
+		const auto timestamp = CpuProfiler::TicksToMilliseconds(ticksEnd - ticksBegin) * 1000000.0 / iterationCount;
+		printf(
+			"zone: %.1f ns, budget: %.1f ns (timestamp: 2 x %.1f ns, bookkeeping: %.1f ns)\n",
+			zone, cProfilerZoneBudgetNanoseconds, timestamp, zone - 2.0 * timestamp);
+	}
+}
+
+void PrintUsage()
+{
+	printf(
+		"usage: d3d12bench <benchmark>\n"
+		"  --frame-bench [frameCount] [--replay capture]\n"
+		"  --micro-bench [out.json] [--filter name] [--min-ms milliseconds]\n"
+		"  --task-latency\n"
+		"  --task-jitter\n"
+		"  --task-throughput\n"
+		"  --profiler-overhead\n");
+}
+
+int main(int argc, char** argv)
+{
+	auto isFrameBench = false;
+	auto frameBenchFrameCount = 0;
+	const char* replayPath = nullptr;
+	auto isMicroBench = false;
+	const char* microBenchJsonPath = nullptr;
+	const char* microBenchFilter = nullptr;
+	auto microBenchMinMilliseconds = 0.0;
+
+	for (auto i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--task-latency") == 0)
+		{
+			RunTaskLatencyProbe();
+			return 0;
+		}
+		if (strcmp(argv[i], "--task-jitter") == 0)
+		{
+			RunTaskJitterProbe();
+			return 0;
+		}
+		if (strcmp(argv[i], "--task-throughput") == 0)
+		{
+			RunTaskThroughputProbe();
+			return 0;
+		}
+		if (strcmp(argv[i], "--profiler-overhead") == 0)
+		{
+			RunProfilerOverheadProbe();
+			return 0;
+		}
+		if (strcmp(argv[i], "--frame-bench") == 0)
+		{
+			isFrameBench = true;
+			if (i + 1 < argc && atoi(argv[i + 1]) > 0)
+			{
+				frameBenchFrameCount = atoi(argv[++i]);
+			}
+		}
+		if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replayPath = argv[++i];
+		}
+		if (strcmp(argv[i], "--micro-bench") == 0)
+		{
+			isMicroBench = true;
+			if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+			{
+				microBenchJsonPath = argv[++i];
+			}
+		}
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			microBenchFilter = argv[++i];
+		}
+		if (strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc)
+		{
+			microBenchMinMilliseconds = atof(argv[++i]);
+		}
+	}
+
+	if (isFrameBench)
+	{
+		return RunFrameBench(frameBenchFrameCount, replayPath);
+	}
+	if (isMicroBench)
+	{
+		return RunMicroBench(microBenchJsonPath, microBenchFilter, microBenchMinMilliseconds);
+	}
+
+	PrintUsage();
+	return 1;
+}
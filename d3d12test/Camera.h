@@ -1,15 +1,24 @@
 #pragma once
-#include <DirectXMath.h>
+#include "lib/FrameCapture.h"
+#include "lib/MatrixMath.h"
+#include <algorithm>
+
+// the camera constant buffer the shaders read; row-major like XMMATRIX
+struct alignas(256) CameraBuffer
+{
+	float View[16];
+	float Proj[16];
+};
 
 class Camera
 {
 public:
-	const DirectX::XMMATRIX& View() { return view_; }
-	const DirectX::XMMATRIX& Proj() { return proj_; }
+	const float* View() { return view_; }
+	const float* Proj() { return proj_; }
 
-	void SetPosition(DirectX::FXMVECTOR position) { position_ = position; }
-	void SetFocus(DirectX::FXMVECTOR focus) { focus_ = focus; }
-	void SetUp(DirectX::FXMVECTOR up) { up_ = up; }
+	void SetPosition(float x, float y, float z) { Set_(position_, x, y, z); }
+	void SetFocus(float x, float y, float z) { Set_(focus_, x, y, z); }
+	void SetUp(float x, float y, float z) { Set_(up_, x, y, z); }
 
 	void SetFovY(float fov) { fovY_ = fov; }
 	void SetAspect(float aspect) { aspect_ = aspect; }
@@ -18,21 +27,45 @@ public:
 
 	void UpdateMatrix()
 	{
-		view_ = DirectX::XMMatrixLookAtLH(position_, focus_, up_);
-		proj_ = DirectX::XMMatrixPerspectiveFovLH(fovY_, aspect_, near_, far_);
+		MatrixLookAtLH(position_, focus_, up_, view_);
+		MatrixPerspectiveFovLH(fovY_, aspect_, near_, far_, proj_);
 	}
 
 private:
-	DirectX::XMMATRIX view_;
-	DirectX::XMMATRIX proj_;
+	float view_[16];
+	float proj_[16];
 
-	DirectX::XMVECTOR position_;
-	DirectX::XMVECTOR focus_;
-	DirectX::XMVECTOR up_;
+	float position_[3];
+	float focus_[3];
+	float up_[3];
 
 	float fovY_;
 	float aspect_;
 	float near_;
 	float far_;
+
+	static void Set_(float* v, float x, float y, float z)
+	{
+		v[0] = x;
+		v[1] = y;
+		v[2] = z;
+	}
 };
 
+// the camera of a frame (live or replayed) into pBuffer, through pCamera; the app's camera job and FrameBench
+inline void UpdateCameraBuffer(Camera* pCamera, const FrameInputCamera& input, CameraBuffer* pBuffer)
+{
+	pCamera->SetPosition(input.Position[0], input.Position[1], input.Position[2]);
+	pCamera->SetFocus(input.Focus[0], input.Focus[1], input.Focus[2]);
+	pCamera->SetUp(input.Up[0], input.Up[1], input.Up[2]);
+
+	pCamera->SetFovY(input.FovY);
+	pCamera->SetAspect(input.Aspect);
+	pCamera->SetNearPlane(input.NearPlane);
+	pCamera->SetFarPlane(input.FarPlane);
+
+	pCamera->UpdateMatrix();
+
+	std::copy(pCamera->View(), pCamera->View() + 16, pBuffer->View);
+	std::copy(pCamera->Proj(), pCamera->Proj() + 16, pBuffer->Proj);
+}
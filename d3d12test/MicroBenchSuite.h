@@ -0,0 +1,544 @@
+#pragma once
+#include "lib/MicroBench.h"
+#include "lib/Quaternion.h"
+#include "lib/SceneGraph.h"
+#include "lib/SinCos.h"
+#include "lib/CopyRows.h"
+#include "lib/ExecuteCommandLists.h"
+#include "lib/NullGraphics.h"
+#include "lib/TaskQueue.h"
+#include "lib/TaskGroup.h"
+#include "lib/Transform.h"
+#include "lib/TransformStore.h"
+#include "Camera.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+// the hot paths of a frame, one benchmark each
+// the fbx::AnimStack ones need the FBX SDK and the Windows headers; define MICRO_BENCH_FBX to build them
+// (CMake: -DD3D12BENCH_FBX=ON)
+
+#if defined(MICRO_BENCH_FBX)
+#include "lib/fbxAnimStack.h"
+#endif
+
+inline void AddMicroBenchmarks(MicroBenchRunner* pRunner, int threadCount)
+{
+	pRunner->Add("transform_update_matrix", [](MicroBenchState& state)
+	{
+		Transform transform;
+		transform.SetScaling(1.0f, 2.0f, 1.0f);
+		transform.SetTranslation(1.0f, 2.0f, 3.0f);
+
+		auto angle = 0.0f;
+		while (state.KeepRunning())
+		{
+			transform.SetRotation(angle, angle * 0.5f, 0.0f);
+			transform.UpdateMatrix();
+			MicroBenchDoNotOptimize(transform.Matrix());
+			angle += 0.001f;
+		}
+		state.SetItemsProcessed(state.Iterations());
+	});
+
+	pRunner->Add("camera_update_matrix", [](MicroBenchState& state)
+	{
+		Camera camera;
+		camera.SetFocus(0.0f, 0.0f, 0.0f);
+		camera.SetUp(0.0f, 1.0f, 0.0f);
+		camera.SetFovY(cPiDiv4);
+		camera.SetAspect(16.0f / 9.0f);
+		camera.SetNearPlane(0.1f);
+		camera.SetFarPlane(1000.0f);
+
+		auto x = 10.0f;
+		while (state.KeepRunning())
+		{
+			camera.SetPosition(x, 5.0f, -10.0f);
+			camera.UpdateMatrix();
+			MicroBenchDoNotOptimize(camera.View());
+			MicroBenchDoNotOptimize(camera.Proj());
+			x += 0.001f;
+		}
+		state.SetItemsProcessed(state.Iterations());
+	});
+
+#if defined(MICRO_BENCH_FBX)
+	pRunner->Add("anim_stack_next_frame", [](MicroBenchState& state)
+	{
+		std::vector<DirectX::XMMATRIX> keys;
+		for (auto i = 0; i < 60; ++i)
+		{
+			keys.push_back(DirectX::XMMatrixRotationY(DirectX::XM_2PI * i / 60));
+		}
+		std::unique_ptr<fbx::AnimStack> pStack(fbx::AnimStack::Create(keys.data(), static_cast<int>(keys.size())));
+
+		const auto world = DirectX::XMMatrixTranslation(1.0f, 2.0f, 3.0f);
+		while (state.KeepRunning())
+		{
+			// the way Model::SetTransform() uses it
+			const auto m = pStack->NextFrame() * world;
+			MicroBenchDoNotOptimize(m);
+		}
+		state.SetItemsProcessed(state.Iterations());
+	});
+
+	// between keys, as a blend of two poses would be
+	pRunner->Add("anim_stack_sample", [](MicroBenchState& state)
+	{
+		std::vector<DirectX::XMMATRIX> keys;
+		for (auto i = 0; i < 60; ++i)
+		{
+			keys.push_back(DirectX::XMMatrixRotationY(DirectX::XM_2PI * i / 60));
+		}
+		std::unique_ptr<fbx::AnimStack> pStack(fbx::AnimStack::Create(keys.data(), static_cast<int>(keys.size())));
+
+		const auto world = DirectX::XMMatrixTranslation(1.0f, 2.0f, 3.0f);
+		auto frame = 0.0f;
+		while (state.KeepRunning())
+		{
+			const auto m = pStack->Sample(frame) * world;
+			MicroBenchDoNotOptimize(m);
+			frame = (frame + 0.25f < 60.0f) ? frame + 0.25f : 0.0f;
+		}
+		state.SetItemsProcessed(state.Iterations());
+	});
+#endif
+
+	// 4096 angles per iteration, the C runtime against SinCos() one, four and eight at a time
+	{
+		const auto angleCount = 4096;
+		auto pAngles = std::make_shared<std::vector<float>>(angleCount);
+		for (auto i = 0; i < angleCount; ++i)
+		{
+			(*pAngles)[i] = (i - angleCount / 2) * 0.01f;
+		}
+
+		pRunner->Add("sincos/libm", [pAngles](MicroBenchState& state)
+		{
+			auto sum = 0.0f;
+			while (state.KeepRunning())
+			{
+				for (const auto angle : *pAngles)
+				{
+					sum += std::sin(angle) + std::cos(angle);
+				}
+				MicroBenchDoNotOptimize(sum);
+			}
+			state.SetItemsProcessed(state.Iterations() * pAngles->size());
+		});
+
+		pRunner->Add("sincos/scalar", [pAngles](MicroBenchState& state)
+		{
+			auto sum = 0.0f;
+			while (state.KeepRunning())
+			{
+				for (const auto angle : *pAngles)
+				{
+					float sinValue, cosValue;
+					SinCos(angle, &sinValue, &cosValue);
+					sum += sinValue + cosValue;
+				}
+				MicroBenchDoNotOptimize(sum);
+			}
+			state.SetItemsProcessed(state.Iterations() * pAngles->size());
+		});
+
+#if defined(SIN_COS_SSE)
+		pRunner->Add("sincos/sse", [pAngles](MicroBenchState& state)
+		{
+			auto sum = _mm_setzero_ps();
+			while (state.KeepRunning())
+			{
+				for (auto i = 0; i < angleCount; i += 4)
+				{
+					__m128 sinValue, cosValue;
+					SinCos(_mm_loadu_ps(pAngles->data() + i), &sinValue, &cosValue);
+					sum = _mm_add_ps(sum, _mm_add_ps(sinValue, cosValue));
+				}
+				MicroBenchDoNotOptimize(sum);
+			}
+			state.SetItemsProcessed(state.Iterations() * pAngles->size());
+		});
+#endif
+	}
+
+	// a whole store per iteration: batched SIMD composition against one transform at a time
+	for (const auto transformCount : { 10000, 100000, 1000000 })
+	{
+		for (const auto isScalar : { false, true })
+		{
+			const auto name = "transform_store_update/" + std::to_string(transformCount) + (isScalar ? "/scalar" : "");
+			pRunner->Add(name, [transformCount, isScalar](MicroBenchState& state)
+			{
+				TransformStore store;
+				store.Reserve(transformCount);
+				for (auto i = 0; i < transformCount; ++i)
+				{
+					const auto handle = store.Add();
+					store.SetScaling(handle, 1.0f, 2.0f, 1.0f);
+					store.SetRotation(handle, i * 0.001f, i * 0.002f, i * 0.003f);
+					store.SetTranslation(handle, 1.0f, 2.0f, 3.0f);
+				}
+
+				while (state.KeepRunning())
+				{
+					if (isScalar)
+					{
+						store.UpdateMatricesScalar(0, transformCount);
+					}
+					else
+					{
+						store.UpdateMatrices(0, transformCount);
+					}
+					MicroBenchDoNotOptimize(store.Matrix(transformCount - 1)[0]);
+				}
+				state.SetItemsProcessed(state.Iterations() * transformCount);
+			});
+		}
+	}
+
+	// a frame of a 100000 transform scene: set the rotation of the moving ones, then compose the dirty list
+	// items count the transforms composed, so /static, which composes none, reports only its time
+	// every transform gets its own Euler angles (one angle for all would let the compiler hoist the conversion out
+	// of the loop), converted by the update 4 at a time; /quat sets one quaternion converted once per frame
+	const struct
+	{
+		int Stride;		// every Stride-th transform moves, none if 0
+		const char* Name;
+	} scenes[] =
+	{
+		{ 0, "static" },
+		{ 10, "10pct" },
+		{ 1, "dynamic" },
+	};
+
+	for (const auto& scene : scenes)
+	{
+		for (const auto isQuaternion : { false, true })
+		{
+			const auto stride = scene.Stride;
+			if (isQuaternion && stride == 0)
+			{
+				continue;
+			}
+			pRunner->Add(std::string("transform_store_dirty/") + scene.Name + (isQuaternion ? "/quat" : ""), [stride, isQuaternion](MicroBenchState& state)
+			{
+				const auto transformCount = 100000;
+
+				TransformStore store;
+				store.Reserve(transformCount);
+				for (auto i = 0; i < transformCount; ++i)
+				{
+					const auto handle = store.Add();
+					store.SetTranslation(handle, 1.0f, 2.0f, 3.0f);
+				}
+				store.UpdateDirtyMatrices();
+
+				auto angle = 0.0f;
+				while (state.KeepRunning())
+				{
+					angle += 0.01f;
+					const auto rotation = QuaternionFromEuler(0.0f, angle, 0.0f);
+					for (auto i = 0; stride > 0 && i < transformCount; i += stride)
+					{
+						if (isQuaternion)
+						{
+							store.SetRotation(i, rotation);
+						}
+						else
+						{
+							store.SetRotation(i, angle + i * 0.001f, angle + i * 0.002f, angle + i * 0.003f);
+						}
+					}
+					store.UpdateDirtyMatrices();
+					MicroBenchDoNotOptimize(store.Matrix(0)[0]);
+				}
+				const auto dirtyCount = (stride > 0) ? (transformCount + stride - 1) / stride : 0;
+				state.SetItemsProcessed(state.Iterations() * dirtyCount);
+			});
+		}
+	}
+
+	// 100000 nodes either wide (100 roots of 1000 children, 2 levels) or deep (100 chains of 1000, 1000 levels);
+	// every root moves (all) or only the first one (one), updated on the calling thread or split across a queue
+	for (const auto isDeep : { false, true })
+	{
+		for (const auto isAllDirty : { true, false })
+		{
+			for (const auto isParallel : { false, true })
+			{
+				const auto name = std::string("scene_graph_update/") + (isDeep ? "deep" : "wide")
+					+ (isAllDirty ? "/all" : "/one") + (isParallel ? "/parallel" : "/serial");
+				pRunner->Add(name, [isDeep, isAllDirty, isParallel, threadCount](MicroBenchState& state)
+				{
+					const auto rootCount = 100;
+					const auto nodeCountPerRoot = 1000;
+
+					TaskQueue queue;
+					queue.Setup(threadCount, TaskQueue::Mode::WorkStealing);
+
+					SceneGraph graph;
+					graph.Reserve(rootCount * (nodeCountPerRoot + 1));
+					std::vector<SceneGraph::Node> roots;
+					float local[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.1f, 0.0f, 1.0f };
+					for (auto i = 0; i < rootCount; ++i)
+					{
+						roots.push_back(graph.Add());
+						auto parent = roots.back();
+						for (auto j = 0; j < nodeCountPerRoot; ++j)
+						{
+							const auto node = graph.Add(parent);
+							graph.SetLocal(node, local);
+							parent = isDeep ? node : roots.back();
+						}
+					}
+					graph.UpdateWorld();
+
+					const auto pQueue = isParallel ? &queue : nullptr;
+					while (state.KeepRunning())
+					{
+						local[12] += 0.001f;
+						for (auto i = 0; i < (isAllDirty ? rootCount : 1); ++i)
+						{
+							graph.SetLocal(roots[i], local);
+						}
+						graph.UpdateWorld(pQueue);
+						MicroBenchDoNotOptimize(graph.World(graph.NodeCount() - 1)[12]);
+					}
+					state.SetItemsProcessed(state.Iterations() * graph.NodeCount());
+				});
+			}
+		}
+	}
+
+	const struct
+	{
+		TaskQueue::Mode Mode;
+		const char* Name;
+	} modes[] =
+	{
+		{ TaskQueue::Mode::SharedQueue, "shared" },
+		{ TaskQueue::Mode::WorkStealing, "stealing" },
+		{ TaskQueue::Mode::LockFree, "lockfree" },
+	};
+
+	for (const auto& mode : modes)
+	{
+		const auto queueMode = mode.Mode;
+
+		// enqueue from the main thread, run on the workers, wait: the per-task overhead of a frame graph job
+		pRunner->Add(std::string("task_queue_dispatch/") + mode.Name, [queueMode, threadCount](MicroBenchState& state)
+		{
+			const auto taskCount = 256;
+
+			TaskQueue queue;
+			queue.Setup(threadCount, queueMode);
+
+			while (state.KeepRunning())
+			{
+				TaskGroup group;
+				for (auto i = 0; i < taskCount; ++i)
+				{
+					queue.Enqueue([]() {}, &group);
+				}
+				group.Wait();
+			}
+			state.SetItemsProcessed(state.Iterations() * taskCount);
+		});
+
+		pRunner->Add(std::string("task_queue_parallel_for/") + mode.Name, [queueMode, threadCount](MicroBenchState& state)
+		{
+			const auto itemCount = 4096;
+			std::vector<float> items(itemCount, 1.0f);
+			auto pItems = items.data();
+
+			TaskQueue queue;
+			queue.Setup(threadCount, queueMode);
+
+			while (state.KeepRunning())
+			{
+				TaskGroup group;
+				queue.ParallelFor(0, itemCount, 64, [pItems](int begin, int end)
+				{
+					for (auto i = begin; i < end; ++i)
+					{
+						pItems[i] = pItems[i] * 0.5f + 1.0f;
+					}
+				}, &group);
+				group.Wait();
+			}
+			MicroBenchDoNotOptimize(items[0]);
+			state.SetItemsProcessed(state.Iterations() * itemCount);
+		});
+	}
+
+	// one task fans out 1024 more from a worker, as a frame graph job does, on 1 to 32 workers
+	// tiny tasks are empty and measure scheduling alone, large ones do about 10 us of math each
+	for (const auto& mode : modes)
+	{
+		if (mode.Mode == TaskQueue::Mode::LockFree)
+		{
+			continue;
+		}
+
+		for (const auto isLarge : { false, true })
+		{
+			for (const auto workerCount : { 1, 2, 4, 8, 16, 32 })
+			{
+				const auto queueMode = mode.Mode;
+				const auto name = std::string("task_queue_scaling/") + mode.Name + (isLarge ? "/large/" : "/tiny/") + std::to_string(workerCount);
+				pRunner->Add(name, [queueMode, isLarge, workerCount](MicroBenchState& state)
+				{
+					const auto taskCount = 1024;
+					const auto iterationCount = isLarge ? 4000 : 0;
+
+					TaskQueue queue;
+					queue.Setup(workerCount, queueMode);
+					auto pQueue = &queue;
+
+					while (state.KeepRunning())
+					{
+						TaskGroup group;
+						auto pGroup = &group;
+						queue.Enqueue([pQueue, pGroup, taskCount, iterationCount]()
+						{
+							for (auto i = 0; i < taskCount; ++i)
+							{
+								pQueue->Enqueue([iterationCount]()
+								{
+									auto x = 1.0f;
+									for (auto j = 0; j < iterationCount; ++j)
+									{
+										x = x * 0.999f + 0.5f;
+									}
+									MicroBenchDoNotOptimize(x);
+								}, pGroup);
+							}
+						}, pGroup);
+						group.Wait();
+					}
+					state.SetItemsProcessed(state.Iterations() * taskCount);
+				});
+			}
+		}
+	}
+
+	// the last eighth of the items costs 32x the rest, like a few heavy models in a grid
+	// static: one chunk per worker with the remainder on the last, as main.cpp used to split ranges;
+	// recursive: ParallelFor with its automatic grain
+	for (const auto isRecursive : { false, true })
+	{
+		pRunner->Add(std::string("parallel_for_skewed/") + (isRecursive ? "recursive" : "static"), [isRecursive, threadCount](MicroBenchState& state)
+		{
+			const auto itemCount = 4096;
+			std::vector<float> items(itemCount, 1.0f);
+			auto pItems = items.data();
+
+			const auto body = [pItems, itemCount](int begin, int end)
+			{
+				for (auto i = begin; i < end; ++i)
+				{
+					const auto iterationCount = (i >= itemCount - itemCount / 8) ? 320 : 10;
+					auto x = pItems[i];
+					for (auto j = 0; j < iterationCount; ++j)
+					{
+						x = x * 0.999f + 0.5f;
+					}
+					pItems[i] = x;
+				}
+			};
+
+			TaskQueue queue;
+			queue.Setup(threadCount, TaskQueue::Mode::WorkStealing);
+
+			while (state.KeepRunning())
+			{
+				TaskGroup group;
+				if (isRecursive)
+				{
+					queue.ParallelFor(0, itemCount, 0, body, &group);
+				}
+				else
+				{
+					const auto countPerThread = std::max(1, itemCount / threadCount);
+					for (auto begin = 0; begin < itemCount; begin += countPerThread)
+					{
+						const auto end = (begin + 2 * countPerThread > itemCount) ? itemCount : begin + countPerThread;
+						queue.Enqueue([body, begin, end]() { body(begin, end); }, &group);
+						if (end == itemCount)
+						{
+							break;
+						}
+					}
+				}
+				group.Wait();
+			}
+			MicroBenchDoNotOptimize(items[0]);
+			state.SetItemsProcessed(state.Iterations() * itemCount);
+		});
+	}
+
+	// tight: source and destination rows are packed, padded: the destination pitch is longer than a row
+	// (D3D12 footprints round pitches up to 256 bytes)
+	for (const auto rowSize : { 64, 256, 1024, 4096 })
+	{
+		for (const auto isPadded : { false, true })
+		{
+			const auto name = "copy_rows/" + std::to_string(rowSize) + (isPadded ? "/padded" : "/tight");
+			pRunner->Add(name, [rowSize, isPadded](MicroBenchState& state)
+			{
+				const auto rowCount = 256;
+				const auto destPitch = isPadded ? ((rowSize + 256 + 255) & ~255) : rowSize;
+
+				std::vector<unsigned char> source(static_cast<size_t>(rowSize) * rowCount, 1);
+				std::vector<unsigned char> dest(static_cast<size_t>(destPitch) * rowCount);
+
+				while (state.KeepRunning())
+				{
+					CopyRows(
+						dest.data(), destPitch, dest.size(),
+						source.data(), rowSize, source.size(),
+						rowSize, rowCount, 1);
+					MicroBenchDoNotOptimize(dest[0]);
+				}
+				state.SetBytesProcessed(state.Iterations() * rowSize * rowCount);
+			});
+		}
+	}
+
+	// CommandListManager::Execute() of a frame: 4 execution orders of listCount lists each plus an empty one,
+	// gathered into one submit per order; NullCommandQueue stands in for the driver, so this is the CPU side only
+	for (const auto listCount : { 1, 8, 32 })
+	{
+		pRunner->Add("command_list_execute/" + std::to_string(listCount), [listCount](MicroBenchState& state)
+		{
+			const auto orderCount = 4;
+
+			std::vector<NullCommandList> lists(orderCount * listCount);
+			std::vector<std::vector<NullCommandList*>> orders(orderCount + 1);
+			for (auto i = 0; i < orderCount * listCount; ++i)
+			{
+				orders[i / listCount].push_back(&lists[i]);
+			}
+
+			std::vector<std::vector<NullCommandList*>*> orderPtrs;
+			for (auto& order : orders)
+			{
+				orderPtrs.push_back(&order);
+			}
+
+			NullCommandQueue queue;
+			std::vector<ICommandList*> executeListPtrs;
+			while (state.KeepRunning())
+			{
+				ExecuteCommandLists(&queue, orderPtrs, &executeListPtrs);
+			}
+			MicroBenchDoNotOptimize(queue.ExecuteCount());
+			state.SetItemsProcessed(state.Iterations() * orderCount * listCount);
+		});
+	}
+}
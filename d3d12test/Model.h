@@ -2,13 +2,6 @@
 #include "lib\lib.h"
 #include <memory>
 
-__declspec(align(256))
-struct CameraBuffer
-{
-	DirectX::XMMATRIX View;
-	DirectX::XMMATRIX Proj;
-};
-
 class Model
 {
 public:
@@ -30,6 +23,7 @@ public:
 	ulonglong ShaderHash() const { return modelPtr_->ShaderHash(); }
 
 	int MeshCount() { return modelPtr_->MeshCount(); }
+	fbx::AnimStack* AnimStackPtr(int mesh) { return modelPtr_->MeshPtr(mesh)->AnimStackPtr(0); }
 
 	void Setup(Device* pDevice, const char* filepath)
 	{
@@ -71,12 +65,26 @@ public:
 		modelPtr_->SetShaderHash(hash);
 	}
 
-	void SetTransform(const DirectX::XMMATRIX& world, const CameraBuffer& camera)
+	void AttachToSceneGraph(SceneGraph* pGraph)
+	{
+		modelPtr_->AttachToSceneGraph(pGraph);
+	}
+
+	void UpdateSceneGraph()
+	{
+		modelPtr_->UpdateSceneGraph();
+	}
+
+	// after the scene graph update: each mesh is placed under the model's world matrix
+	void SetTransform(const CameraBuffer& camera)
 	{
 		for (auto i = 0; i < modelPtr_->MeshCount(); ++i)
 		{
-			auto m = modelPtr_->MeshPtr(i)->AnimStackPtr(0)->NextFrame() * world;
-			modelPtr_->MeshPtr(i)->SetTransform(m);
+			const auto pMesh = modelPtr_->MeshPtr(i);
+			DirectX::XMFLOAT4X4A animation, world;
+			DirectX::XMStoreFloat4x4A(&animation, pMesh->AnimStackPtr(0)->NextFrame());
+			MeshWorldMatrix(&animation.m[0][0], modelPtr_->World(), &world.m[0][0]);
+			pMesh->SetTransform(DirectX::XMLoadFloat4x4A(&world));
 		}
 
 		cameraCbv_.SetBuffer(camera);
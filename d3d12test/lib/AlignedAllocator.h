@@ -0,0 +1,68 @@
+#pragma once
+#include "AllocTracker.h"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+// std::allocator for over-aligned element types
+// VS2015's std::allocator (and operator new before C++17) ignores alignas() beyond what malloc returns,
+// which is only 8 bytes on Win32 x86, so a std::vector of alignas(16) matrices can't be loaded with _mm_load_ps
+// allocations bypass operator new, so they are reported to AllocTracker here
+template<class T, size_t Alignment = alignof(T)>
+class AlignedAllocator
+{
+public:
+	typedef T value_type;
+
+	template<class U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() {}
+
+	template<class U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t count)
+	{
+		const auto bytes = count * sizeof(T);
+		AllocTracker::Instance().RecordAllocation(bytes);
+
+#if defined(_WIN32)
+		auto ptr = _aligned_malloc((bytes > 0) ? bytes : 1, Alignment);
+#else
+		void* ptr = nullptr;
+		if (posix_memalign(&ptr, (Alignment < sizeof(void*)) ? sizeof(void*) : Alignment, (bytes > 0) ? bytes : 1) != 0)
+		{
+			ptr = nullptr;
+		}
+#endif
+		if (ptr == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(ptr);
+	}
+
+	void deallocate(T* ptr, size_t)
+	{
+		AllocTracker::Instance().RecordFree();
+#if defined(_WIN32)
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+};
+
+template<class T, class U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return true; }
+
+template<class T, class U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return false; }
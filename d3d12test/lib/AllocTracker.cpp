@@ -0,0 +1,58 @@
+#include "AllocTracker.h"
+#include <cstdlib>
+#include <new>
+
+// global allocation hooks; they cost one relaxed load each while the tracker is disabled
+
+void* operator new(size_t size)
+{
+	AllocTracker::Instance().RecordAllocation(size);
+
+	auto ptr = malloc((size > 0) ? size : 1);
+	if (ptr == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	AllocTracker::Instance().RecordAllocation(size);
+	return malloc((size > 0) ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if (ptr == nullptr)
+	{
+		return;
+	}
+	AllocTracker::Instance().RecordFree();
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	operator delete(ptr);
+}
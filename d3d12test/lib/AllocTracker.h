@@ -0,0 +1,255 @@
+#pragma once
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+// opt-in allocation telemetry
+// the global operator new/delete (AllocTracker.cpp) report here; nothing is counted until SetEnabled(true)
+// ALLOC_SCOPE(name) charges what the calling thread allocates inside the enclosing scope to a subsystem,
+// EndFrame() turns the running counters into per-frame numbers
+class AllocTracker
+{
+public:
+	static const int cMaxTagCount = 32;
+	static const int cUntagged = 0;
+
+	static AllocTracker& Instance()
+	{
+		static AllocTracker tracker;
+		return tracker;
+	}
+
+	void SetEnabled(bool enabled) { isEnabled_.store(enabled, std::memory_order_relaxed); }
+	bool IsEnabled() { return isEnabled_.load(std::memory_order_relaxed); }
+
+	// steady-state check: every frame that still allocates counts as a violation and is reported
+	void SetNoAllocationCheck(bool check) { isChecking_ = check; }
+	int ViolationCount() { return violationCount_; }
+
+	// returns the tag of a subsystem; tags with the same name are shared, the last one takes the overflow
+	int RegisterTag(const char* name)
+	{
+		std::unique_lock<std::mutex> lk(tagLock_);
+		const auto tagCount = tagCount_.load(std::memory_order_relaxed);
+		for (auto i = 0; i < tagCount; ++i)
+		{
+			if (strcmp(tagNames_[i], name) == 0)
+			{
+				return i;
+			}
+		}
+		if (tagCount == cMaxTagCount)
+		{
+			return cMaxTagCount - 1;
+		}
+		tagNames_[tagCount] = name;
+		tagCount_.store(tagCount + 1, std::memory_order_release);
+		return tagCount;
+	}
+
+	static int CurrentTag() { return CurrentTag_(); }
+	static void SetCurrentTag(int tag) { CurrentTag_() = tag; }
+
+	// also for allocators that bypass operator new (HeapAlloc, ...)
+	void RecordAllocation(size_t bytes)
+	{
+		if (!IsEnabled())
+		{
+			return;
+		}
+		auto& counter = counters_[CurrentTag_()];
+		counter.Count.fetch_add(1, std::memory_order_relaxed);
+		counter.Bytes.fetch_add(static_cast<long long>(bytes), std::memory_order_relaxed);
+	}
+
+	void RecordFree()
+	{
+		if (!IsEnabled())
+		{
+			return;
+		}
+		freeCount_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// from the frame loop thread; returns the number of allocations made since the previous call
+	int EndFrame()
+	{
+		const auto tagCount = tagCount_.load(std::memory_order_acquire);
+
+		long long frameCount = 0;
+		long long frameBytes = 0;
+		for (auto i = 0; i < tagCount; ++i)
+		{
+			auto& tag = tags_[i];
+			const auto count = counters_[i].Count.load(std::memory_order_relaxed);
+			const auto bytes = counters_[i].Bytes.load(std::memory_order_relaxed);
+
+			tag.FrameCount = count - tag.LastCount;
+			tag.FrameBytes = bytes - tag.LastBytes;
+			tag.LastCount = count;
+			tag.LastBytes = bytes;
+			tag.TotalCount += tag.FrameCount;
+			tag.TotalBytes += tag.FrameBytes;
+
+			frameCount += tag.FrameCount;
+			frameBytes += tag.FrameBytes;
+		}
+
+		const auto frees = freeCount_.load(std::memory_order_relaxed);
+		frameFreeCount_ = frees - lastFreeCount_;
+		lastFreeCount_ = frees;
+
+		frameAllocationCount_ = frameCount;
+		frameAllocatedBytes_ = frameBytes;
+		++frameCount_;
+
+		if (isChecking_ && frameCount > 0)
+		{
+			++violationCount_;
+			printf("[alloc] %lld allocations (%lld bytes) in a steady-state frame:", frameCount, frameBytes);
+			for (auto i = 0; i < tagCount; ++i)
+			{
+				if (tags_[i].FrameCount > 0)
+				{
+					printf(" %s=%lld", tagNames_[i], tags_[i].FrameCount);
+				}
+			}
+			printf("\n");
+			Skip();
+		}
+
+		return static_cast<int>(frameCount);
+	}
+
+	// drops what was allocated since the last EndFrame(), e.g. by printing reports
+	void Skip()
+	{
+		const auto tagCount = tagCount_.load(std::memory_order_acquire);
+		for (auto i = 0; i < tagCount; ++i)
+		{
+			tags_[i].LastCount = counters_[i].Count.load(std::memory_order_relaxed);
+			tags_[i].LastBytes = counters_[i].Bytes.load(std::memory_order_relaxed);
+		}
+		lastFreeCount_ = freeCount_.load(std::memory_order_relaxed);
+	}
+
+	long long FrameAllocationCount() { return frameAllocationCount_; }
+	long long FrameAllocatedBytes() { return frameAllocatedBytes_; }
+	long long FrameFreeCount() { return frameFreeCount_; }
+
+	int FrameCount() { return frameCount_; }
+
+	void Reset()
+	{
+		for (auto& tag : tags_)
+		{
+			tag.TotalCount = 0;
+			tag.TotalBytes = 0;
+		}
+		frameCount_ = 0;
+	}
+
+	// prints per-frame averages by subsystem since Reset()
+	void Dump()
+	{
+		if (frameCount_ == 0)
+		{
+			return;
+		}
+
+		printf("===[ALLOC]=====\n");
+		const auto tagCount = tagCount_.load(std::memory_order_acquire);
+		for (auto i = 0; i < tagCount; ++i)
+		{
+			const auto& tag = tags_[i];
+			if (tag.TotalCount == 0)
+			{
+				continue;
+			}
+			printf(
+				"%-32s %8.1f allocs %10.1f bytes\n",
+				tagNames_[i],
+				static_cast<double>(tag.TotalCount) / frameCount_,
+				static_cast<double>(tag.TotalBytes) / frameCount_);
+		}
+	}
+
+private:
+	// written from every thread; one cache line each so subsystems don't false-share
+	struct alignas(64) Counter_
+	{
+		std::atomic<long long> Count{ 0 };
+		std::atomic<long long> Bytes{ 0 };
+	};
+
+	// EndFrame() only
+	struct Tag_
+	{
+		long long LastCount = 0;
+		long long LastBytes = 0;
+		long long FrameCount = 0;
+		long long FrameBytes = 0;
+		long long TotalCount = 0;
+		long long TotalBytes = 0;
+	};
+
+	std::atomic<bool> isEnabled_{ false };
+
+	const char* tagNames_[cMaxTagCount];
+	std::atomic<int> tagCount_{ 0 };
+	std::mutex tagLock_;
+
+	Counter_ counters_[cMaxTagCount];
+	std::atomic<long long> freeCount_{ 0 };
+
+	Tag_ tags_[cMaxTagCount];
+	long long lastFreeCount_ = 0;
+	long long frameAllocationCount_ = 0;
+	long long frameAllocatedBytes_ = 0;
+	long long frameFreeCount_ = 0;
+	int frameCount_ = 0;
+
+	bool isChecking_ = false;
+	int violationCount_ = 0;
+
+	AllocTracker()
+	{
+		RegisterTag("untagged");
+	}
+
+	static int& CurrentTag_()
+	{
+		static thread_local int tag = cUntagged;
+		return tag;
+	}
+};
+
+class AllocScope
+{
+public:
+	explicit AllocScope(int tag)
+		: previousTag_(AllocTracker::CurrentTag())
+	{
+		AllocTracker::SetCurrentTag(tag);
+	}
+
+	~AllocScope()
+	{
+		AllocTracker::SetCurrentTag(previousTag_);
+	}
+
+	AllocScope(const AllocScope&) = delete;
+	AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+	int previousTag_;
+};
+
+#define ALLOC_SCOPE_CONCAT_(a, b) a##b
+#define ALLOC_SCOPE_CONCAT(a, b) ALLOC_SCOPE_CONCAT_(a, b)
+
+// charges allocations in the enclosing scope to subsystem name (a string literal)
+#define ALLOC_SCOPE(name) \
+	static const int ALLOC_SCOPE_CONCAT(allocTag_, __LINE__) = AllocTracker::Instance().RegisterTag(name); \
+	AllocScope ALLOC_SCOPE_CONCAT(allocScope_, __LINE__)(ALLOC_SCOPE_CONCAT(allocTag_, __LINE__))
@@ -0,0 +1,305 @@
+#pragma once
+#include "TaskQueue.h"
+#include "TaskGroup.h"
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// coroutines that suspend instead of blocking a thread and resume on TaskQueue workers
+// MSVC needs /await (coroutines TS), other compilers C++20
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+template<class Promise = void>
+using CoroutineHandle = std::coroutine_handle<Promise>;
+typedef std::suspend_always SuspendAlways;
+#elif defined(_RESUMABLE_FUNCTIONS_SUPPORTED)
+#include <experimental/resumable>
+template<class Promise = void>
+using CoroutineHandle = std::experimental::coroutine_handle<Promise>;
+typedef std::experimental::suspend_always SuspendAlways;
+#else
+#error "Async.h needs coroutine support (/await on MSVC, -std=c++20 elsewhere)"
+#endif
+
+// what a detached coroutine (Async::Start()) threw
+inline void ReportDetachedException(std::exception_ptr exception)
+{
+	try
+	{
+		std::rethrow_exception(exception);
+	}
+	catch (const std::exception& e)
+	{
+		printf("[async] a detached coroutine threw: %s\n", e.what());
+	}
+	catch (...)
+	{
+		printf("[async] a detached coroutine threw\n");
+	}
+}
+
+// lazily started coroutine returning T
+// co_await it from another coroutine, or Start() it on a TaskQueue when nobody awaits it
+template<class T>
+class Async
+{
+public:
+	struct promise_type;
+
+private:
+	struct FinalAwaiter_
+	{
+		bool await_ready() noexcept { return false; }
+
+		void await_suspend(CoroutineHandle<promise_type> handle) noexcept
+		{
+			auto& promise = handle.promise();
+			if (promise.IsDetached)
+			{
+				// nobody awaits the result, so nobody would see the exception either
+				if (promise.Exception)
+				{
+					ReportDetachedException(promise.Exception);
+				}
+
+				auto pGroup = promise.pGroup;
+				handle.destroy();
+				if (pGroup != nullptr)
+				{
+					pGroup->Done();
+				}
+				return;
+			}
+
+			if (promise.Continuation)
+			{
+				promise.Continuation.resume();
+			}
+		}
+
+		void await_resume() noexcept {}
+	};
+
+public:
+	struct promise_type
+	{
+		T Value{};
+		std::exception_ptr Exception;
+		CoroutineHandle<> Continuation;
+		TaskGroup* pGroup = nullptr;
+		bool IsDetached = false;
+
+		Async get_return_object() { return Async(CoroutineHandle<promise_type>::from_promise(*this)); }
+		SuspendAlways initial_suspend() { return{}; }
+		FinalAwaiter_ final_suspend() noexcept { return{}; }
+		void return_value(T value) { Value = std::move(value); }
+		void unhandled_exception() { Exception = std::current_exception(); }
+		void set_exception(std::exception_ptr exception) { Exception = exception; } // coroutines TS
+	};
+
+public:
+	Async(Async&& other)
+		: handle_(other.handle_)
+	{
+		other.handle_ = nullptr;
+	}
+
+	Async(const Async&) = delete;
+	Async& operator=(const Async&) = delete;
+
+	~Async()
+	{
+		if (handle_)
+		{
+			handle_.destroy();
+		}
+	}
+
+	bool await_ready() { return false; }
+
+	void await_suspend(CoroutineHandle<> continuation)
+	{
+		handle_.promise().Continuation = continuation;
+		handle_.resume();
+	}
+
+	T await_resume()
+	{
+		auto& promise = handle_.promise();
+		if (promise.Exception)
+		{
+			std::rethrow_exception(promise.Exception);
+		}
+		return std::move(promise.Value);
+	}
+
+	// runs the coroutine on pQueue without waiting for it; the frame frees itself at the end
+	// pGroup (optional) is signaled when it has finished, the result is dropped and an exception is printed
+	void Start(TaskQueue* pQueue, TaskGroup* pGroup = nullptr, TaskPriority priority = TaskPriority::Critical)
+	{
+		auto handle = handle_;
+		handle_ = nullptr;
+
+		handle.promise().IsDetached = true;
+		handle.promise().pGroup = pGroup;
+		if (pGroup != nullptr)
+		{
+			pGroup->Add();
+		}
+
+		pQueue->Enqueue([handle]() { handle.resume(); }, nullptr, priority);
+	}
+
+private:
+	CoroutineHandle<promise_type> handle_;
+
+	explicit Async(CoroutineHandle<promise_type> handle)
+		: handle_(handle)
+	{}
+};
+
+// co_await RunOn(pQueue, fn): runs fn as a task (background lane by default, for file I/O and decoding)
+// and returns its result, or rethrows what it threw; the coroutine continues as a critical task afterwards
+// fn must return a default-constructible value
+template<class Fn>
+class RunOnAwaiter
+{
+public:
+	typedef typename std::decay<decltype(std::declval<Fn&>()())>::type Result;
+
+	RunOnAwaiter(TaskQueue* pQueue, Fn fn, TaskPriority priority)
+		: pQueue_(pQueue), fn_(std::move(fn)), priority_(priority)
+	{}
+
+	bool await_ready() { return false; }
+
+	void await_suspend(CoroutineHandle<> handle)
+	{
+		handle_ = handle;
+		pQueue_->Enqueue([this]()
+		{
+			// an exception must not leave the task, it would take the worker down
+			try
+			{
+				result_ = fn_();
+			}
+			catch (...)
+			{
+				exception_ = std::current_exception();
+			}
+
+			// this awaiter lives in the coroutine frame; don't touch it once the resume is queued
+			auto pQueue = pQueue_;
+			auto handle = handle_;
+			pQueue->Enqueue([handle]() { handle.resume(); });
+		}, nullptr, priority_);
+	}
+
+	Result await_resume()
+	{
+		if (exception_)
+		{
+			std::rethrow_exception(exception_);
+		}
+		return std::move(result_);
+	}
+
+private:
+	TaskQueue* pQueue_;
+	Fn fn_;
+	TaskPriority priority_;
+	Result result_{};
+	std::exception_ptr exception_;
+	CoroutineHandle<> handle_;
+};
+
+template<class Fn>
+RunOnAwaiter<Fn> RunOn(TaskQueue* pQueue, Fn fn, TaskPriority priority = TaskPriority::Background)
+{
+	return RunOnAwaiter<Fn>(pQueue, std::move(fn), priority);
+}
+
+// coroutines waiting for fence values
+// co_await list.Wait(pFence, value) suspends until pFence->CompletedValue() >= value;
+// Poll() (once a frame, from any thread) hands the finished ones to the TaskQueue
+// Fence is GpuFence, or anything else with an integral CompletedValue()
+template<class Fence>
+class FenceWaitList
+{
+public:
+	class Awaiter
+	{
+	public:
+		Awaiter(FenceWaitList* pOwner, Fence* pFence, uint64_t value)
+			: pOwner_(pOwner), pFence_(pFence), value_(value)
+		{}
+
+		bool await_ready() { return pFence_->CompletedValue() >= value_; }
+		void await_suspend(CoroutineHandle<> handle) { pOwner_->Add_(pFence_, value_, handle); }
+		void await_resume() {}
+
+	private:
+		FenceWaitList* pOwner_;
+		Fence* pFence_;
+		uint64_t value_;
+	};
+
+public:
+	void Setup(TaskQueue* pQueue) { pQueue_ = pQueue; }
+
+	int WaitingCount()
+	{
+		std::unique_lock<std::mutex> lk(lock_);
+		return static_cast<int>(entries_.size());
+	}
+
+	Awaiter Wait(Fence* pFence, uint64_t value) { return Awaiter(this, pFence, value); }
+
+	// returns the number of coroutines resumed
+	int Poll()
+	{
+		std::unique_lock<std::mutex> lk(lock_);
+
+		auto resumedCount = 0;
+		for (auto i = 0; i < static_cast<int>(entries_.size());)
+		{
+			auto& entry = entries_[i];
+			if (entry.pFence->CompletedValue() < entry.Value)
+			{
+				++i;
+				continue;
+			}
+
+			const auto handle = entry.Handle;
+			pQueue_->Enqueue([handle]() { handle.resume(); });
+			++resumedCount;
+
+			entry = entries_.back();
+			entries_.pop_back();
+		}
+
+		return resumedCount;
+	}
+
+private:
+	struct Entry_
+	{
+		Fence* pFence;
+		uint64_t Value;
+		CoroutineHandle<> Handle;
+	};
+
+	TaskQueue* pQueue_ = nullptr;
+	std::vector<Entry_> entries_;
+	std::mutex lock_;
+
+	void Add_(Fence* pFence, uint64_t value, CoroutineHandle<> handle)
+	{
+		std::unique_lock<std::mutex> lk(lock_);
+		entries_.push_back({ pFence, value, handle });
+	}
+};
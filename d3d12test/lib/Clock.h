@@ -0,0 +1,140 @@
+#pragma once
+#include <chrono>
+#include <thread>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <intrin.h>
+#elif defined(__linux__)
+#include <time.h>
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CLOCK_HAS_TSC 1
+#else
+#define CLOCK_HAS_TSC 0
+#endif
+
+// monotonic tick source for stopwatches and profilers
+// reads the TSC directly when the CPU reports an invariant one (calibrated once, on first use);
+// otherwise QueryPerformanceCounter on Windows, clock_gettime(CLOCK_MONOTONIC_RAW) on Linux
+class Clock
+{
+public:
+	static long long Ticks()
+	{
+		return State_().IsTsc ? ReadTsc_() : ReadReference_();
+	}
+
+	static long long Frequency() { return State_().Frequency; }
+	static bool IsTscBased() { return State_().IsTsc; }
+
+	static double TicksToMilliseconds(long long ticks)
+	{
+		return ticks * 1000.0 / State_().Frequency;
+	}
+
+private:
+	struct Calibration_
+	{
+		bool IsTsc;
+		long long Frequency;	// ticks per second
+	};
+
+	static const Calibration_& State_()
+	{
+		static const Calibration_ state = Calibrate_();
+		return state;
+	}
+
+	static bool HasInvariantTsc_()
+	{
+#if defined(_WIN32) && CLOCK_HAS_TSC
+		int info[4];
+		__cpuid(info, 0x80000000);
+		if (static_cast<unsigned int>(info[0]) < 0x80000007U)
+		{
+			return false;
+		}
+		__cpuid(info, 0x80000007);
+		return (info[3] & (1 << 8)) != 0;
+#elif CLOCK_HAS_TSC
+		unsigned int eax, ebx, ecx, edx;
+		if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0)
+		{
+			return false;
+		}
+		return (edx & (1U << 8)) != 0;
+#else
+		return false;
+#endif
+	}
+
+	static long long ReadTsc_()
+	{
+#if CLOCK_HAS_TSC
+		return static_cast<long long>(__rdtsc());
+#else
+		return 0;
+#endif
+	}
+
+	static long long ReferenceFrequency_()
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return frequency.QuadPart;
+#elif defined(__linux__)
+		return 1000000000LL;
+#else
+		typedef std::chrono::steady_clock::period Period;
+		return Period::den / Period::num;
+#endif
+	}
+
+	static long long ReadReference_()
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return counter.QuadPart;
+#elif defined(__linux__)
+		timespec time;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+		return time.tv_sec * 1000000000LL + time.tv_nsec;
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	static Calibration_ Calibrate_()
+	{
+		const auto referenceFrequency = ReferenceFrequency_();
+
+		if (!HasInvariantTsc_())
+		{
+			return{ false, referenceFrequency };
+		}
+
+		// ~20ms against the reference clock gives the TSC rate to well under 0.1%
+		const auto referenceBegin = ReadReference_();
+		const auto tscBegin = ReadTsc_();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		const auto referenceEnd = ReadReference_();
+		const auto tscEnd = ReadTsc_();
+
+		const auto seconds = static_cast<double>(referenceEnd - referenceBegin) / referenceFrequency;
+		if (seconds <= 0.0 || tscEnd <= tscBegin)
+		{
+			return{ false, referenceFrequency };
+		}
+
+		return{ true, static_cast<long long>((tscEnd - tscBegin) / seconds) };
+	}
+};
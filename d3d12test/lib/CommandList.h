@@ -1,11 +1,12 @@
 #pragma once
+#include "GraphicsInterface.h"
 #include <d3d12.h>
 #include <vector>
 
 class Device;
 class CommandContainer;
 
-class CommandList
+class CommandList : public ICommandList
 {
 public:
 	enum class SubmitType
@@ -23,7 +24,7 @@ public:
 
 	HRESULT Create(Device* pDevice, SubmitType type, int bufferCount);
 	HRESULT Open(ID3D12PipelineState* pPipelineState, bool swapBuffers = true);
-	void Close();
+	void Close() override;
 
 private:
 	SubmitType type_;
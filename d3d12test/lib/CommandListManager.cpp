@@ -1,6 +1,7 @@
 #include "CommandListManager.h"
 #include "CommandList.h"
-#include "CommandQueue.h"
+#include "AllocTracker.h"
+#include "ExecuteCommandLists.h"
 #include <ctime>
 
 CommandListManager::~CommandListManager()
@@ -88,23 +89,9 @@ void CommandListManager::ClearExecutionOrder(const tstring& name)
 	SetExecutionOrder(-1, name);
 }
 
-void CommandListManager::Execute(CommandQueue* pQueue)
+void CommandListManager::Execute(ICommandQueue* pQueue)
 {
-	auto pNativeQueue = pQueue->NativePtr();
+	ALLOC_SCOPE("command_list");
 
-	for (auto pLists : sortedListPtrs_)
-	{
-		if (pLists->size() == 0)
-		{
-			continue;
-		}
-
-		std::vector<ID3D12CommandList*> tmp(pLists->size());
-		for (auto i = 0; i < tmp.size(); ++i)
-		{
-			tmp[i] = (*pLists)[i]->NativePtr();
-		}
-
-		pNativeQueue->ExecuteCommandLists(static_cast<UINT>(tmp.size()), tmp.data());
-	}
+	ExecuteCommandLists(pQueue, sortedListPtrs_, &executeListPtrs_);
 }
@@ -1,10 +1,10 @@
 #pragma once
 #include "common.h"
+#include "GraphicsInterface.h"
 #include <map>
 #include <vector>
 
 class CommandList;
-class CommandQueue;
 
 class CommandListManager
 {
@@ -19,7 +19,7 @@ public:
 	bool SetExecutionOrder(int order, const tstring& name);
 	void ClearExecutionOrder(const tstring& name);
 
-	void Execute(CommandQueue* pQueue);
+	void Execute(ICommandQueue* pQueue);
 
 private:
 	std::map<tstring, int> hashes_;
@@ -27,5 +27,6 @@ private:
 	std::map<int, std::vector<CommandList*>> commandLists_;
 
 	std::vector<std::vector<CommandList*>*> sortedListPtrs_;
+	std::vector<ICommandList*> executeListPtrs_;
 };
 
@@ -41,7 +41,17 @@ void CommandQueue::Submit(CommandList* pCommandList)
 	pCommandQueue_->ExecuteCommandLists(1, ppCmdLists);
 }
 
-HRESULT CommandQueue::WaitForExecution()
+void CommandQueue::Execute(ICommandList* const* pListPtrs, int count)
+{
+	executeListPtrs_.resize(count);
+	for (auto i = 0; i < count; ++i)
+	{
+		executeListPtrs_[i] = static_cast<CommandList*>(pListPtrs[i])->NativePtr();
+	}
+	pCommandQueue_->ExecuteCommandLists(static_cast<UINT>(count), executeListPtrs_.data());
+}
+
+HRESULT CommandQueue::Signal(UINT64* pFenceValue)
 {
 	HRESULT result;
 
@@ -53,6 +63,31 @@ HRESULT CommandQueue::WaitForExecution()
 		return result;
 	}
 
+	if (pFenceValue != nullptr)
+	{
+		*pFenceValue = pGpuFence_->CurrentValue();
+	}
+
+	return result;
+}
+
+uint64_t CommandQueue::Signal()
+{
+	UINT64 fenceValue = 0;
+	Signal(&fenceValue);
+	return fenceValue;
+}
+
+HRESULT CommandQueue::WaitForExecution()
+{
+	HRESULT result;
+
+	result = Signal(nullptr);
+	if (FAILED(result))
+	{
+		return result;
+	}
+
 	result = pGpuFence_->WaitForCompletion();
 	if (FAILED(result))
 	{
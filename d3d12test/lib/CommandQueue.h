@@ -1,25 +1,37 @@
 #pragma once
+#include "GraphicsInterface.h"
+#include "GpuFence.h"
 #include <d3d12.h>
+#include <vector>
 
 class Device;
-class GpuFence;
 class CommandList;
 
-class CommandQueue
+class CommandQueue : public ICommandQueue
 {
 public:
 	~CommandQueue();
 
 	ID3D12CommandQueue* NativePtr() { return pCommandQueue_; }
+	GpuFence* FencePtr() override { return pGpuFence_; }
 
 	HRESULT Create(Device* pDevice);
 
 	void Submit(CommandList* pCommandList);
 
+	// CommandLists only
+	void Execute(ICommandList* const* pListPtrs, int count) override;
+
+	// signals the next fence value after everything submitted so far, without waiting for it
+	HRESULT Signal(UINT64* pFenceValue);
+	uint64_t Signal() override;
 	HRESULT WaitForExecution();
 
 private:
 	ID3D12CommandQueue* pCommandQueue_ = nullptr;
 	GpuFence* pGpuFence_ = nullptr;
+
+	// reused across Execute() calls
+	std::vector<ID3D12CommandList*> executeListPtrs_;
 };
 
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+// row-by-row copy between two pitched layouts (upload heaps, subresource data)
+// when neither side is padded a slice is one contiguous block and is copied in one go
+inline void CopyRows(
+	void* pDest, size_t destRowPitch, size_t destSlicePitch,
+	const void* pSource, size_t sourceRowPitch, size_t sourceSlicePitch,
+	size_t rowSizeInBytes, int rowCount, int sliceCount)
+{
+	const auto isContiguous = (destRowPitch == rowSizeInBytes && sourceRowPitch == rowSizeInBytes);
+
+	for (auto i = 0; i < sliceCount; ++i)
+	{
+		auto pDestSlice = static_cast<unsigned char*>(pDest) + destSlicePitch * i;
+		const auto pSourceSlice = static_cast<const unsigned char*>(pSource) + sourceSlicePitch * i;
+
+		if (isContiguous)
+		{
+			memcpy(pDestSlice, pSourceSlice, rowSizeInBytes * rowCount);
+			continue;
+		}
+
+		for (auto j = 0; j < rowCount; ++j)
+		{
+			memcpy(pDestSlice + destRowPitch * j, pSourceSlice + sourceRowPitch * j, rowSizeInBytes);
+		}
+	}
+}
@@ -0,0 +1,559 @@
+#pragma once
+#include "Clock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// static descriptor of a profiled scope; one per CPU_PROFILE_SCOPE() site
+struct CpuProfileZone
+{
+	const char* Name;
+};
+
+// hierarchical scoped CPU profiler
+// every thread writes finished zones into its own ring without locking;
+// EndFrame() (from the frame loop thread) collects them and Dump() prints per-frame averages as a tree
+// the last few frames can also be kept as a timeline and written as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev), on request or automatically when a frame spikes
+class CpuProfiler
+{
+public:
+	static CpuProfiler& Instance()
+	{
+		static CpuProfiler profiler;
+		return profiler;
+	}
+
+	static long long Ticks() { return Clock::Ticks(); }
+	static double TicksToMilliseconds(long long ticks) { return Clock::TicksToMilliseconds(ticks); }
+
+	int FrameCount() { return frameCount_; }
+
+	// keeps the timeline of the last frameCount frames for WriteTrace(); 0 (default) turns it off
+	void SetTraceFrameCount(int frameCount)
+	{
+		std::unique_lock<std::mutex> lk(buffersLock_);
+		traceFrames_.clear();
+		traceFrames_.resize(frameCount);
+		tracedFrameCount_ = 0;
+	}
+
+	// writes <filePrefix><frame number>.json whenever a frame takes longer than milliseconds;
+	// after a dump the ring has to fill up again before the next one. 0 turns it off
+	void SetSpikeTrigger(double milliseconds, const std::string& filePrefix)
+	{
+		std::unique_lock<std::mutex> lk(buffersLock_);
+		spikeThreshold_ = milliseconds;
+		spikeFilePrefix_ = filePrefix;
+	}
+
+	// the timeline is copied under the lock and written after it, so threads registering
+	// or naming themselves don't wait for the file
+	bool WriteTrace(const std::string& filepath)
+	{
+		std::unique_lock<std::mutex> writeLock(traceWriteLock_);
+		{
+			std::unique_lock<std::mutex> lk(buffersLock_);
+			SnapshotTrace_(&traceSnapshot_);
+		}
+		return WriteTrace_(filepath, traceSnapshot_);
+	}
+
+	// the calling thread's index and innermost open zone (0 outside any), as Dump() keys its zones
+	void CurrentZone(int* pThreadIndex, uint64_t* pPath)
+	{
+		auto pBuffer = CurrentBuffer_();
+		*pThreadIndex = pBuffer->Index;
+		*pPath = (pBuffer->Depth > 0) ? pBuffer->OpenZones[pBuffer->Depth - 1].Path : 0ULL;
+	}
+
+	// GPU time of work recorded while the zone (threadIndex, path) was open; Dump() shows it on that zone's line,
+	// averaged over the GPU frames counted by EndGpuFrame() since they are read back a few frames late
+	void AddGpuTime(int threadIndex, uint64_t path, double milliseconds)
+	{
+		std::unique_lock<std::mutex> lk(buffersLock_);
+		if (path == 0ULL)
+		{
+			gpuOutsideMilliseconds_ += milliseconds;
+			return;
+		}
+
+		// the CPU side of the zone may not have been collected since the last Reset() yet; EndFrame() names it
+		nodes_[std::make_pair(threadIndex, path)].GpuMilliseconds += milliseconds;
+	}
+
+	void EndGpuFrame()
+	{
+		std::unique_lock<std::mutex> lk(buffersLock_);
+		++gpuFrameCount_;
+	}
+
+	// label for the calling thread in Dump(); threads without one show up as "thread <index>"
+	void SetThreadName(const std::string& name)
+	{
+		auto pBuffer = CurrentBuffer_();
+		std::unique_lock<std::mutex> lk(buffersLock_);
+		pBuffer->Name = name;
+	}
+
+	// for zones that don't fit a scope; CPU_PROFILE_SCOPE() keeps the thread's buffer between the two instead
+	void BeginZone(const CpuProfileZone* pZone) { BeginZone_(CurrentBuffer_(), pZone); }
+	void EndZone() { EndZone_(CurrentBuffer_()); }
+
+	// folds everything recorded since the last call into the current report
+	void EndFrame()
+	{
+		const auto now = Ticks();
+
+		std::unique_lock<std::mutex> lk(buffersLock_);
+
+		const auto frameBegin = (lastFrameEnd_ != 0) ? lastFrameEnd_ : now;
+		lastFrameEnd_ = now;
+
+		TraceFrame_* pTraceFrame = nullptr;
+		if (!traceFrames_.empty())
+		{
+			// vectors keep their capacity, so recording stops allocating after the first lap
+			pTraceFrame = &traceFrames_[tracedFrameCount_ % traceFrames_.size()];
+			pTraceFrame->Number = tracedFrameCount_;
+			pTraceFrame->Begin = frameBegin;
+			pTraceFrame->End = now;
+			pTraceFrame->Events.clear();
+			++tracedFrameCount_;
+		}
+
+		for (auto i = 0; i < static_cast<int>(buffers_.size()); ++i)
+		{
+			auto& buffer = *buffers_[i];
+			const auto head = buffer.Head.load(std::memory_order_acquire);
+
+			// a thread that recorded more than a ring's worth since the last frame loses the oldest zones
+			auto readPos = buffer.ReadPos;
+			if (head - readPos > cEventCapacity / 2)
+			{
+				readPos = head - cEventCapacity / 2;
+			}
+
+			for (; readPos < head; ++readPos)
+			{
+				const auto& event = buffer.Events[readPos & (cEventCapacity - 1)];
+
+				auto& node = nodes_[std::make_pair(i, event.Path)];
+				if (node.CallCount == 0)
+				{
+					node.Name = event.pZone->Name;
+					node.ParentPath = event.ParentPath;
+					node.Depth = event.Depth;
+					node.Order = nextOrder_++;
+				}
+				node.Ticks += event.End - event.Begin;
+				++node.CallCount;
+
+				if (pTraceFrame != nullptr)
+				{
+					const TraceEvent_ traceEvent = { event.pZone->Name, i, event.Begin, event.End };
+					pTraceFrame->Events.push_back(traceEvent);
+				}
+			}
+			buffer.ReadPos = head;
+		}
+
+		++frameCount_;
+
+		if (pTraceFrame != nullptr && spikeThreshold_ > 0.0)
+		{
+			++framesSinceSpike_;
+			if (TicksToMilliseconds(now - frameBegin) > spikeThreshold_
+				&& framesSinceSpike_ >= static_cast<long long>(traceFrames_.size()))
+			{
+				const auto filepath = spikeFilePrefix_ + std::to_string(pTraceFrame->Number) + ".json";
+				framesSinceSpike_ = 0;
+
+				lk.unlock();
+				WriteTrace(filepath);
+			}
+		}
+	}
+
+	void Reset()
+	{
+		std::unique_lock<std::mutex> lk(buffersLock_);
+		nodes_.clear();
+		nextOrder_ = 0;
+		frameCount_ = 0;
+		gpuFrameCount_ = 0;
+		gpuOutsideMilliseconds_ = 0.0;
+	}
+
+	// prints per-frame averages since Reset()
+	void Dump()
+	{
+		std::unique_lock<std::mutex> lk(buffersLock_);
+
+		if (frameCount_ == 0)
+		{
+			return;
+		}
+
+		printf("===[CPU]=====\n");
+		for (auto i = 0; i < static_cast<int>(buffers_.size()); ++i)
+		{
+			std::vector<std::pair<int, uint64_t>> roots;
+			for (const auto& item : nodes_)
+			{
+				if (item.first.first == i && item.second.ParentPath == 0ULL && item.second.CallCount > 0)
+				{
+					roots.push_back(item.first);
+				}
+			}
+			if (roots.empty())
+			{
+				continue;
+			}
+
+			if (buffers_[i]->Name.empty())
+			{
+				printf("[thread %d]\n", i);
+			}
+			else
+			{
+				printf("[%s]\n", buffers_[i]->Name.c_str());
+			}
+
+			SortByOrder_(&roots);
+			for (const auto& key : roots)
+			{
+				DumpNode_(key);
+			}
+		}
+
+		if (gpuOutsideMilliseconds_ > 0.0 && gpuFrameCount_ > 0)
+		{
+			printf("%-32s gpu %8.3f ms\n", "(gpu outside any zone)", gpuOutsideMilliseconds_ / gpuFrameCount_);
+		}
+	}
+
+private:
+	static const int cEventCapacity = 1 << 14;
+	static const int cMaxDepth = 32;
+
+	struct Event_
+	{
+		const CpuProfileZone* pZone;
+		uint64_t Path;
+		uint64_t ParentPath;
+		int Depth;
+		long long Begin;
+		long long End;
+	};
+
+	struct OpenZone_
+	{
+		const CpuProfileZone* pZone;
+		uint64_t Path;
+		uint64_t ParentPath;
+		long long Begin;
+	};
+
+	struct ThreadBuffer_
+	{
+		std::string Name;
+		int Index = 0;
+		OpenZone_ OpenZones[cMaxDepth];
+		int Depth = 0;
+		int OverflowDepth = 0; // zones nested deeper than cMaxDepth are not recorded
+
+		std::unique_ptr<Event_[]> Events{ new Event_[cEventCapacity] };
+		std::atomic<unsigned long long> Head{ 0ULL };	// written by the owning thread only
+		unsigned long long ReadPos = 0ULL;				// EndFrame() only
+	};
+
+	struct Node_
+	{
+		const char* Name = nullptr;
+		uint64_t ParentPath = 0ULL;
+		int Depth = 0;
+		int Order = 0;
+		long long Ticks = 0;
+		int CallCount = 0;
+		double GpuMilliseconds = 0.0;
+	};
+
+	// buffers are never freed, so a zone can still be collected after its thread has exited
+	std::vector<std::unique_ptr<ThreadBuffer_>> buffers_;
+	std::mutex buffersLock_;
+
+	struct TraceEvent_
+	{
+		const char* Name;
+		int ThreadIndex;
+		long long Begin;
+		long long End;
+	};
+
+	struct TraceFrame_
+	{
+		long long Number = 0;
+		long long Begin = 0;
+		long long End = 0;
+		std::vector<TraceEvent_> Events;
+	};
+
+	// what WriteTrace() writes, oldest frame first
+	struct TraceSnapshot_
+	{
+		std::vector<std::string> ThreadNames;
+		std::vector<TraceFrame_> Frames;
+	};
+
+	std::map<std::pair<int, uint64_t>, Node_> nodes_;
+	int nextOrder_ = 0;
+	int frameCount_ = 0;
+	int gpuFrameCount_ = 0;
+	double gpuOutsideMilliseconds_ = 0.0;
+
+	std::vector<TraceFrame_> traceFrames_;
+	long long tracedFrameCount_ = 0;
+	long long lastFrameEnd_ = 0;
+
+	double spikeThreshold_ = 0.0;
+	std::string spikeFilePrefix_;
+	long long framesSinceSpike_ = 0;
+
+	// reused between writes, so its vectors keep their capacity
+	TraceSnapshot_ traceSnapshot_;
+	std::mutex traceWriteLock_;
+
+	CpuProfiler() {}
+
+	friend class CpuProfileScope;
+
+	// static, so a zone doesn't go through Instance(); the profiler is only needed to register a new thread
+	static ThreadBuffer_* CurrentBuffer_()
+	{
+		static thread_local ThreadBuffer_* pBuffer = nullptr;
+		if (pBuffer == nullptr)
+		{
+			pBuffer = Instance().AddBuffer_();
+		}
+		return pBuffer;
+	}
+
+	ThreadBuffer_* AddBuffer_()
+	{
+		std::unique_lock<std::mutex> lk(buffersLock_);
+		buffers_.emplace_back(new ThreadBuffer_());
+		auto pBuffer = buffers_.back().get();
+		pBuffer->Index = static_cast<int>(buffers_.size()) - 1;
+		return pBuffer;
+	}
+
+	static void BeginZone_(ThreadBuffer_* pBuffer, const CpuProfileZone* pZone)
+	{
+		if (pBuffer->Depth == cMaxDepth)
+		{
+			++pBuffer->OverflowDepth;
+			return;
+		}
+
+		auto& open = pBuffer->OpenZones[pBuffer->Depth];
+
+		// a path identifies the zone together with all of its parents
+		const auto parentPath = (pBuffer->Depth > 0) ? pBuffer->OpenZones[pBuffer->Depth - 1].Path : 0ULL;
+		open.pZone = pZone;
+		open.ParentPath = parentPath;
+		open.Path = (parentPath ^ reinterpret_cast<uintptr_t>(pZone)) * 0x100000001B3ULL;
+
+		++pBuffer->Depth;
+		open.Begin = Ticks();
+	}
+
+	static void EndZone_(ThreadBuffer_* pBuffer)
+	{
+		const auto end = Ticks();
+
+		if (pBuffer->OverflowDepth > 0)
+		{
+			--pBuffer->OverflowDepth;
+			return;
+		}
+
+		--pBuffer->Depth;
+		const auto& open = pBuffer->OpenZones[pBuffer->Depth];
+
+		const auto head = pBuffer->Head.load(std::memory_order_relaxed);
+		auto& event = pBuffer->Events[head & (cEventCapacity - 1)];
+		event.pZone = open.pZone;
+		event.Path = open.Path;
+		event.ParentPath = open.ParentPath;
+		event.Depth = pBuffer->Depth;
+		event.Begin = open.Begin;
+		event.End = end;
+		pBuffer->Head.store(head + 1, std::memory_order_release);
+	}
+
+	static void WriteJsonString_(std::ofstream& stream, const std::string& text)
+	{
+		stream << '"';
+		for (auto c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				stream << '\\';
+			}
+			stream << c;
+		}
+		stream << '"';
+	}
+
+	// buffersLock_ has to be held
+	void SnapshotTrace_(TraceSnapshot_* pSnapshot)
+	{
+		pSnapshot->ThreadNames.resize(buffers_.size());
+		for (auto i = 0; i < static_cast<int>(buffers_.size()); ++i)
+		{
+			const auto& name = buffers_[i]->Name;
+			pSnapshot->ThreadNames[i] = name.empty() ? "thread " + std::to_string(i) : name;
+		}
+
+		const auto frameCount = static_cast<int>(std::min<long long>(tracedFrameCount_, traceFrames_.size()));
+		const auto firstSlot = (frameCount > 0) ? static_cast<int>((tracedFrameCount_ - frameCount) % traceFrames_.size()) : 0;
+
+		pSnapshot->Frames.resize(frameCount);
+		for (auto i = 0; i < frameCount; ++i)
+		{
+			const auto& frame = traceFrames_[(firstSlot + i) % traceFrames_.size()];
+			auto& copy = pSnapshot->Frames[i];
+			copy.Number = frame.Number;
+			copy.Begin = frame.Begin;
+			copy.End = frame.End;
+			copy.Events.assign(frame.Events.begin(), frame.Events.end());
+		}
+	}
+
+	// Chrome Trace Event format: one complete ("X") event per zone, one process, one track per thread
+	static bool WriteTrace_(const std::string& filepath, const TraceSnapshot_& snapshot)
+	{
+		if (snapshot.Frames.empty())
+		{
+			return false;
+		}
+
+		std::ofstream stream(filepath);
+		if (!stream)
+		{
+			return false;
+		}
+
+		const auto origin = snapshot.Frames.front().Begin;
+		const auto toMicroseconds = [origin](long long ticks) { return TicksToMilliseconds(ticks - origin) * 1000.0; };
+
+		stream.setf(std::ios::fixed);
+		stream.precision(3);
+		stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+		stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"d3d12test\"}}";
+		for (auto i = 0; i < static_cast<int>(snapshot.ThreadNames.size()); ++i)
+		{
+			stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":";
+			WriteJsonString_(stream, snapshot.ThreadNames[i]);
+			stream << "}}";
+		}
+
+		for (const auto& frame : snapshot.Frames)
+		{
+			// frames get their own track above the threads
+			stream << ",\n{\"name\":\"frame " << frame.Number << "\",\"ph\":\"X\",\"pid\":0,\"tid\":-1"
+				<< ",\"ts\":" << toMicroseconds(frame.Begin)
+				<< ",\"dur\":" << toMicroseconds(frame.End) - toMicroseconds(frame.Begin) << "}";
+
+			for (const auto& event : frame.Events)
+			{
+				stream << ",\n{\"name\":";
+				WriteJsonString_(stream, event.Name);
+				stream << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.ThreadIndex
+					<< ",\"ts\":" << toMicroseconds(event.Begin)
+					<< ",\"dur\":" << toMicroseconds(event.End) - toMicroseconds(event.Begin) << "}";
+			}
+		}
+
+		stream << "\n]}\n";
+		return static_cast<bool>(stream);
+	}
+
+	void SortByOrder_(std::vector<std::pair<int, uint64_t>>* pKeys)
+	{
+		std::sort(pKeys->begin(), pKeys->end(), [this](const std::pair<int, uint64_t>& lhs, const std::pair<int, uint64_t>& rhs)
+		{
+			return nodes_[lhs].Order < nodes_[rhs].Order;
+		});
+	}
+
+	void DumpNode_(const std::pair<int, uint64_t>& key)
+	{
+		const auto& node = nodes_[key];
+		printf(
+			"%*s%-*s %8.3f ms %6.1f calls",
+			node.Depth * 2, "", 32 - node.Depth * 2, node.Name,
+			TicksToMilliseconds(node.Ticks) / frameCount_,
+			static_cast<double>(node.CallCount) / frameCount_);
+		if (node.GpuMilliseconds > 0.0 && gpuFrameCount_ > 0)
+		{
+			printf(" gpu %8.3f ms", node.GpuMilliseconds / gpuFrameCount_);
+		}
+		printf("\n");
+
+		std::vector<std::pair<int, uint64_t>> children;
+		for (const auto& item : nodes_)
+		{
+			if (item.first.first == key.first && item.second.ParentPath == key.second && item.second.CallCount > 0)
+			{
+				children.push_back(item.first);
+			}
+		}
+
+		SortByOrder_(&children);
+		for (const auto& child : children)
+		{
+			DumpNode_(child);
+		}
+	}
+};
+
+// the thread's buffer is looked up once, in the constructor, and handed to the end of the zone
+class CpuProfileScope
+{
+public:
+	explicit CpuProfileScope(const CpuProfileZone* pZone)
+		: pBuffer_(CpuProfiler::CurrentBuffer_())
+	{
+		CpuProfiler::BeginZone_(pBuffer_, pZone);
+	}
+
+	~CpuProfileScope()
+	{
+		CpuProfiler::EndZone_(pBuffer_);
+	}
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+	CpuProfiler::ThreadBuffer_* pBuffer_;
+};
+
+#define CPU_PROFILE_CONCAT_(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_(a, b)
+
+// times the enclosing scope under name (a string literal)
+#define CPU_PROFILE_SCOPE(name) \
+	static const CpuProfileZone CPU_PROFILE_CONCAT(cpuProfileZone_, __LINE__) = { name }; \
+	CpuProfileScope CPU_PROFILE_CONCAT(cpuProfileScope_, __LINE__)(&CPU_PROFILE_CONCAT(cpuProfileZone_, __LINE__))
@@ -1,44 +1,37 @@
 #pragma once
-#include "common.h"
-#include <Windows.h>
+#include "Clock.h"
+#include <string>
 
 class CpuStopwatch
 {
 public:
-	CpuStopwatch()
-	{
-		QueryPerformanceFrequency(&frequency_);
-	}
-
-	void SetName(const tstring& name) { name_ = name; }
-	const tstring& Name() { return name_; }
+	void SetName(const std::string& name) { name_ = name; }
+	const std::string& Name() { return name_; }
 
 	void Start()
 	{
-		end_.QuadPart = 0ULL;
-		QueryPerformanceCounter(&begin_);
+		end_ = 0LL;
+		begin_ = Clock::Ticks();
 	}
 
 	void Stop()
 	{
-		QueryPerformanceCounter(&end_);
+		end_ = Clock::Ticks();
 	}
 
 	void Reset()
 	{
-		begin_.QuadPart = 0ULL;
-		end_.QuadPart = 0ULL;
+		begin_ = 0LL;
+		end_ = 0LL;
 	}
 
 	double ElaspedMilliseconds()
 	{
-		return (end_.QuadPart - begin_.QuadPart) * 1000.0 / frequency_.QuadPart;
+		return Clock::TicksToMilliseconds(end_ - begin_);
 	}
 
 private:
-	tstring name_;
-	LARGE_INTEGER begin_;
-	LARGE_INTEGER end_;
-	LARGE_INTEGER frequency_;
+	std::string name_;
+	long long begin_ = 0LL;
+	long long end_ = 0LL;
 };
-
@@ -0,0 +1,28 @@
+#pragma once
+#include "GraphicsInterface.h"
+#include <cstddef>
+#include <vector>
+
+// submits each group of lists in execution order as one ExecuteCommandLists call, skipping empty groups
+// pExecuteListPtrs is scratch kept by the caller across frames; it grows only when a group gets larger
+template<class List>
+inline void ExecuteCommandLists(
+	ICommandQueue* pQueue, const std::vector<std::vector<List*>*>& groupPtrs, std::vector<ICommandList*>* pExecuteListPtrs)
+{
+	auto& listPtrs = *pExecuteListPtrs;
+	for (auto pGroup : groupPtrs)
+	{
+		if (pGroup->empty())
+		{
+			continue;
+		}
+
+		listPtrs.resize(pGroup->size());
+		for (size_t i = 0; i < listPtrs.size(); ++i)
+		{
+			listPtrs[i] = (*pGroup)[i];
+		}
+
+		pQueue->Execute(listPtrs.data(), static_cast<int>(listPtrs.size()));
+	}
+}
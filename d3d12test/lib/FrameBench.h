@@ -0,0 +1,568 @@
+#pragma once
+#include "Camera.h"
+#include "Clock.h"
+#include "CpuProfiler.h"
+#include "FrameCapture.h"
+#include "LatencyHistogram.h"
+#include "MatrixMath.h"
+#include "NullGraphics.h"
+#include "Quaternion.h"
+#include "SceneGraph.h"
+#include "TaskQueue.h"
+#include "TaskGroup.h"
+#include "TaskGraph.h"
+#include "Transform.h"
+#include "TransformStore.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+struct FrameBenchDesc
+{
+	int ModelGridSize;			// ModelGridSize^3 models, like cModelGridSize
+	int MeshCountPerModel;
+	int ShaderCount;			// distinct pipeline states; models are sorted by shader like the real scene
+	int AnimationFrameCount;	// animation keys per mesh
+	int ThreadCount;
+	TaskQueue::Mode QueueMode;
+	int WarmupFrameCount;
+	int FrameCount;
+};
+
+// the app's frame loop, headless on the null graphics backend
+// Calc() and Draw() run stage by stage (frame graph of camera/transform/cbuffer jobs, main list recording,
+// submit) against NullCommandList/NullCommandQueue and CPU-side cbuffers, so the CPU cost of a frame can be
+// measured without a window or a D3D12 device; the camera job is the app's Camera and UpdateCameraBuffer(),
+// meshes are placed with Model::SetTransform()'s MeshWorldMatrix(), and submitting goes through the same
+// ICommandQueue/IFence calls as the D3D12 queue
+// model bundles are recorded once in Setup() like CreateModelCommand(), frames only execute them
+// with SetReplay() the camera, transforms and animation frames come from a capture of the app instead
+class FrameBench
+{
+public:
+	enum class Stage
+	{
+		Calc,			// frame graph issue
+		RecordMain,
+		WaitFrameGraph,
+		Submit,
+		Frame,
+		Count,
+	};
+
+	static const char* StageName(Stage stage)
+	{
+		static const char* names[] = { "calc", "record_main", "wait_frame_graph", "submit", "frame" };
+		static_assert(sizeof(names) / sizeof(names[0]) == static_cast<int>(Stage::Count), "StageName");
+		return names[static_cast<int>(stage)];
+	}
+
+	static FrameBenchDesc DefaultDesc(int modelGridSize, int threadCount)
+	{
+		FrameBenchDesc desc;
+		desc.ModelGridSize = modelGridSize;
+		desc.MeshCountPerModel = 1;
+		desc.ShaderCount = 1;
+		desc.AnimationFrameCount = 60;
+		desc.ThreadCount = threadCount;
+		desc.QueueMode = TaskQueue::Mode::WorkStealing;
+		desc.WarmupFrameCount = 60;
+		desc.FrameCount = 600;
+		return desc;
+	}
+
+	~FrameBench()
+	{
+		frameGraph_.Clear();
+	}
+
+	void Setup(const FrameBenchDesc& desc)
+	{
+		desc_ = desc;
+
+		auto queueDesc = TaskQueue::DefaultDesc(desc.ThreadCount, desc.QueueMode);
+		queueDesc.Name = "frame_bench";
+		taskQueue_.Setup(queueDesc);
+
+		const auto modelCount = desc.ModelGridSize * desc.ModelGridSize * desc.ModelGridSize;
+		models_.resize(modelCount);
+		transforms_.Reserve(modelCount);
+		for (auto i = 0; i < desc.ModelGridSize; ++i)
+		{
+			for (auto j = 0; j < desc.ModelGridSize; ++j)
+			{
+				for (auto k = 0; k < desc.ModelGridSize; ++k)
+				{
+					const auto index = i * desc.ModelGridSize * desc.ModelGridSize + j * desc.ModelGridSize + k;
+					auto& model = models_[index];
+					model.Transform = transforms_.Add();
+					transforms_.SetTranslation(model.Transform, -2.0f + i * 0.3f, -2.0f + j * 0.3f, -1.0f + k * 0.3f);
+					model.Shader = static_cast<uint64_t>(index % std::max(1, desc.ShaderCount)) + 1;
+					model.FirstMesh = index * desc.MeshCountPerModel;
+				}
+			}
+		}
+		std::stable_sort(models_.begin(), models_.end(), [](const Model_& lhs, const Model_& rhs) { return lhs.Shader < rhs.Shader; });
+
+		const auto meshCount = modelCount * desc.MeshCountPerModel;
+		meshes_.resize(meshCount);
+		for (auto i = 0; i < meshCount; ++i)
+		{
+			meshes_[i].AnimationFrame = i % std::max(1, desc.AnimationFrameCount);
+		}
+
+		// fbx::Model::AttachToSceneGraph(): one node per model
+		sceneGraph_.Reserve(modelCount);
+		for (auto& model : models_)
+		{
+			model.Node = sceneGraph_.Add();
+		}
+
+		// one key track shared by every mesh, each starting at a different frame
+		animation_.resize(std::max(1, desc.AnimationFrameCount));
+		for (auto i = 0; i < static_cast<int>(animation_.size()); ++i)
+		{
+			const auto angle = 6.2831853f * i / animation_.size();
+			animation_[i] = { { 1.0f, 1.0f, 1.0f }, QuaternionFromEuler(0.0f, angle, 0.0f), { 0.0f, 0.0f, 0.0f } };
+		}
+
+		meshCbuffer_.Create(sizeof(float) * 16, meshCount);
+		cameraCbuffer_.Create(sizeof(CameraBuffer), modelCount);
+
+		BuildFrameGraph_();
+
+		const auto chunkCount = ChunkCount_();
+		bundles_.clear();
+		for (auto i = 0; i < chunkCount; ++i)
+		{
+			bundles_.emplace_back(new NullCommandList(NullCommandList::SubmitType::Bundle));
+		}
+		mainList_.reset(new NullCommandList(NullCommandList::SubmitType::Direct));
+
+		const auto begin = Clock::Ticks();
+		RecordBundles_();
+		bundleMilliseconds_ = Clock::TicksToMilliseconds(Clock::Ticks() - begin);
+	}
+
+	// frames are taken from pReplay (FrameCaptureReader, see main.cpp --capture) until it runs out;
+	// returns false when the capture doesn't match the scene
+	bool SetReplay(FrameCaptureReader* pReplay)
+	{
+		if (pReplay->TransformCount() != ModelCount() || pReplay->AnimationFrameCount() != static_cast<int>(meshes_.size()))
+		{
+			return false;
+		}
+
+		pReplay_ = pReplay;
+		desc_.WarmupFrameCount = std::min(desc_.WarmupFrameCount, pReplay->FrameCount() / 2);
+		desc_.FrameCount = pReplay->FrameCount() - desc_.WarmupFrameCount;
+		return true;
+	}
+
+	// returns false when the recorded command stream changed between frames
+	bool Run()
+	{
+		auto& profiler = CpuProfiler::Instance();
+
+		for (auto& histogram : histograms_)
+		{
+			histogram.Reset();
+		}
+		isDeterministic_ = true;
+		if (pReplay_ != nullptr)
+		{
+			pReplay_->Rewind();
+		}
+
+		const auto totalFrameCount = desc_.WarmupFrameCount + desc_.FrameCount;
+		for (auto i = 0; i < totalFrameCount; ++i)
+		{
+			if (i == desc_.WarmupFrameCount)
+			{
+				commandQueue_.Reset();
+				profiler.Reset();
+				firstHash_ = 0ULL;
+			}
+
+			const auto isMeasured = i >= desc_.WarmupFrameCount;
+			RunFrame_(isMeasured);
+			profiler.EndFrame();
+		}
+		return isDeterministic_;
+	}
+
+	int ModelCount() { return static_cast<int>(models_.size()); }
+	NullCommandQueue* CommandQueuePtr() { return &commandQueue_; }
+	LatencyHistogram* HistogramPtr(Stage stage) { return &histograms_[static_cast<int>(stage)]; }
+	bool IsDeterministic() { return isDeterministic_; }
+
+	// per-stage percentiles and per-frame command counts of the last Run()
+	void Dump()
+	{
+		printf(
+			"===[FRAME BENCH]===== %d models x %d meshes, %d threads, %d frames\n",
+			ModelCount(), desc_.MeshCountPerModel, taskQueue_.ThreadCount(), desc_.FrameCount);
+		printf("%-32s %8.3f ms (setup, once)\n", "record_bundles", bundleMilliseconds_);
+
+		for (auto i = 0; i < static_cast<int>(Stage::Count); ++i)
+		{
+			auto& histogram = histograms_[i];
+			printf(
+				"%-32s avg %8.3f p50 %8.3f p95 %8.3f p99 %8.3f max %8.3f ms\n",
+				StageName(static_cast<Stage>(i)),
+				histogram.Average(), histogram.Percentile(50.0), histogram.Percentile(95.0), histogram.Percentile(99.0), histogram.Max());
+		}
+
+		const auto frameCount = std::max(1, desc_.FrameCount);
+		for (auto i = 0; i < cNullCommandTypeCount; ++i)
+		{
+			const auto count = commandQueue_.CommandCount(static_cast<NullCommandType>(i));
+			if (count > 0)
+			{
+				printf("%-32s %8.1f / frame\n", NullCommandTypeName(static_cast<NullCommandType>(i)), static_cast<double>(count) / frameCount);
+			}
+		}
+		if (!isDeterministic_)
+		{
+			printf("command stream changed between frames\n");
+		}
+	}
+
+private:
+	struct Model_
+	{
+		TransformStore::Handle Transform = 0;
+		SceneGraph::Node Node = SceneGraph::cNoParent;
+		uint64_t Shader = 0ULL;
+		int FirstMesh = 0;
+	};
+
+	// fbx::AnimStack::Key
+	struct AnimationKey_
+	{
+		float Scaling[3];
+		Quaternion Rotation;
+		float Translation[3];
+	};
+
+	struct Mesh_
+	{
+		int AnimationFrame = 0;
+	};
+
+	FrameBenchDesc desc_;
+
+	TaskQueue taskQueue_;
+	TaskGraph frameGraph_;
+
+	std::vector<Model_> models_;
+	TransformStore transforms_;
+	SceneGraph sceneGraph_;
+	std::vector<Mesh_> meshes_;
+	std::vector<AnimationKey_> animation_;
+	float rotateAngle_ = 0.0f;
+	FrameInputCamera cameraInput_ = { { 10.0f, 5.0f, -10.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, cPiDiv4, 1280.0f / 720.0f, 0.1f, 1000.0f };
+	Camera camera_;
+	CameraBuffer cameraBuffer_;
+	FrameCaptureReader* pReplay_ = nullptr;
+
+	NullBuffer meshCbuffer_;
+	NullBuffer cameraCbuffer_;
+
+	std::vector<std::unique_ptr<NullCommandList>> bundles_;
+	std::unique_ptr<NullCommandList> mainList_;
+	NullCommandQueue commandQueue_;
+	double bundleMilliseconds_ = 0.0;
+
+	LatencyHistogram histograms_[static_cast<int>(Stage::Count)];
+	uint64_t firstHash_ = 0ULL;
+	bool isDeterministic_ = true;
+
+	int ChunkCount_()
+	{
+		return std::max(1, std::min(ModelCount(), taskQueue_.ThreadCount() * 4));
+	}
+
+	void RunFrame_(bool isMeasured)
+	{
+		long long ticks[static_cast<int>(Stage::Count)];
+		const auto frameBegin = Clock::Ticks();
+		auto begin = frameBegin;
+		const auto lap = [&ticks, &begin](Stage stage)
+		{
+			const auto now = Clock::Ticks();
+			ticks[static_cast<int>(stage)] = now - begin;
+			begin = now;
+		};
+
+		{
+			CPU_PROFILE_SCOPE("calc");
+			UpdateFrameInput_();
+			frameGraph_.Run(&taskQueue_);
+		}
+		lap(Stage::Calc);
+
+		RecordMain_();
+		lap(Stage::RecordMain);
+
+		{
+			CPU_PROFILE_SCOPE("wait_frame_graph");
+			frameGraph_.Wait();
+		}
+		lap(Stage::WaitFrameGraph);
+
+		{
+			CPU_PROFILE_SCOPE("submit_cmdlist");
+			ICommandQueue* pQueue = &commandQueue_;
+			ICommandList* pList = mainList_.get();
+			pQueue->Execute(&pList, 1);
+			pQueue->FencePtr()->WaitForCompletion(pQueue->Signal());
+		}
+		lap(Stage::Submit);
+
+		ticks[static_cast<int>(Stage::Frame)] = Clock::Ticks() - frameBegin;
+
+		if (!isMeasured)
+		{
+			return;
+		}
+
+		for (auto i = 0; i < static_cast<int>(Stage::Count); ++i)
+		{
+			histograms_[i].Add(Clock::TicksToMilliseconds(ticks[i]));
+		}
+
+		const auto hash = mainList_->Hash() ^ BundleHash_();
+		if (firstHash_ == 0ULL)
+		{
+			firstHash_ = hash;
+		}
+		else if (hash != firstHash_)
+		{
+			isDeterministic_ = false;
+		}
+	}
+
+	// UpdateFrameInput() in main.cpp
+	void UpdateFrameInput_()
+	{
+		const auto pInput = (pReplay_ != nullptr) ? pReplay_->Next() : nullptr;
+		if (pInput == nullptr)
+		{
+			// every model turns, so every transform is dirty
+			rotateAngle_ += 0.01f;
+			const auto rotation = QuaternionFromEuler(0.0f, rotateAngle_, 0.0f);
+			for (const auto& model : models_)
+			{
+				transforms_.SetRotation(model.Transform, rotation);
+			}
+			return;
+		}
+
+		cameraInput_ = pInput->Camera;
+		rotateAngle_ = pInput->RotateAngle;
+		for (auto i = 0; i < ModelCount(); ++i)
+		{
+			const auto& t = pInput->Transforms[i];
+			const auto handle = models_[i].Transform;
+			transforms_.SetScaling(handle, t.Scaling[0], t.Scaling[1], t.Scaling[2]);
+			transforms_.SetRotation(handle, t.Rotation[0], t.Rotation[1], t.Rotation[2]);
+			transforms_.SetTranslation(handle, t.Translation[0], t.Translation[1], t.Translation[2]);
+		}
+		for (auto i = 0; i < static_cast<int>(meshes_.size()); ++i)
+		{
+			meshes_[i].AnimationFrame = pInput->AnimationFrames[i] % static_cast<int>(animation_.size());
+		}
+	}
+
+	// same shape as BuildFrameGraph() in main.cpp
+	void BuildFrameGraph_()
+	{
+		auto& graph = frameGraph_;
+		graph.Clear();
+
+		const auto cameraJob = graph.AddJob([this]()
+		{
+			CPU_PROFILE_SCOPE("camera");
+			UpdateCamera_();
+		});
+
+		const auto modelCount = ModelCount();
+		const auto chunkCount = ChunkCount_();
+
+		// transforms are chunked over the dirty list, cbuffers over the models, so every cbuffer job waits for all of them
+		const auto transformsJob = graph.AddJob([this]()
+		{
+			transforms_.ClearDirty();
+			for (const auto& model : models_)
+			{
+				sceneGraph_.SetLocal(model.Node, transforms_.Matrix(model.Transform));
+			}
+		});
+		for (auto i = 0; i < chunkCount; ++i)
+		{
+			const auto transformJob = graph.AddJob([this, i, chunkCount]()
+			{
+				CPU_PROFILE_SCOPE("transform");
+				const auto dirtyCount = transforms_.DirtyCount();
+				transforms_.UpdateDirtyMatrices(dirtyCount * i / chunkCount, dirtyCount * (i + 1) / chunkCount);
+			});
+			graph.AddDependency(transformJob, transformsJob);
+		}
+
+		sceneGraph_.Prepare();
+		auto levelJob = transformsJob;
+		for (auto level = 0; level < sceneGraph_.LevelCount(); ++level)
+		{
+			const auto levelSize = sceneGraph_.LevelSize(level);
+			const auto levelChunkCount = std::max(1, std::min(chunkCount, levelSize / SceneGraph::cMinParallelLevelSize));
+
+			const auto nextLevelJob = graph.AddJob([]() {});
+			for (auto i = 0; i < levelChunkCount; ++i)
+			{
+				const auto start = levelSize * i / levelChunkCount;
+				const auto end = levelSize * (i + 1) / levelChunkCount;
+
+				const auto job = graph.AddJob([this, level, start, end]()
+				{
+					CPU_PROFILE_SCOPE("scene_graph");
+					sceneGraph_.UpdateLevel(level, start, end);
+				});
+				graph.AddDependency(levelJob, job);
+				graph.AddDependency(job, nextLevelJob);
+			}
+			levelJob = nextLevelJob;
+		}
+
+		const auto sceneGraphJob = graph.AddJob([this]()
+		{
+			sceneGraph_.FinishUpdate();
+		});
+		graph.AddDependency(levelJob, sceneGraphJob);
+
+		for (auto i = 0; i < chunkCount; ++i)
+		{
+			const auto start = modelCount * i / chunkCount;
+			const auto end = modelCount * (i + 1) / chunkCount;
+
+			const auto cbufferJob = graph.AddJob([this, start, end]()
+			{
+				CPU_PROFILE_SCOPE("cbuffer");
+				for (auto j = start; j < end; ++j)
+				{
+					WriteCbuffers_(j);
+				}
+			});
+
+			graph.AddDependency(sceneGraphJob, cbufferJob);
+			graph.AddDependency(cameraJob, cbufferJob);
+		}
+	}
+
+	void UpdateCamera_()
+	{
+		UpdateCameraBuffer(&camera_, cameraInput_, &cameraBuffer_);
+	}
+
+	// Model::SetTransform(): every mesh gets its next animation key, composed (fbx::AnimStack::NextFrame()) and
+	// placed under its model's world matrix, the model the camera
+	void WriteCbuffers_(int modelIndex)
+	{
+		const auto& model = models_[modelIndex];
+		for (auto i = 0; i < desc_.MeshCountPerModel; ++i)
+		{
+			const auto meshIndex = model.FirstMesh + i;
+			auto& mesh = meshes_[meshIndex];
+			const auto& key = animation_[mesh.AnimationFrame];
+			mesh.AnimationFrame = (mesh.AnimationFrame + 1) % static_cast<int>(animation_.size());
+
+			float keyMatrix[16];
+			ComposeMatrix(key.Scaling, key.Rotation, key.Translation, keyMatrix);
+
+			MeshWorldMatrix(keyMatrix, sceneGraph_.World(model.Node), static_cast<float*>(meshCbuffer_.Map(meshIndex)));
+		}
+		*static_cast<CameraBuffer*>(cameraCbuffer_.Map(modelIndex)) = cameraBuffer_;
+	}
+
+	// CreateModelCommand() in main.cpp, one bundle per frame graph chunk, once
+	void RecordBundles_()
+	{
+		CPU_PROFILE_SCOPE("record_bundles");
+
+		const auto modelCount = ModelCount();
+		const auto chunkCount = static_cast<int>(bundles_.size());
+		TaskGroup group;
+
+		taskQueue_.ParallelFor(0, chunkCount, 1, [this, modelCount, chunkCount](int first, int last)
+		{
+			for (auto chunk = first; chunk < last; ++chunk)
+			{
+				auto pList = bundles_[chunk].get();
+				pList->Open();
+				pList->SetDescriptorHeaps(1);
+				pList->SetGraphicsRootSignature(1);
+				pList->IASetPrimitiveTopology(4);
+
+				auto lastShader = 0ULL;
+				const auto start = modelCount * chunk / chunkCount;
+				const auto end = modelCount * (chunk + 1) / chunkCount;
+				for (auto i = start; i < end; ++i)
+				{
+					const auto& model = models_[i];
+					if (lastShader != model.Shader)
+					{
+						pList->SetPipelineState(model.Shader);
+						lastShader = model.Shader;
+					}
+
+					pList->SetGraphicsRootDescriptorTable(1, cameraCbuffer_.GpuVirtualAddress(i));
+					for (auto j = 0; j < desc_.MeshCountPerModel; ++j)
+					{
+						const auto meshIndex = model.FirstMesh + j;
+						pList->SetGraphicsRootDescriptorTable(0, meshCbuffer_.GpuVirtualAddress(meshIndex));
+						pList->IASetVertexBuffers(static_cast<uint64_t>(meshIndex) * 2);
+						pList->IASetIndexBuffer(static_cast<uint64_t>(meshIndex) * 2 + 1);
+						pList->DrawIndexedInstanced(36, 1);
+					}
+				}
+				pList->Close();
+			}
+		}, &group);
+
+		group.Wait();
+	}
+
+	// Draw() in main.cpp up to Close()
+	void RecordMain_()
+	{
+		CPU_PROFILE_SCOPE("record_main");
+
+		auto pList = mainList_.get();
+		pList->Open();
+		pList->SetDescriptorHeaps(1);
+		pList->RSSetViewports(1);
+		pList->RSSetScissorRects(1);
+		pList->ResourceBarrier(1);
+		pList->OMSetRenderTargets(1);
+		pList->ClearRenderTargetView(1);
+		pList->ClearDepthStencilView(2);
+		for (auto& pBundle : bundles_)
+		{
+			pList->ExecuteBundle(pBundle.get());
+		}
+		pList->ResourceBarrier(1);
+		pList->Close();
+	}
+
+	uint64_t BundleHash_()
+	{
+		auto hash = 0ULL;
+		for (auto& pBundle : bundles_)
+		{
+			hash = (hash ^ pBundle->Hash()) * 0x100000001B3ULL;
+		}
+		return hash;
+	}
+};
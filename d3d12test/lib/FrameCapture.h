@@ -0,0 +1,236 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// everything outside the frame graph that decides what a frame computes
+struct FrameInputCamera
+{
+	float Position[3];
+	float Focus[3];
+	float Up[3];
+	float FovY;
+	float Aspect;
+	float NearPlane;
+	float FarPlane;
+};
+
+struct FrameInputTransform
+{
+	float Scaling[3];
+	float Rotation[3];
+	float Translation[3];
+};
+
+struct FrameInput
+{
+	FrameInputCamera Camera;
+	float RotateAngle;
+	std::vector<FrameInputTransform> Transforms;	// one per model, in draw order
+	std::vector<int> AnimationFrames;				// one per mesh, models in draw order
+};
+
+// binary capture file, native (little) endian:
+//   header: "FCAP", version, transform count, animation frame count
+//   frame:  flags, camera, rotate angle, [transforms if cTransformsChanged], animation frames as uint16
+// transforms are written only when they differ from the previous frame, which is most of the file otherwise
+namespace frame_capture_detail
+{
+	const char cMagic[4] = { 'F', 'C', 'A', 'P' };
+	const uint32_t cVersion = 1;
+	const uint8_t cTransformsChanged = 1;
+
+	struct Header
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t TransformCount;
+		uint32_t AnimationFrameCount;
+	};
+}
+
+class FrameCaptureWriter
+{
+public:
+	bool Open(const std::string& filepath)
+	{
+		stream_.close();
+		stream_.clear();
+		stream_.open(filepath, std::ios::binary);
+		isHeaderWritten_ = false;
+		frameCount_ = 0;
+		return static_cast<bool>(stream_);
+	}
+
+	bool IsOpen() { return stream_.is_open(); }
+	int FrameCount() { return frameCount_; }
+
+	// the first frame fixes the transform and animation frame counts; later frames must match
+	bool Write(const FrameInput& input)
+	{
+		namespace detail = frame_capture_detail;
+
+		if (!isHeaderWritten_)
+		{
+			detail::Header header;
+			memcpy(header.Magic, detail::cMagic, sizeof(header.Magic));
+			header.Version = detail::cVersion;
+			header.TransformCount = static_cast<uint32_t>(input.Transforms.size());
+			header.AnimationFrameCount = static_cast<uint32_t>(input.AnimationFrames.size());
+			stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			lastTransforms_ = input.Transforms;
+			animationFrames_.resize(input.AnimationFrames.size());
+			isHeaderWritten_ = true;
+		}
+		else if (input.Transforms.size() != lastTransforms_.size() || input.AnimationFrames.size() != animationFrames_.size())
+		{
+			return false;
+		}
+
+		const auto transformBytes = sizeof(FrameInputTransform) * input.Transforms.size();
+		const auto isChanged = (frameCount_ == 0) || memcmp(input.Transforms.data(), lastTransforms_.data(), transformBytes) != 0;
+
+		const uint8_t flags = isChanged ? detail::cTransformsChanged : 0;
+		stream_.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+		stream_.write(reinterpret_cast<const char*>(&input.Camera), sizeof(input.Camera));
+		stream_.write(reinterpret_cast<const char*>(&input.RotateAngle), sizeof(input.RotateAngle));
+		if (isChanged)
+		{
+			stream_.write(reinterpret_cast<const char*>(input.Transforms.data()), transformBytes);
+			std::copy(input.Transforms.begin(), input.Transforms.end(), lastTransforms_.begin());
+		}
+
+		for (auto i = 0; i < static_cast<int>(input.AnimationFrames.size()); ++i)
+		{
+			animationFrames_[i] = static_cast<uint16_t>(input.AnimationFrames[i]);
+		}
+		stream_.write(reinterpret_cast<const char*>(animationFrames_.data()), sizeof(uint16_t) * animationFrames_.size());
+
+		++frameCount_;
+		return static_cast<bool>(stream_);
+	}
+
+	void Close()
+	{
+		stream_.close();
+	}
+
+private:
+	std::ofstream stream_;
+	bool isHeaderWritten_ = false;
+	int frameCount_ = 0;
+	std::vector<FrameInputTransform> lastTransforms_;
+	std::vector<uint16_t> animationFrames_;
+};
+
+// loads a whole capture up front, so replaying a frame never touches the disk
+class FrameCaptureReader
+{
+public:
+	bool Open(const std::string& filepath)
+	{
+		namespace detail = frame_capture_detail;
+
+		data_.clear();
+		frameOffsets_.clear();
+
+		std::ifstream stream(filepath, std::ios::binary);
+		if (!stream)
+		{
+			return false;
+		}
+		data_.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+		if (data_.size() < sizeof(detail::Header))
+		{
+			return false;
+		}
+		detail::Header header;
+		memcpy(&header, data_.data(), sizeof(header));
+		if (memcmp(header.Magic, detail::cMagic, sizeof(header.Magic)) != 0 || header.Version != detail::cVersion)
+		{
+			return false;
+		}
+
+		frame_.Transforms.resize(header.TransformCount);
+		frame_.AnimationFrames.resize(header.AnimationFrameCount);
+
+		// index the frames; a truncated last frame (capture cut short) is dropped
+		const auto fixedBytes = sizeof(uint8_t) + sizeof(FrameInputCamera) + sizeof(float) + sizeof(uint16_t) * header.AnimationFrameCount;
+		const auto transformBytes = sizeof(FrameInputTransform) * header.TransformCount;
+		auto offset = sizeof(header);
+		while (offset + fixedBytes <= data_.size())
+		{
+			const auto flags = static_cast<uint8_t>(data_[offset]);
+			const auto frameBytes = fixedBytes + ((flags & detail::cTransformsChanged) ? transformBytes : 0);
+			if (offset + frameBytes > data_.size())
+			{
+				break;
+			}
+			frameOffsets_.push_back(offset);
+			offset += frameBytes;
+		}
+
+		Rewind();
+		return !frameOffsets_.empty();
+	}
+
+	bool IsOpen() { return !frameOffsets_.empty(); }
+	int FrameCount() { return static_cast<int>(frameOffsets_.size()); }
+	int TransformCount() { return static_cast<int>(frame_.Transforms.size()); }
+	int AnimationFrameCount() { return static_cast<int>(frame_.AnimationFrames.size()); }
+
+	void Rewind()
+	{
+		nextFrame_ = 0;
+	}
+
+	// the next frame's input, or nullptr after the last one; valid until the next call
+	const FrameInput* Next()
+	{
+		namespace detail = frame_capture_detail;
+
+		if (nextFrame_ >= FrameCount())
+		{
+			return nullptr;
+		}
+
+		auto pData = data_.data() + frameOffsets_[nextFrame_++];
+
+		const auto flags = static_cast<uint8_t>(*pData);
+		pData += sizeof(uint8_t);
+
+		memcpy(&frame_.Camera, pData, sizeof(frame_.Camera));
+		pData += sizeof(frame_.Camera);
+		memcpy(&frame_.RotateAngle, pData, sizeof(frame_.RotateAngle));
+		pData += sizeof(frame_.RotateAngle);
+
+		if (flags & detail::cTransformsChanged)
+		{
+			const auto transformBytes = sizeof(FrameInputTransform) * frame_.Transforms.size();
+			memcpy(frame_.Transforms.data(), pData, transformBytes);
+			pData += transformBytes;
+		}
+
+		for (auto& animationFrame : frame_.AnimationFrames)
+		{
+			uint16_t value;
+			memcpy(&value, pData, sizeof(value));
+			pData += sizeof(value);
+			animationFrame = value;
+		}
+
+		return &frame_;
+	}
+
+private:
+	std::vector<char> data_;
+	std::vector<size_t> frameOffsets_;
+	int nextFrame_ = 0;
+	FrameInput frame_;
+};
@@ -1,47 +1,61 @@
 #pragma once
+#include "Clock.h"
 #include "CpuStopwatch.h"
-#include "GpuStopwatch.h"
+#include "GpuProfiler.h"
+#include "FrameStats.h"
 
 class FrameCounter
 {
 public:
-	FrameCounter(CpuStopwatch* pCpuWatch, GpuStopwatch* pGpuWatch)
-		: pCpuWatch_(pCpuWatch), pGpuWatch_(pGpuWatch)
+	FrameCounter(CpuStopwatch* pCpuWatch, GpuProfiler* pGpuProfiler, int sampleCapacity = FrameStats::cDefaultSampleCapacity)
+		: stats_(sampleCapacity), pCpuWatch_(pCpuWatch), pGpuProfiler_(pGpuProfiler)
 	{}
 
 	CpuStopwatch* CpuWatchPtr() { return pCpuWatch_; }
-	GpuStopwatch* GpuWatchPtr() { return pGpuWatch_; }
+	GpuProfiler* GpuProfilerPtr() { return pGpuProfiler_; }
+	FrameStats* StatsPtr() { return &stats_; }
 
-	int FrameCount() { return frameCount_; }
-	double CpuTime() { return cpuTime_; }
-	double GpuTime() { return gpuTime_; }
+	void SetTargetFrameRate(double frameRate) { stats_.SetTargetFrameRate(frameRate); }
 
-	double AverageCpuTime() { return cpuTime_ / frameCount_; }
-	double AverageGpuTime() { return gpuTime_ / frameCount_; }
+	int FrameCount() { return stats_.FrameCount(); }
+	double CpuTime() { return stats_.CpuTime(); }
+	double GpuTime() { return stats_.GpuTime(); }
 
-	double CpuUtilization(int targetFrameCount) { return AverageCpuTime() * 100.0 / (1000.0 / targetFrameCount); }
-	double GpuUtilization(int targetFrameCount) { return AverageGpuTime() * 100.0 / (1000.0 / targetFrameCount); }
+	double AverageCpuTime() { return stats_.AverageCpuTime(); }
+	double AverageGpuTime() { return stats_.AverageGpuTime(); }
 
+	double MaxCpuTime() { return stats_.MaxCpuTime(); }
+	double CpuTimeStdDev() { return stats_.CpuTimeStdDev(); }
+
+	double CpuTimePercentile(double percentile) { return stats_.CpuTimePercentile(percentile); }
+	double GpuTimePercentile(double percentile) { return stats_.GpuTimePercentile(percentile); }
+
+	double CpuUtilization() { return stats_.CpuUtilization(); }
+	double GpuUtilization() { return stats_.GpuUtilization(); }
+
+	double FrameRate() { return stats_.FrameRate(); }
+	double AverageJitter() { return stats_.AverageJitter(); }
+	int LateFrameCount() { return stats_.LateFrameCount(); }
+
+	// call once a frame after the CPU stopwatch has stopped
 	void NextFrame()
 	{
-		cpuTime_ += pCpuWatch_->ElaspedMilliseconds();
-		gpuTime_ += pGpuWatch_->ElaspedMilliseconds();
-		++frameCount_;
+		const auto now = Clock::Ticks();
+		const auto interval = (lastFrameTicks_ != 0) ? Clock::TicksToMilliseconds(now - lastFrameTicks_) : 0.0;
+		lastFrameTicks_ = now;
+
+		stats_.AddFrame(pCpuWatch_->ElaspedMilliseconds(), pGpuProfiler_->LastFrameMilliseconds(), interval);
 	}
 
 	void Reset()
 	{
-		frameCount_ = 0;
-		cpuTime_ = 0.0;
-		gpuTime_ = 0.0;
+		stats_.Reset();
 	}
 
 private:
-	int frameCount_ = 0;
-	double cpuTime_ = 0.0;
-	double gpuTime_ = 0.0;
+	FrameStats stats_;
+	long long lastFrameTicks_ = 0;
 
 	CpuStopwatch* pCpuWatch_;
-	GpuStopwatch* pGpuWatch_;
+	GpuProfiler* pGpuProfiler_;
 };
-
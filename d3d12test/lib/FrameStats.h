@@ -0,0 +1,142 @@
+#pragma once
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct FrameSample
+{
+	double CpuTime;
+	double GpuTime;
+	double Interval;	// time since the previous frame began, 0 when unknown
+};
+
+// per-frame CPU/GPU time statistics; no graphics or OS dependencies, FrameCounter feeds it
+// keeps the last SampleCapacity() frames in a ring and histograms for percentiles since the last Reset();
+// nothing allocates after construction
+class FrameStats
+{
+public:
+	static const int cDefaultSampleCapacity = 256;
+
+	explicit FrameStats(int sampleCapacity = cDefaultSampleCapacity)
+		: samples_(sampleCapacity)
+	{}
+
+	void SetTargetFrameRate(double frameRate) { targetFrameRate_ = frameRate; }
+	double TargetFrameRate() { return targetFrameRate_; }
+	double TargetFrameTime() { return 1000.0 / targetFrameRate_; }
+
+	int FrameCount() { return frameCount_; }
+	double CpuTime() { return cpuTime_.Sum(); }
+	double GpuTime() { return gpuTime_.Sum(); }
+
+	double AverageCpuTime() { return cpuTime_.Average(); }
+	double AverageGpuTime() { return gpuTime_.Average(); }
+
+	double MaxCpuTime() { return cpuTime_.Max(); }
+	double MaxGpuTime() { return gpuTime_.Max(); }
+	double CpuTimeStdDev()
+	{
+		const auto average = AverageCpuTime();
+		return (frameCount_ > 0) ? std::sqrt(std::max(0.0, cpuTimeSq_ / frameCount_ - average * average)) : 0.0;
+	}
+
+	// percentile in [0, 100], ~3% relative error
+	double CpuTimePercentile(double percentile) { return cpuTime_.Percentile(percentile); }
+	double GpuTimePercentile(double percentile) { return gpuTime_.Percentile(percentile); }
+	double IntervalPercentile(double percentile) { return interval_.Percentile(percentile); }
+
+	LatencyHistogram* CpuHistogramPtr() { return &cpuTime_; }
+	LatencyHistogram* GpuHistogramPtr() { return &gpuTime_; }
+	LatencyHistogram* IntervalHistogramPtr() { return &interval_; }
+
+	double CpuUtilization() { return AverageCpuTime() * 100.0 / TargetFrameTime(); }
+	double GpuUtilization() { return AverageGpuTime() * 100.0 / TargetFrameTime(); }
+
+	// frames actually presented per second, from the measured intervals
+	double FrameRate() { return (interval_.Count() > 0) ? 1000.0 / interval_.Average() : 0.0; }
+
+	// frame pacing: how much each interval differs from the previous one
+	double AverageJitter() { return (jitterCount_ > 0) ? jitterSum_ / jitterCount_ : 0.0; }
+	double MaxJitter() { return maxJitter_; }
+
+	// frames whose interval overshot the target by more than half a frame, i.e. were shown late
+	int LateFrameCount() { return lateFrameCount_; }
+
+	int SampleCapacity() { return static_cast<int>(samples_.size()); }
+	int SampleCount() { return std::min(sampleCount_, SampleCapacity()); }
+
+	// 0 is the most recent frame
+	const FrameSample& Sample(int age)
+	{
+		const auto capacity = SampleCapacity();
+		return samples_[(sampleCount_ - 1 - age) % capacity];
+	}
+
+	void AddFrame(double cpuTime, double gpuTime, double interval = 0.0)
+	{
+		cpuTime_.Add(cpuTime);
+		cpuTimeSq_ += cpuTime * cpuTime;
+		gpuTime_.Add(gpuTime);
+
+		if (interval > 0.0)
+		{
+			interval_.Add(interval);
+			if (interval > TargetFrameTime() * 1.5)
+			{
+				++lateFrameCount_;
+			}
+
+			if (lastInterval_ > 0.0)
+			{
+				const auto jitter = std::abs(interval - lastInterval_);
+				jitterSum_ += jitter;
+				maxJitter_ = std::max(maxJitter_, jitter);
+				++jitterCount_;
+			}
+			lastInterval_ = interval;
+		}
+
+		samples_[sampleCount_ % SampleCapacity()] = { cpuTime, gpuTime, interval };
+		++sampleCount_;
+		if (sampleCount_ >= SampleCapacity() * 2)
+		{
+			sampleCount_ -= SampleCapacity();
+		}
+
+		++frameCount_;
+	}
+
+	// starts a new reporting window; the sample ring and target frame rate are kept
+	void Reset()
+	{
+		frameCount_ = 0;
+		cpuTime_.Reset();
+		cpuTimeSq_ = 0.0;
+		gpuTime_.Reset();
+		interval_.Reset();
+		jitterSum_ = 0.0;
+		maxJitter_ = 0.0;
+		jitterCount_ = 0;
+		lateFrameCount_ = 0;
+	}
+
+private:
+	double targetFrameRate_ = 60.0;
+
+	int frameCount_ = 0;
+	LatencyHistogram cpuTime_;
+	double cpuTimeSq_ = 0.0;
+	LatencyHistogram gpuTime_;
+	LatencyHistogram interval_;
+
+	double lastInterval_ = 0.0;
+	double jitterSum_ = 0.0;
+	double maxJitter_ = 0.0;
+	int jitterCount_ = 0;
+	int lateFrameCount_ = 0;
+
+	std::vector<FrameSample> samples_;
+	int sampleCount_ = 0;
+};
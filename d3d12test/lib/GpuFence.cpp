@@ -1,6 +1,8 @@
 #include "GpuFence.h"
 #include "common.h"
 #include "Device.h"
+#include "Clock.h"
+#include "Metrics.h"
 
 GpuFence::~GpuFence()
 {
@@ -29,17 +31,30 @@ HRESULT GpuFence::Create(Device* pDevice)
 
 HRESULT GpuFence::WaitForCompletion()
 {
+	return WaitForValue_(fenceValue_);
+}
+
+HRESULT GpuFence::WaitForValue_(UINT64 value)
+{
+	static auto pWaitHistogram = MetricsRegistry::Instance().Histogram("gpu_fence.wait_ms");
+
 	auto result = S_OK;
 
-	if (pFence_->GetCompletedValue() < fenceValue_)
+	if (pFence_->GetCompletedValue() < value)
 	{
-		result = pFence_->SetEventOnCompletion(fenceValue_, fenceEvent_);
+		result = pFence_->SetEventOnCompletion(value, fenceEvent_);
 		if (FAILED(result))
 		{
 			return result;
 		}
 
+		const auto begin = Clock::Ticks();
 		WaitForSingleObject(fenceEvent_, INFINITE);
+		pWaitHistogram->Add(Clock::TicksToMilliseconds(Clock::Ticks() - begin));
+	}
+	else
+	{
+		pWaitHistogram->Add(0.0);
 	}
 
 	return result;
@@ -1,23 +1,29 @@
 #pragma once
+#include "GraphicsInterface.h"
 #include <d3d12.h>
 
 class Device;
 
-class GpuFence
+class GpuFence : public IFence
 {
 public:
 	~GpuFence();
 
 	ID3D12Fence* NativePtr() { return pFence_; }
 	UINT64 CurrentValue() { return fenceValue_; }
+	UINT64 CompletedValue() override { return pFence_->GetCompletedValue(); }
 
 	HRESULT Create(Device* pDevice);
 	void IncrementValue(){ ++fenceValue_; }
+	// waits for the last value given out by IncrementValue()
 	HRESULT WaitForCompletion();
+	void WaitForCompletion(uint64_t value) override { WaitForValue_(value); }
 
 private:
 	ID3D12Fence* pFence_ = nullptr;
 	UINT64 fenceValue_ = 0ULL;
 	HANDLE fenceEvent_ = nullptr;
+
+	HRESULT WaitForValue_(UINT64 value);
 };
 
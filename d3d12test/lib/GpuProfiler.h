@@ -0,0 +1,199 @@
+#pragma once
+#include "common.h"
+#include "Device.h"
+#include "CommandQueue.h"
+#include "GpuFence.h"
+#include "GpuQueryRing.h"
+#include "CpuProfiler.h"
+#include <d3d12.h>
+#include <algorithm>
+
+// named, nestable GPU timestamp zones
+// queries go to a ring of frameCount frames and are read back only after the frame's fence has completed,
+// so nothing ever waits for the GPU; each zone's time is reported by CpuProfiler::Dump() on the line of
+// the CPU zone that recorded it
+class GpuProfiler
+{
+public:
+	~GpuProfiler()
+	{
+		SafeRelease(&pReadback_);
+		SafeRelease(&pHeap_);
+	}
+
+	HRESULT Create(Device* pDevice, CommandQueue* pQueue, int frameCount, int maxZoneCount)
+	{
+		HRESULT result;
+
+		pQueue_ = pQueue;
+		ring_.Setup(frameCount, maxZoneCount);
+
+		result = pQueue->NativePtr()->GetTimestampFrequency(&frequency_);
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		D3D12_QUERY_HEAP_DESC heapDesc = { D3D12_QUERY_HEAP_TYPE_TIMESTAMP, static_cast<uint>(ring_.QueryCount()), 0U };
+		result = pDevice->NativePtr()->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&pHeap_));
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		D3D12_RESOURCE_DESC resDesc = {};
+		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		resDesc.Width = sizeof(UINT64) * ring_.QueryCount();
+		resDesc.Height = 1;
+		resDesc.DepthOrArraySize = 1;
+		resDesc.MipLevels = 1;
+		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		resDesc.SampleDesc.Count = 1;
+
+		D3D12_HEAP_PROPERTIES prop = { D3D12_HEAP_TYPE_READBACK, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, 0, 0 };
+		result = pDevice->NativePtr()->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &resDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pReadback_));
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		return result;
+	}
+
+	GpuQueryRing* RingPtr() { return &ring_; }
+
+	// sum of the top-level zones of the last frame read back
+	double LastFrameMilliseconds() { return lastFrameMilliseconds_; }
+
+	// reads back finished frames, then starts recording a new one
+	void BeginFrame()
+	{
+		Collect_();
+		ring_.BeginFrame();
+	}
+
+	void BeginZone(ID3D12GraphicsCommandList* pCommandList, const GpuProfileZone* pZone)
+	{
+		int threadIndex;
+		uint64_t cpuPath;
+		CpuProfiler::Instance().CurrentZone(&threadIndex, &cpuPath);
+
+		const auto query = ring_.BeginZone(pZone, threadIndex, cpuPath);
+		if (query >= 0)
+		{
+			pCommandList->EndQuery(pHeap_, D3D12_QUERY_TYPE_TIMESTAMP, query);
+		}
+	}
+
+	void EndZone(ID3D12GraphicsCommandList* pCommandList)
+	{
+		const auto query = ring_.EndZone();
+		if (query >= 0)
+		{
+			pCommandList->EndQuery(pHeap_, D3D12_QUERY_TYPE_TIMESTAMP, query);
+		}
+	}
+
+	// records the copy of this frame's timestamps into the readback buffer; call after the last zone
+	void Resolve(ID3D12GraphicsCommandList* pCommandList)
+	{
+		const auto count = ring_.FrameQueryCount();
+		if (count == 0)
+		{
+			return;
+		}
+
+		const auto first = ring_.FrameFirstQuery();
+		pCommandList->ResolveQueryData(pHeap_, D3D12_QUERY_TYPE_TIMESTAMP, first, count, pReadback_, sizeof(UINT64) * first);
+	}
+
+	// call once the frame's command lists are submitted
+	HRESULT EndFrame()
+	{
+		UINT64 fenceValue;
+		const auto result = pQueue_->Signal(&fenceValue);
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		ring_.EndFrame(fenceValue);
+		return result;
+	}
+
+private:
+	CommandQueue* pQueue_ = nullptr;
+	ID3D12QueryHeap* pHeap_ = nullptr;
+	ID3D12Resource* pReadback_ = nullptr;
+	UINT64 frequency_ = 1;
+
+	GpuQueryRing ring_;
+	double lastFrameMilliseconds_ = 0.0;
+
+	void Collect_()
+	{
+		const auto completed = pQueue_->FencePtr()->CompletedValue();
+		const auto read = [this](int first, int count, uint64_t* pTimestamps)
+		{
+			const D3D12_RANGE range = { sizeof(UINT64) * first, sizeof(UINT64) * (first + count) };
+			void* ptr = nullptr;
+			if (FAILED(pReadback_->Map(0, &range, &ptr)))
+			{
+				std::fill(pTimestamps, pTimestamps + count, 0ULL);
+				return;
+			}
+
+			const auto data = reinterpret_cast<const UINT64*>(ptr);
+			std::copy(data + first, data + first + count, pTimestamps);
+
+			const D3D12_RANGE written = { 0, 0 };
+			pReadback_->Unmap(0, &written);
+		};
+
+		auto& cpuProfiler = CpuProfiler::Instance();
+		while (ring_.CollectFrame(completed, frequency_, read))
+		{
+			lastFrameMilliseconds_ = 0.0;
+			for (const auto& zone : ring_.LastFrameZones())
+			{
+				if (!zone.IsNestedInOwner)
+				{
+					cpuProfiler.AddGpuTime(zone.OwnerThread, zone.OwnerPath, zone.Milliseconds);
+				}
+
+				if (zone.Depth == 0)
+				{
+					lastFrameMilliseconds_ += zone.Milliseconds;
+				}
+			}
+			cpuProfiler.EndGpuFrame();
+		}
+	}
+};
+
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuProfiler* pProfiler, ID3D12GraphicsCommandList* pCommandList, const GpuProfileZone* pZone)
+		: pProfiler_(pProfiler), pCommandList_(pCommandList)
+	{
+		pProfiler_->BeginZone(pCommandList_, pZone);
+	}
+
+	~GpuProfileScope()
+	{
+		pProfiler_->EndZone(pCommandList_);
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	GpuProfiler* pProfiler_;
+	ID3D12GraphicsCommandList* pCommandList_;
+};
+
+// times the commands recorded into pCommandList within the enclosing scope under name (a string literal)
+#define GPU_PROFILE_SCOPE(pProfiler, pCommandList, name) \
+	static const GpuProfileZone CPU_PROFILE_CONCAT(gpuProfileZone_, __LINE__) = { name }; \
+	GpuProfileScope CPU_PROFILE_CONCAT(gpuProfileScope_, __LINE__)(pProfiler, pCommandList, &CPU_PROFILE_CONCAT(gpuProfileZone_, __LINE__))
@@ -0,0 +1,217 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// static descriptor of a profiled GPU scope; one per GPU_PROFILE_SCOPE() site
+struct GpuProfileZone
+{
+	const char* Name;
+};
+
+// timestamp query bookkeeping for GpuProfiler, without any D3D
+// each frame in flight owns a range of query pairs; a range is read back and reused only after
+// the fence value given to EndFrame() has completed, so results are always from finished frames
+class GpuQueryRing
+{
+public:
+	struct Zone
+	{
+		const GpuProfileZone* pZone;
+		uint64_t Path;			// identifies the zone together with its parents
+		uint64_t ParentPath;
+		int Depth;
+		double Milliseconds;
+
+		// the CPU zone the zone was recorded in (CpuProfiler::CurrentZone()), which reports its time;
+		// a zone nested in another one of the same CPU zone is already part of that one's time
+		int OwnerThread;
+		uint64_t OwnerPath;
+		bool IsNestedInOwner;
+	};
+
+	void Setup(int frameCount, int maxZoneCount)
+	{
+		maxZoneCount_ = maxZoneCount;
+		frames_.clear();
+		frames_.resize(frameCount);
+		for (auto& frame : frames_)
+		{
+			frame.Zones.reserve(maxZoneCount);
+		}
+		timestamps_.resize(maxZoneCount * 2);
+		lastZones_.reserve(maxZoneCount);
+
+		beganFrameCount_ = 0;
+		collectedFrameCount_ = 0;
+		droppedFrameCount_ = 0;
+		lastFrameNumber_ = -1;
+		pRecording_ = nullptr;
+		depth_ = 0;
+		overflowDepth_ = 0;
+	}
+
+	int FrameCapacity() { return static_cast<int>(frames_.size()); }
+	int QueryCount() { return FrameCapacity() * maxZoneCount_ * 2; }
+
+	// frames ended but not read back yet
+	int InFlightCount() { return static_cast<int>(beganFrameCount_ - collectedFrameCount_) - (pRecording_ != nullptr ? 1 : 0); }
+
+	// returns false when every slot still waits for the GPU; nothing is recorded until the next BeginFrame()
+	bool BeginFrame()
+	{
+		if (pRecording_ != nullptr)
+		{
+			// the previous frame never ended (not submitted); collect it as empty
+			pRecording_->Zones.clear();
+			pRecording_->FenceValue = 0;
+			pRecording_ = nullptr;
+		}
+		depth_ = 0;
+		overflowDepth_ = 0;
+
+		if (frames_.empty() || beganFrameCount_ - collectedFrameCount_ >= static_cast<long long>(frames_.size()))
+		{
+			++droppedFrameCount_;
+			return false;
+		}
+
+		pRecording_ = &frames_[beganFrameCount_ % frames_.size()];
+		pRecording_->Number = beganFrameCount_;
+		pRecording_->Zones.clear();
+		++beganFrameCount_;
+		return true;
+	}
+
+	// query index for the zone's begin timestamp, or -1 when it isn't recorded (no frame, out of slots, too deep)
+	int BeginZone(const GpuProfileZone* pZone, int ownerThread = -1, uint64_t ownerPath = 0ULL)
+	{
+		if (pRecording_ == nullptr || overflowDepth_ > 0
+			|| depth_ == cMaxDepth || static_cast<int>(pRecording_->Zones.size()) == maxZoneCount_)
+		{
+			++overflowDepth_;
+			return -1;
+		}
+
+		const auto pParent = (depth_ > 0) ? &pRecording_->Zones[openZones_[depth_ - 1]] : nullptr;
+		const auto parentPath = (pParent != nullptr) ? pParent->Path : 0ULL;
+		const auto isNestedInOwner = pParent != nullptr && pParent->OwnerThread == ownerThread && pParent->OwnerPath == ownerPath;
+		const auto index = static_cast<int>(pRecording_->Zones.size());
+		const Zone zone =
+		{
+			pZone, (parentPath ^ reinterpret_cast<uintptr_t>(pZone)) * 0x100000001B3ULL, parentPath, depth_, 0.0,
+			ownerThread, ownerPath, isNestedInOwner,
+		};
+		pRecording_->Zones.push_back(zone);
+		openZones_[depth_++] = index;
+
+		return FirstQuery_(pRecording_) + index * 2;
+	}
+
+	// query index for the end timestamp of the innermost open zone, or -1
+	int EndZone()
+	{
+		if (overflowDepth_ > 0)
+		{
+			--overflowDepth_;
+			return -1;
+		}
+		if (pRecording_ == nullptr || depth_ == 0)
+		{
+			return -1;
+		}
+
+		return FirstQuery_(pRecording_) + openZones_[--depth_] * 2 + 1;
+	}
+
+	// queries of the current frame, to resolve after its last zone
+	int FrameFirstQuery() { return (pRecording_ != nullptr) ? FirstQuery_(pRecording_) : 0; }
+	int FrameQueryCount() { return (pRecording_ != nullptr) ? static_cast<int>(pRecording_->Zones.size()) * 2 : 0; }
+
+	// fenceValue: the frame's work has finished on the GPU once the fence reaches it
+	void EndFrame(uint64_t fenceValue)
+	{
+		if (pRecording_ == nullptr)
+		{
+			return;
+		}
+		pRecording_->FenceValue = fenceValue;
+		pRecording_ = nullptr;
+	}
+
+	// reads back the oldest frame if the GPU has finished it; returns false when there is none
+	// read(firstQuery, count, uint64_t* pTimestamps) copies resolved timestamps, frequency is in ticks per second
+	template<class ReadFn>
+	bool CollectFrame(uint64_t completedFenceValue, uint64_t frequency, ReadFn read)
+	{
+		if (collectedFrameCount_ == beganFrameCount_)
+		{
+			return false;
+		}
+
+		auto& frame = frames_[collectedFrameCount_ % frames_.size()];
+		if (&frame == pRecording_ || frame.FenceValue > completedFenceValue)
+		{
+			return false;
+		}
+
+		const auto queryCount = static_cast<int>(frame.Zones.size()) * 2;
+		if (queryCount > 0)
+		{
+			read(FirstQuery_(&frame), queryCount, timestamps_.data());
+		}
+
+		lastZones_.clear();
+		for (auto i = 0; i < static_cast<int>(frame.Zones.size()); ++i)
+		{
+			auto zone = frame.Zones[i];
+			const auto begin = timestamps_[i * 2];
+			const auto end = timestamps_[i * 2 + 1];
+			zone.Milliseconds = (end > begin) ? (end - begin) * 1000.0 / frequency : 0.0;
+			lastZones_.push_back(zone);
+		}
+
+		lastFrameNumber_ = frame.Number;
+		++collectedFrameCount_;
+		return true;
+	}
+
+	// zones of the most recently collected frame
+	const std::vector<Zone>& LastFrameZones() { return lastZones_; }
+	long long LastFrameNumber() { return lastFrameNumber_; }
+
+	// frames between the one being recorded and the last one read back
+	int Latency() { return static_cast<int>(std::max(0LL, beganFrameCount_ - 1 - lastFrameNumber_)); }
+
+	long long DroppedFrameCount() { return droppedFrameCount_; }
+
+private:
+	static const int cMaxDepth = 32;
+
+	struct Frame_
+	{
+		long long Number = 0;
+		uint64_t FenceValue = 0;
+		std::vector<Zone> Zones;
+	};
+
+	int maxZoneCount_ = 0;
+	std::vector<Frame_> frames_;
+	long long beganFrameCount_ = 0;
+	long long collectedFrameCount_ = 0;
+	long long droppedFrameCount_ = 0;
+
+	Frame_* pRecording_ = nullptr;
+	int openZones_[cMaxDepth];
+	int depth_ = 0;
+	int overflowDepth_ = 0;
+
+	std::vector<uint64_t> timestamps_;
+	std::vector<Zone> lastZones_;
+	long long lastFrameNumber_ = -1;
+
+	int FirstQuery_(Frame_* pFrame)
+	{
+		return static_cast<int>(pFrame - frames_.data()) * maxZoneCount_ * 2;
+	}
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+// the part of a command list, queue and fence the frame loop drives, implemented by the D3D12 wrappers
+// (CommandList, CommandQueue, GpuFence) and by NullGraphics, so the same submit/wait code runs on either
+// recording stays with the concrete list types
+
+class IFence
+{
+public:
+	virtual ~IFence() {}
+
+	virtual uint64_t CompletedValue() = 0;
+
+	// blocks until the fence has reached value
+	virtual void WaitForCompletion(uint64_t value) = 0;
+};
+
+class ICommandList
+{
+public:
+	virtual ~ICommandList() {}
+
+	virtual void Close() = 0;
+};
+
+class ICommandQueue
+{
+public:
+	virtual ~ICommandQueue() {}
+
+	virtual IFence* FencePtr() = 0;
+
+	// lists of the queue's own backend, closed
+	virtual void Execute(ICommandList* const* pListPtrs, int count) = 0;
+
+	// signals the next fence value after everything executed so far and returns it, without waiting
+	virtual uint64_t Signal() = 0;
+};
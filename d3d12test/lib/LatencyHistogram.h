@@ -0,0 +1,135 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// fixed-size log-linear histogram of durations in milliseconds (HDR histogram layout)
+// values are bucketed at microsecond resolution: exact below 64us, then 32 linear buckets per octave
+// (~3% relative error) up to ~16s; larger values land in the last bucket. never allocates
+class LatencyHistogram
+{
+public:
+	int Count() { return static_cast<int>(count_); }
+	double Min() { return (count_ > 0) ? min_ : 0.0; }
+	double Max() { return max_; }
+	double Sum() { return sum_; }
+	double Average() { return (count_ > 0) ? sum_ / count_ : 0.0; }
+
+	// bucket layout, shared with other histograms (MetricHistogram) so they report the same way
+	static int BucketCount() { return cBucketCount_; }
+
+	static int BucketOf(double milliseconds)
+	{
+		const double maxMicroseconds = (1 << (cMaxBit_ + 1)) - 1;
+		return BucketIndex_(static_cast<uint32_t>(std::min(std::max(0.0, milliseconds) * 1000.0, maxMicroseconds)));
+	}
+
+	static double BucketMiddle(int index)
+	{
+		return (BucketLower_(index) + BucketLower_(index + 1)) * 0.5 / 1000.0;
+	}
+
+	void Add(double milliseconds)
+	{
+		milliseconds = std::max(0.0, milliseconds);
+		++buckets_[BucketOf(milliseconds)];
+		min_ = (count_ > 0) ? std::min(min_, milliseconds) : milliseconds;
+		max_ = std::max(max_, milliseconds);
+		sum_ += milliseconds;
+		++count_;
+	}
+
+	void Merge(const LatencyHistogram& other)
+	{
+		for (auto i = 0; i < cBucketCount_; ++i)
+		{
+			buckets_[i] += other.buckets_[i];
+		}
+		if (other.count_ > 0)
+		{
+			min_ = (count_ > 0) ? std::min(min_, other.min_) : other.min_;
+		}
+		max_ = std::max(max_, other.max_);
+		sum_ += other.sum_;
+		count_ += other.count_;
+	}
+
+	// percentile in [0, 100]; returns the middle of the bucket holding it, clamped to the observed range
+	double Percentile(double percentile)
+	{
+		if (count_ == 0)
+		{
+			return 0.0;
+		}
+
+		const auto rank = static_cast<uint64_t>(std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100.0 * count_));
+		const auto target = std::max<uint64_t>(rank, 1);
+
+		uint64_t accumulated = 0;
+		for (auto i = 0; i < cBucketCount_; ++i)
+		{
+			accumulated += buckets_[i];
+			if (accumulated >= target)
+			{
+				const auto value = BucketMiddle(i);
+				return std::min(std::max(value, min_), max_);
+			}
+		}
+		return max_;
+	}
+
+	void Reset()
+	{
+		buckets_.fill(0);
+		count_ = 0;
+		min_ = 0.0;
+		max_ = 0.0;
+		sum_ = 0.0;
+	}
+
+private:
+	static const int cSubBucketBits_ = 5;
+	static const int cSubBucketCount_ = 1 << cSubBucketBits_;
+	static const int cMaxBit_ = 23;
+	static const int cBucketCount_ = cSubBucketCount_ * 2 + (cMaxBit_ - cSubBucketBits_) * cSubBucketCount_;
+
+	std::array<uint32_t, cBucketCount_> buckets_ = {};
+	uint64_t count_ = 0;
+	double min_ = 0.0;
+	double max_ = 0.0;
+	double sum_ = 0.0;
+
+	static int HighestBit_(uint32_t value)
+	{
+		auto bit = 0;
+		while (value >>= 1)
+		{
+			++bit;
+		}
+		return bit;
+	}
+
+	static int BucketIndex_(uint32_t microseconds)
+	{
+		if (microseconds < cSubBucketCount_ * 2)
+		{
+			return static_cast<int>(microseconds);
+		}
+		const auto bit = HighestBit_(microseconds);
+		const auto shift = bit - cSubBucketBits_;
+		return cSubBucketCount_ * 2 + (bit - cSubBucketBits_ - 1) * cSubBucketCount_ + static_cast<int>((microseconds >> shift) - cSubBucketCount_);
+	}
+
+	// smallest value (us) that lands in bucket index
+	static double BucketLower_(int index)
+	{
+		if (index < cSubBucketCount_ * 2)
+		{
+			return index;
+		}
+		const auto octave = (index - cSubBucketCount_ * 2) / cSubBucketCount_;
+		const auto sub = (index - cSubBucketCount_ * 2) % cSubBucketCount_;
+		return static_cast<double>(cSubBucketCount_ + sub) * (1 << (octave + 1));
+	}
+};
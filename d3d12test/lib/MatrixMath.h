@@ -0,0 +1,133 @@
+#pragma once
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MATRIX_MATH_SSE
+#include <emmintrin.h>
+#endif
+
+// 4x4 matrices as 16 floats, row-major with row vectors like XMMATRIX, for the code that also builds
+// without DirectXMath (the camera, the mesh world matrices, and FrameBench on the portable bench target)
+// no alignment is required
+
+const float cPiDiv4 = 0.785398163f;
+
+// out = a * b, row by row: out[i] = a[i][0] * b[0] + a[i][1] * b[1] + a[i][2] * b[2] + a[i][3] * b[3]
+// pOut may be a or b
+inline void MatrixMultiply(const float* pA, const float* pB, float* pOut)
+{
+#if defined(MATRIX_MATH_SSE)
+	const auto b0 = _mm_loadu_ps(pB);
+	const auto b1 = _mm_loadu_ps(pB + 4);
+	const auto b2 = _mm_loadu_ps(pB + 8);
+	const auto b3 = _mm_loadu_ps(pB + 12);
+	__m128 rows[4];
+	for (auto i = 0; i < 4; ++i)
+	{
+		const auto pRow = pA + i * 4;
+		auto row = _mm_mul_ps(_mm_set1_ps(pRow[0]), b0);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[1]), b1));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[2]), b2));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[3]), b3));
+		rows[i] = row;
+	}
+	for (auto i = 0; i < 4; ++i)
+	{
+		_mm_storeu_ps(pOut + i * 4, rows[i]);
+	}
+#else
+	float m[16];
+	for (auto i = 0; i < 4; ++i)
+	{
+		for (auto j = 0; j < 4; ++j)
+		{
+			m[i * 4 + j] = pA[i * 4] * pB[j] + pA[i * 4 + 1] * pB[4 + j] + pA[i * 4 + 2] * pB[8 + j] + pA[i * 4 + 3] * pB[12 + j];
+		}
+	}
+	for (auto i = 0; i < 16; ++i)
+	{
+		pOut[i] = m[i];
+	}
+#endif
+}
+
+// XMMatrixLookAtLH(); positions and directions are 3 floats
+inline void MatrixLookAtLH(const float* pEye, const float* pFocus, const float* pUp, float* pOut)
+{
+	const auto normalize = [](float* v)
+	{
+		const auto length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		const auto scale = (length > 0.0f) ? 1.0f / length : 0.0f;
+		v[0] *= scale;
+		v[1] *= scale;
+		v[2] *= scale;
+	};
+	const auto cross = [](const float* a, const float* b, float* pOut)
+	{
+		pOut[0] = a[1] * b[2] - a[2] * b[1];
+		pOut[1] = a[2] * b[0] - a[0] * b[2];
+		pOut[2] = a[0] * b[1] - a[1] * b[0];
+	};
+	const auto dot = [](const float* a, const float* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	};
+
+	float z[3] = { pFocus[0] - pEye[0], pFocus[1] - pEye[1], pFocus[2] - pEye[2] };
+	normalize(z);
+	float x[3];
+	cross(pUp, z, x);
+	normalize(x);
+	float y[3];
+	cross(z, x, y);
+
+	auto m = pOut;
+	m[0] = x[0];
+	m[1] = y[0];
+	m[2] = z[0];
+	m[3] = 0.0f;
+
+	m[4] = x[1];
+	m[5] = y[1];
+	m[6] = z[1];
+	m[7] = 0.0f;
+
+	m[8] = x[2];
+	m[9] = y[2];
+	m[10] = z[2];
+	m[11] = 0.0f;
+
+	m[12] = -dot(x, pEye);
+	m[13] = -dot(y, pEye);
+	m[14] = -dot(z, pEye);
+	m[15] = 1.0f;
+}
+
+// XMMatrixPerspectiveFovLH()
+inline void MatrixPerspectiveFovLH(float fovY, float aspect, float zNear, float zFar, float* pOut)
+{
+	const auto height = std::cos(fovY * 0.5f) / std::sin(fovY * 0.5f);
+	const auto width = height / aspect;
+	const auto range = zFar / (zFar - zNear);
+
+	auto m = pOut;
+	m[0] = width;
+	m[1] = 0.0f;
+	m[2] = 0.0f;
+	m[3] = 0.0f;
+
+	m[4] = 0.0f;
+	m[5] = height;
+	m[6] = 0.0f;
+	m[7] = 0.0f;
+
+	m[8] = 0.0f;
+	m[9] = 0.0f;
+	m[10] = range;
+	m[11] = 1.0f;
+
+	m[12] = 0.0f;
+	m[13] = 0.0f;
+	m[14] = -range * zNear;
+	m[15] = 0.0f;
+}
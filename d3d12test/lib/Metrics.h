@@ -0,0 +1,373 @@
+#pragma once
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// runtime metrics for soak runs
+// counters and histograms are split into per-thread shards (a cache line each) updated with relaxed atomics,
+// so hot paths never contend; gauges hold one value. MetricsRegistry sums the shards when it takes a snapshot
+
+namespace metrics_detail
+{
+	const int cShardCount = 8;
+	const int cCacheLineSize = 64;
+
+	// threads are spread over the shards in the order they first touch a metric
+	inline int ShardIndex()
+	{
+		static std::atomic<int> nextIndex{ 0 };
+		static thread_local int index = nextIndex.fetch_add(1, std::memory_order_relaxed) % cShardCount;
+		return index;
+	}
+}
+
+// monotonically increasing count
+class MetricCounter
+{
+public:
+	void Add(long long value = 1)
+	{
+		shards_[metrics_detail::ShardIndex()].Value.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	long long Value()
+	{
+		long long value = 0;
+		for (auto& shard : shards_)
+		{
+			value += shard.Value.load(std::memory_order_relaxed);
+		}
+		return value;
+	}
+
+private:
+	// padded rather than alignas(): metrics are heap-allocated and plain new ignores over-alignment
+	struct Shard_
+	{
+		std::atomic<long long> Value{ 0 };
+		char Padding[metrics_detail::cCacheLineSize - sizeof(std::atomic<long long>)];
+	};
+
+	Shard_ shards_[metrics_detail::cShardCount];
+};
+
+// current level of something (queue depth, descriptors in use, ...)
+class MetricGauge
+{
+public:
+	void Set(long long value) { value_.store(value, std::memory_order_relaxed); }
+	void Add(long long value) { value_.fetch_add(value, std::memory_order_relaxed); }
+	long long Value() { return value_.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<long long> value_{ 0 };
+};
+
+// distribution of durations in milliseconds, bucketed like LatencyHistogram
+// TakeSnapshot() drains it, so every snapshot covers the interval since the previous one
+class MetricHistogram
+{
+public:
+	struct Snapshot
+	{
+		long long Count;
+		double P50;
+		double P95;
+		double P99;
+		double Max;
+	};
+
+	MetricHistogram()
+	{
+		for (auto& shard : shards_)
+		{
+			shard.Buckets.reset(new std::atomic<uint32_t>[LatencyHistogram::BucketCount()]);
+			for (auto i = 0; i < LatencyHistogram::BucketCount(); ++i)
+			{
+				shard.Buckets[i].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void Add(double milliseconds)
+	{
+		auto& shard = shards_[metrics_detail::ShardIndex()];
+		shard.Buckets[LatencyHistogram::BucketOf(milliseconds)].fetch_add(1, std::memory_order_relaxed);
+
+		const auto microseconds = static_cast<long long>(milliseconds * 1000.0);
+		auto max = shard.MaxMicroseconds.load(std::memory_order_relaxed);
+		while (microseconds > max && !shard.MaxMicroseconds.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	Snapshot TakeSnapshot()
+	{
+		const auto bucketCount = LatencyHistogram::BucketCount();
+		if (static_cast<int>(merged_.size()) != bucketCount)
+		{
+			merged_.resize(bucketCount);
+		}
+
+		Snapshot snapshot = { 0, 0.0, 0.0, 0.0, 0.0 };
+		long long maxMicroseconds = 0;
+		for (auto i = 0; i < bucketCount; ++i)
+		{
+			merged_[i] = 0;
+		}
+		for (auto& shard : shards_)
+		{
+			for (auto i = 0; i < bucketCount; ++i)
+			{
+				const auto count = shard.Buckets[i].exchange(0, std::memory_order_relaxed);
+				merged_[i] += count;
+				snapshot.Count += count;
+			}
+			maxMicroseconds = std::max(maxMicroseconds, shard.MaxMicroseconds.exchange(0, std::memory_order_relaxed));
+		}
+
+		snapshot.Max = maxMicroseconds / 1000.0;
+		snapshot.P50 = Percentile_(snapshot.Count, 50.0, snapshot.Max);
+		snapshot.P95 = Percentile_(snapshot.Count, 95.0, snapshot.Max);
+		snapshot.P99 = Percentile_(snapshot.Count, 99.0, snapshot.Max);
+		return snapshot;
+	}
+
+private:
+	struct Shard_
+	{
+		std::unique_ptr<std::atomic<uint32_t>[]> Buckets;
+		std::atomic<long long> MaxMicroseconds{ 0 };
+		char Padding[metrics_detail::cCacheLineSize - sizeof(std::unique_ptr<std::atomic<uint32_t>[]>) - sizeof(std::atomic<long long>)];
+	};
+
+	Shard_ shards_[metrics_detail::cShardCount];
+	std::vector<long long> merged_;	// TakeSnapshot() only
+
+	double Percentile_(long long count, double percentile, double max)
+	{
+		if (count == 0)
+		{
+			return 0.0;
+		}
+
+		const auto target = std::max(1LL, static_cast<long long>(std::ceil(percentile / 100.0 * count)));
+		long long accumulated = 0;
+		for (auto i = 0; i < static_cast<int>(merged_.size()); ++i)
+		{
+			accumulated += merged_[i];
+			if (accumulated >= target)
+			{
+				return std::min(LatencyHistogram::BucketMiddle(i), max);
+			}
+		}
+		return max;
+	}
+};
+
+// named metrics of the whole process; a name always maps to the same object, which lives until exit,
+// so callers look them up once and keep the pointer
+class MetricsRegistry
+{
+public:
+	enum class Format
+	{
+		Csv,
+		JsonLines,
+	};
+
+	static MetricsRegistry& Instance()
+	{
+		static MetricsRegistry registry;
+		return registry;
+	}
+
+	MetricCounter* Counter(const std::string& name) { return Find_<MetricCounter>(name, Type_::Counter, &counters_); }
+	MetricGauge* Gauge(const std::string& name) { return Find_<MetricGauge>(name, Type_::Gauge, &gauges_); }
+	MetricHistogram* Histogram(const std::string& name) { return Find_<MetricHistogram>(name, Type_::Histogram, &histograms_); }
+
+	// Tick() appends a snapshot to filepath every intervalMilliseconds
+	bool SetOutput(const std::string& filepath, Format format, double intervalMilliseconds)
+	{
+		std::unique_lock<std::mutex> lk(lock_);
+		stream_.close();
+		stream_.clear();
+		stream_.open(filepath);
+		format_ = format;
+		interval_ = static_cast<long long>(intervalMilliseconds / 1000.0 * Clock::Frequency());
+		writtenEntryCount_ = 0;
+		lastSnapshot_ = Clock::Ticks();
+		origin_ = lastSnapshot_;
+		return static_cast<bool>(stream_);
+	}
+
+	// call once a frame (or from any periodic thread)
+	void Tick()
+	{
+		std::unique_lock<std::mutex> lk(lock_);
+		if (stream_.is_open() && Clock::Ticks() - lastSnapshot_ >= interval_)
+		{
+			WriteSnapshot_();
+		}
+	}
+
+	// writes one line: CSV (with a new header whenever metrics were added) or one JSON object
+	// counters are running totals, gauges the current value, histograms cover the time since the last snapshot
+	void WriteSnapshot()
+	{
+		std::unique_lock<std::mutex> lk(lock_);
+		if (stream_.is_open())
+		{
+			WriteSnapshot_();
+		}
+	}
+
+private:
+	enum class Type_
+	{
+		Counter,
+		Gauge,
+		Histogram,
+	};
+
+	struct Entry_
+	{
+		std::string Name;
+		Type_ Type;
+		int Index;
+	};
+
+	std::mutex lock_;
+	std::vector<Entry_> entries_;
+	std::vector<std::unique_ptr<MetricCounter>> counters_;
+	std::vector<std::unique_ptr<MetricGauge>> gauges_;
+	std::vector<std::unique_ptr<MetricHistogram>> histograms_;
+
+	std::ofstream stream_;
+	Format format_ = Format::Csv;
+	long long interval_ = 0;
+	long long lastSnapshot_ = 0;
+	long long origin_ = 0;
+	int writtenEntryCount_ = 0;
+
+	MetricsRegistry() {}
+
+	void WriteSnapshot_()
+	{
+		lastSnapshot_ = Clock::Ticks();
+		const auto time = Clock::TicksToMilliseconds(lastSnapshot_ - origin_);
+
+		stream_.setf(std::ios::fixed);
+		stream_.precision(3);
+
+		if (format_ == Format::Csv)
+		{
+			WriteCsv_(time);
+		}
+		else
+		{
+			WriteJson_(time);
+		}
+		stream_.flush();
+	}
+
+	template<class T>
+	T* Find_(const std::string& name, Type_ type, std::vector<std::unique_ptr<T>>* pItems)
+	{
+		std::unique_lock<std::mutex> lk(lock_);
+		for (const auto& entry : entries_)
+		{
+			if (entry.Name == name && entry.Type == type)
+			{
+				return (*pItems)[entry.Index].get();
+			}
+		}
+
+		pItems->emplace_back(new T());
+		entries_.push_back({ name, type, static_cast<int>(pItems->size()) - 1 });
+		return pItems->back().get();
+	}
+
+	void WriteCsv_(double time)
+	{
+		if (writtenEntryCount_ != static_cast<int>(entries_.size()))
+		{
+			stream_ << "time_ms";
+			for (const auto& entry : entries_)
+			{
+				if (entry.Type == Type_::Histogram)
+				{
+					stream_ << ',' << entry.Name << ".count," << entry.Name << ".p50," << entry.Name << ".p95,"
+						<< entry.Name << ".p99," << entry.Name << ".max";
+				}
+				else
+				{
+					stream_ << ',' << entry.Name;
+				}
+			}
+			stream_ << '\n';
+			writtenEntryCount_ = static_cast<int>(entries_.size());
+		}
+
+		stream_ << time;
+		for (const auto& entry : entries_)
+		{
+			switch (entry.Type)
+			{
+				case Type_::Counter:
+					stream_ << ',' << counters_[entry.Index]->Value();
+					break;
+
+				case Type_::Gauge:
+					stream_ << ',' << gauges_[entry.Index]->Value();
+					break;
+
+				case Type_::Histogram:
+				{
+					const auto snapshot = histograms_[entry.Index]->TakeSnapshot();
+					stream_ << ',' << snapshot.Count << ',' << snapshot.P50 << ',' << snapshot.P95
+						<< ',' << snapshot.P99 << ',' << snapshot.Max;
+					break;
+				}
+			}
+		}
+		stream_ << '\n';
+	}
+
+	// names are code-defined identifiers, so they are written without escaping
+	void WriteJson_(double time)
+	{
+		stream_ << "{\"time_ms\":" << time;
+		for (const auto& entry : entries_)
+		{
+			stream_ << ",\"" << entry.Name << "\":";
+			switch (entry.Type)
+			{
+				case Type_::Counter:
+					stream_ << counters_[entry.Index]->Value();
+					break;
+
+				case Type_::Gauge:
+					stream_ << gauges_[entry.Index]->Value();
+					break;
+
+				case Type_::Histogram:
+				{
+					const auto snapshot = histograms_[entry.Index]->TakeSnapshot();
+					stream_ << "{\"count\":" << snapshot.Count << ",\"p50\":" << snapshot.P50 << ",\"p95\":" << snapshot.P95
+						<< ",\"p99\":" << snapshot.P99 << ",\"max\":" << snapshot.Max << '}';
+					break;
+				}
+			}
+		}
+		stream_ << "}\n";
+	}
+};
@@ -0,0 +1,267 @@
+#pragma once
+#include "Clock.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+// keeps the compiler from optimizing away a value computed in a benchmark loop
+template<class T>
+inline void MicroBenchDoNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+	static const void* volatile pSink;
+	pSink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// what a benchmark body sees; loop with `while (state.KeepRunning())`, only the loop is timed
+class MicroBenchState
+{
+public:
+	explicit MicroBenchState(long long iterations)
+		: iterations_(iterations), remaining_(iterations)
+	{ }
+
+	bool KeepRunning()
+	{
+		if (!isStarted_)
+		{
+			isStarted_ = true;
+			cpuBegin_ = ThreadCpuNanoseconds_();
+			begin_ = Clock::Ticks();
+		}
+		if (remaining_ > 0)
+		{
+			--remaining_;
+			return true;
+		}
+		end_ = Clock::Ticks();
+		cpuEnd_ = ThreadCpuNanoseconds_();
+		return false;
+	}
+
+	long long Iterations() { return iterations_; }
+
+	// totals over all iterations; reported per second
+	void SetBytesProcessed(long long bytes) { bytes_ = bytes; }
+	void SetItemsProcessed(long long items) { items_ = items; }
+
+	long long BytesProcessed() { return bytes_; }
+	long long ItemsProcessed() { return items_; }
+	double ElapsedMilliseconds() { return Clock::TicksToMilliseconds(end_ - begin_); }
+	// CPU time of the thread running the loop; work handed to other threads shows up in ElapsedMilliseconds() only
+	double CpuMilliseconds() { return (cpuEnd_ - cpuBegin_) / 1000000.0; }
+
+private:
+	long long iterations_;
+	long long remaining_;
+	bool isStarted_ = false;
+	long long begin_ = 0;
+	long long end_ = 0;
+	long long cpuBegin_ = 0;
+	long long cpuEnd_ = 0;
+	long long bytes_ = 0;
+	long long items_ = 0;
+
+	static long long ThreadCpuNanoseconds_()
+	{
+#if defined(_WIN32)
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+		{
+			return 0;
+		}
+		const auto kernel = (static_cast<long long>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+		const auto user = (static_cast<long long>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+		return (kernel + user) * 100;	// 100ns units
+#else
+		timespec time;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+		return time.tv_sec * 1000000000LL + time.tv_nsec;
+#endif
+	}
+};
+
+struct MicroBenchDesc
+{
+	double MinMilliseconds;		// each measured run lasts at least this long
+	int RepetitionCount;
+	std::string Filter;			// runs only the benchmarks whose name contains it
+};
+
+// registers benchmarks, sizes each run by doubling the iteration count until it lasts MinMilliseconds,
+// prints a table and writes JSON in the Google Benchmark layout, so tools/compare.py can diff two runs
+class MicroBenchRunner
+{
+public:
+	typedef std::function<void(MicroBenchState&)> Body;
+
+	struct Result
+	{
+		std::string Name;
+		int RepetitionIndex;
+		long long Iterations;
+		double RealNanoseconds;		// per iteration
+		double CpuNanoseconds;		// per iteration, the benchmark's thread only
+		double BytesPerSecond;
+		double ItemsPerSecond;
+	};
+
+	static MicroBenchDesc DefaultDesc()
+	{
+		MicroBenchDesc desc;
+		desc.MinMilliseconds = 200.0;
+		desc.RepetitionCount = 1;
+		return desc;
+	}
+
+	explicit MicroBenchRunner(const MicroBenchDesc& desc = DefaultDesc())
+		: desc_(desc)
+	{ }
+
+	void Add(const std::string& name, Body body)
+	{
+		benchmarks_.push_back({ name, std::move(body) });
+	}
+
+	const std::vector<Result>& Results() { return results_; }
+
+	void Run()
+	{
+		results_.clear();
+		printf("%-40s %14s %14s %12s\n", "benchmark", "time", "cpu", "iterations");
+
+		for (auto& benchmark : benchmarks_)
+		{
+			if (!desc_.Filter.empty() && benchmark.Name.find(desc_.Filter) == std::string::npos)
+			{
+				continue;
+			}
+
+			const auto iterations = Calibrate_(benchmark.Function);
+			for (auto i = 0; i < desc_.RepetitionCount; ++i)
+			{
+				MicroBenchState state(iterations);
+				benchmark.Function(state);
+
+				Result result;
+				result.Name = benchmark.Name;
+				result.RepetitionIndex = i;
+				result.Iterations = iterations;
+				result.RealNanoseconds = state.ElapsedMilliseconds() * 1000000.0 / iterations;
+				result.CpuNanoseconds = state.CpuMilliseconds() * 1000000.0 / iterations;
+				const auto seconds = std::max(state.ElapsedMilliseconds(), 1e-6) / 1000.0;
+				result.BytesPerSecond = state.BytesProcessed() / seconds;
+				result.ItemsPerSecond = state.ItemsProcessed() / seconds;
+				results_.push_back(result);
+
+				Print_(result);
+			}
+		}
+	}
+
+	bool WriteJson(const std::string& filepath)
+	{
+		std::ofstream stream(filepath);
+		if (!stream)
+		{
+			return false;
+		}
+
+		stream.precision(10);
+		stream << "{\n  \"context\": {\n";
+		stream << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+		stream << "    \"tsc_clock\": " << (Clock::IsTscBased() ? "true" : "false") << ",\n";
+#if defined(NDEBUG)
+		stream << "    \"library_build_type\": \"release\"\n";
+#else
+		stream << "    \"library_build_type\": \"debug\"\n";
+#endif
+		stream << "  },\n  \"benchmarks\": [";
+
+		for (auto i = 0; i < static_cast<int>(results_.size()); ++i)
+		{
+			const auto& result = results_[i];
+			stream << ((i > 0) ? ",\n" : "\n");
+			stream << "    {\"name\": \"" << result.Name << "\", \"run_name\": \"" << result.Name
+				<< "\", \"run_type\": \"iteration\", \"repetitions\": " << desc_.RepetitionCount
+				<< ", \"repetition_index\": " << result.RepetitionIndex
+				<< ", \"iterations\": " << result.Iterations
+				<< ", \"real_time\": " << result.RealNanoseconds
+				<< ", \"cpu_time\": " << result.CpuNanoseconds
+				<< ", \"time_unit\": \"ns\"";
+			if (result.BytesPerSecond > 0.0)
+			{
+				stream << ", \"bytes_per_second\": " << result.BytesPerSecond;
+			}
+			if (result.ItemsPerSecond > 0.0)
+			{
+				stream << ", \"items_per_second\": " << result.ItemsPerSecond;
+			}
+			stream << "}";
+		}
+
+		stream << "\n  ]\n}\n";
+		return static_cast<bool>(stream);
+	}
+
+private:
+	struct Benchmark_
+	{
+		std::string Name;
+		Body Function;
+	};
+
+	MicroBenchDesc desc_;
+	std::vector<Benchmark_> benchmarks_;
+	std::vector<Result> results_;
+
+	long long Calibrate_(Body& body)
+	{
+		long long iterations = 1;
+		for (;;)
+		{
+			MicroBenchState state(iterations);
+			body(state);
+
+			const auto elapsed = state.ElapsedMilliseconds();
+			if (elapsed >= desc_.MinMilliseconds || iterations >= (1LL << 40))
+			{
+				return iterations;
+			}
+
+			// aim a little past the target, but never grow more than 10x on a noisy short run
+			const auto scale = (elapsed > 0.0) ? desc_.MinMilliseconds * 1.4 / elapsed : 10.0;
+			iterations = std::max(iterations + 1, static_cast<long long>(iterations * std::min(10.0, scale)));
+		}
+	}
+
+	static void Print_(const Result& result)
+	{
+		printf("%-40s %11.1f ns %11.1f ns %12lld", result.Name.c_str(), result.RealNanoseconds, result.CpuNanoseconds, result.Iterations);
+		if (result.BytesPerSecond > 0.0)
+		{
+			printf(" %9.2f GB/s", result.BytesPerSecond / (1024.0 * 1024.0 * 1024.0));
+		}
+		if (result.ItemsPerSecond > 0.0)
+		{
+			printf(" %9.2f M items/s", result.ItemsPerSecond / 1000000.0);
+		}
+		printf("\n");
+	}
+};
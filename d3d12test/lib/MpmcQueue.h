@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// bounded multi-producer/multi-consumer ring (Vyukov)
+// every slot carries a sequence number that tells producers and consumers whose turn it is,
+// so neither side ever takes a lock; TryPush/TryPop fail instead of blocking when full/empty
+template<class T>
+class MpmcQueue
+{
+public:
+	// capacity must be a power of two
+	explicit MpmcQueue(int capacity)
+		: slots_(capacity), mask_(capacity - 1)
+	{
+		for (auto i = 0; i < capacity; ++i)
+		{
+			slots_[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	int Capacity() { return static_cast<int>(mask_ + 1); }
+
+	// approximate while other threads are pushing or popping
+	int Size()
+	{
+		const auto enqueuePos = enqueuePos_.load(std::memory_order_relaxed);
+		const auto dequeuePos = dequeuePos_.load(std::memory_order_relaxed);
+		return (enqueuePos > dequeuePos) ? static_cast<int>(enqueuePos - dequeuePos) : 0;
+	}
+
+	bool TryPush(const T& value)
+	{
+		auto pos = enqueuePos_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto& slot = slots_[pos & mask_];
+			const auto sequence = slot.Sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+			if (diff == 0)
+			{
+				if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					slot.Value = value;
+					slot.Sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				// the consumer of the previous lap hasn't taken this slot yet
+				return false;
+			}
+			else
+			{
+				pos = enqueuePos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool TryPop(T* pValue)
+	{
+		auto pos = dequeuePos_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto& slot = slots_[pos & mask_];
+			const auto sequence = slot.Sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+			if (diff == 0)
+			{
+				if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					*pValue = slot.Value;
+					slot.Sequence.store(pos + mask_ + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = dequeuePos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	// one slot per cache line so that neighbouring pushes/pops don't false-share
+	struct alignas(64) Slot_
+	{
+		std::atomic<size_t> Sequence;
+		T Value;
+	};
+
+	std::vector<Slot_> slots_;
+	size_t mask_;
+
+	alignas(64) std::atomic<size_t> enqueuePos_{ 0 };
+	alignas(64) std::atomic<size_t> dequeuePos_{ 0 };
+};
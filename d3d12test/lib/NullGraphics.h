@@ -0,0 +1,227 @@
+#pragma once
+#include "GraphicsInterface.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// stand-ins for CommandList, CommandQueue, GpuFence and Resource that do no GPU work
+// commands are only recorded as (type, argument) pairs and counted, so the CPU side of a frame
+// can run headless (FrameBench, CI machines without a D3D12 device); the list, queue and fence
+// implement the same interfaces as the D3D12 ones
+
+enum class NullCommandType
+{
+	SetDescriptorHeaps,
+	SetRootSignature,
+	SetPrimitiveTopology,
+	SetPipelineState,
+	SetRootDescriptorTable,
+	SetVertexBuffers,
+	SetIndexBuffer,
+	DrawIndexedInstanced,
+	SetViewports,
+	SetScissorRects,
+	ResourceBarrier,
+	SetRenderTargets,
+	ClearRenderTarget,
+	ClearDepthStencil,
+	ExecuteBundle,
+	Count,
+};
+
+inline const char* NullCommandTypeName(NullCommandType type)
+{
+	static const char* names[] =
+	{
+		"SetDescriptorHeaps",
+		"SetRootSignature",
+		"SetPrimitiveTopology",
+		"SetPipelineState",
+		"SetRootDescriptorTable",
+		"SetVertexBuffers",
+		"SetIndexBuffer",
+		"DrawIndexedInstanced",
+		"SetViewports",
+		"SetScissorRects",
+		"ResourceBarrier",
+		"SetRenderTargets",
+		"ClearRenderTarget",
+		"ClearDepthStencil",
+		"ExecuteBundle",
+	};
+	static_assert(sizeof(names) / sizeof(names[0]) == static_cast<int>(NullCommandType::Count), "NullCommandTypeName");
+
+	return names[static_cast<int>(type)];
+}
+
+const int cNullCommandTypeCount = static_cast<int>(NullCommandType::Count);
+
+class NullCommandList : public ICommandList
+{
+public:
+	enum class SubmitType
+	{
+		Direct,
+		Bundle,
+	};
+
+	struct Command
+	{
+		NullCommandType Type;
+		uint64_t Argument;
+	};
+
+	explicit NullCommandList(SubmitType type = SubmitType::Direct)
+		: type_(type)
+	{ }
+
+	SubmitType Type() { return type_; }
+	bool IsOpen() { return isOpen_; }
+
+	// keeps the capacity of the previous recording, so a steady-state frame does not allocate
+	void Open()
+	{
+		commands_.clear();
+		bundlePtrs_.clear();
+		isOpen_ = true;
+	}
+
+	void Close() override { isOpen_ = false; }
+
+	void SetDescriptorHeaps(uint64_t heap) { Record_(NullCommandType::SetDescriptorHeaps, heap); }
+	void SetGraphicsRootSignature(uint64_t signature) { Record_(NullCommandType::SetRootSignature, signature); }
+	void IASetPrimitiveTopology(uint64_t topology) { Record_(NullCommandType::SetPrimitiveTopology, topology); }
+	void SetPipelineState(uint64_t pipelineState) { Record_(NullCommandType::SetPipelineState, pipelineState); }
+	void SetGraphicsRootDescriptorTable(int index, uint64_t handle) { Record_(NullCommandType::SetRootDescriptorTable, (static_cast<uint64_t>(index) << 56) ^ handle); }
+	void IASetVertexBuffers(uint64_t address) { Record_(NullCommandType::SetVertexBuffers, address); }
+	void IASetIndexBuffer(uint64_t address) { Record_(NullCommandType::SetIndexBuffer, address); }
+	void DrawIndexedInstanced(int indexCount, int instanceCount) { Record_(NullCommandType::DrawIndexedInstanced, static_cast<uint64_t>(indexCount) * instanceCount); }
+	void RSSetViewports(int count) { Record_(NullCommandType::SetViewports, count); }
+	void RSSetScissorRects(int count) { Record_(NullCommandType::SetScissorRects, count); }
+	void ResourceBarrier(uint64_t resource) { Record_(NullCommandType::ResourceBarrier, resource); }
+	void OMSetRenderTargets(uint64_t renderTarget) { Record_(NullCommandType::SetRenderTargets, renderTarget); }
+	void ClearRenderTargetView(uint64_t renderTarget) { Record_(NullCommandType::ClearRenderTarget, renderTarget); }
+	void ClearDepthStencilView(uint64_t depthStencil) { Record_(NullCommandType::ClearDepthStencil, depthStencil); }
+
+	void ExecuteBundle(NullCommandList* pBundle)
+	{
+		Record_(NullCommandType::ExecuteBundle, reinterpret_cast<uintptr_t>(pBundle));
+		bundlePtrs_.push_back(pBundle);
+	}
+
+	const std::vector<Command>& Commands() { return commands_; }
+	const std::vector<NullCommandList*>& BundlePtrs() { return bundlePtrs_; }
+
+	// order-sensitive hash of the recording; two frames that record the same commands in the same order match
+	uint64_t Hash()
+	{
+		auto hash = 0xCBF29CE484222325ULL;
+		for (const auto& command : commands_)
+		{
+			hash = (hash ^ static_cast<uint64_t>(command.Type)) * 0x100000001B3ULL;
+			hash = (hash ^ command.Argument) * 0x100000001B3ULL;
+		}
+		return hash;
+	}
+
+private:
+	SubmitType type_;
+	bool isOpen_ = false;
+	std::vector<Command> commands_;
+	std::vector<NullCommandList*> bundlePtrs_;
+
+	void Record_(NullCommandType type, uint64_t argument)
+	{
+		commands_.push_back({ type, argument });
+	}
+};
+
+// completes every signal immediately
+class NullFence : public IFence
+{
+public:
+	uint64_t Signal() { return ++value_; }
+	uint64_t CompletedValue() override { return value_; }
+	void WaitForCompletion(uint64_t) override { }
+
+private:
+	uint64_t value_ = 0;
+};
+
+// counts what gets executed; bundles are counted where they are executed, like the GPU would see them
+class NullCommandQueue : public ICommandQueue
+{
+public:
+	NullFence* FencePtr() override { return &fence_; }
+
+	// NullCommandLists only
+	void Execute(ICommandList* const* pListPtrs, int count) override
+	{
+		for (auto i = 0; i < count; ++i)
+		{
+			Count_(static_cast<NullCommandList*>(pListPtrs[i]));
+		}
+		++executeCount_;
+	}
+
+	uint64_t Signal() override { return fence_.Signal(); }
+
+	long long CommandCount(NullCommandType type) { return commandCounts_[static_cast<int>(type)]; }
+	long long ExecuteCount() { return executeCount_; }
+
+	long long TotalCommandCount()
+	{
+		long long count = 0;
+		for (auto value : commandCounts_)
+		{
+			count += value;
+		}
+		return count;
+	}
+
+	void Reset()
+	{
+		for (auto& value : commandCounts_)
+		{
+			value = 0;
+		}
+		executeCount_ = 0;
+	}
+
+private:
+	NullFence fence_;
+	long long commandCounts_[cNullCommandTypeCount] = {};
+	long long executeCount_ = 0;
+
+	void Count_(NullCommandList* pList)
+	{
+		for (const auto& command : pList->Commands())
+		{
+			++commandCounts_[static_cast<int>(command.Type)];
+		}
+		for (auto pBundle : pList->BundlePtrs())
+		{
+			Count_(pBundle);
+		}
+	}
+};
+
+// CPU memory in place of an upload heap; cbuffers are written through Map() like the real ones
+class NullBuffer
+{
+public:
+	// elementSize is rounded up to the 256 bytes D3D12 requires between constant buffer views
+	void Create(int elementSize, int elementCount)
+	{
+		stride_ = (elementSize + 255) & ~255;
+		data_.assign(static_cast<size_t>(stride_) * elementCount, 0);
+	}
+
+	int Stride() { return stride_; }
+	void* Map(int index) { return data_.data() + static_cast<size_t>(stride_) * index; }
+	uint64_t GpuVirtualAddress(int index) { return reinterpret_cast<uintptr_t>(Map(index)); }
+
+private:
+	int stride_ = 0;
+	std::vector<unsigned char> data_;
+};
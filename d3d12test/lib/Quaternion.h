@@ -0,0 +1,140 @@
+#pragma once
+#include "SinCos.h"
+#include <cmath>
+
+// unit quaternion rotation, 16 bytes against a rotation matrix's 64
+// the conventions are DirectXMath's: X, Y, Z is the axis part, W the scalar part, and the matrix of a rotation
+// is the one XMMatrixRotationQuaternion() builds (row-major, row vectors)
+struct Quaternion
+{
+	float X, Y, Z, W;
+};
+
+const Quaternion cQuaternionIdentity = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+// the rotation Transform has always used for Euler angles: about X, then Y, then Z
+inline Quaternion QuaternionFromEuler(float x, float y, float z)
+{
+	float sx, cx, sy, cy, sz, cz;
+	SinCos(x * 0.5f, &sx, &cx);
+	SinCos(y * 0.5f, &sy, &cy);
+	SinCos(z * 0.5f, &sz, &cz);
+
+	return
+	{
+		cz * cy * sx - sz * cx * sy,
+		cz * cx * sy + sz * cy * sx,
+		cx * cy * sz - cz * sx * sy,
+		cx * cy * cz + sx * sy * sz,
+	};
+}
+
+#if defined(SIN_COS_SSE)
+// four at a time, lanes giving the same bits as the scalar version
+inline void QuaternionFromEuler(__m128 x, __m128 y, __m128 z, __m128* pX, __m128* pY, __m128* pZ, __m128* pW)
+{
+	const auto half = _mm_set1_ps(0.5f);
+	__m128 sx, cx, sy, cy, sz, cz;
+	SinCos(_mm_mul_ps(x, half), &sx, &cx);
+	SinCos(_mm_mul_ps(y, half), &sy, &cy);
+	SinCos(_mm_mul_ps(z, half), &sz, &cz);
+
+	*pX = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(cz, cy), sx), _mm_mul_ps(_mm_mul_ps(sz, cx), sy));
+	*pY = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cz, cx), sy), _mm_mul_ps(_mm_mul_ps(sz, cy), sx));
+	*pZ = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(cx, cy), sz), _mm_mul_ps(_mm_mul_ps(cz, sx), sy));
+	*pW = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cx, cy), cz), _mm_mul_ps(_mm_mul_ps(sx, sy), sz));
+}
+#endif
+
+// back to X, Y, Z angles, y in [-pi/2, pi/2]; z is solved against the x actually found, which keeps it stable
+// near y = +-pi/2, where x and z stop being separable
+inline void QuaternionToEuler(const Quaternion& q, float* pX, float* pY, float* pZ)
+{
+	// the rotation matrix elements the angles come from
+	const auto m0 = 1.0f - 2.0f * (q.Y * q.Y + q.Z * q.Z);
+	const auto m1 = 2.0f * (q.X * q.Y + q.W * q.Z);
+	const auto m2 = 2.0f * (q.X * q.Z - q.W * q.Y);
+	const auto m4 = 2.0f * (q.X * q.Y - q.W * q.Z);
+	const auto m5 = 1.0f - 2.0f * (q.X * q.X + q.Z * q.Z);
+	const auto m6 = 2.0f * (q.Y * q.Z + q.W * q.X);
+	const auto m8 = 2.0f * (q.X * q.Z + q.W * q.Y);
+	const auto m9 = 2.0f * (q.Y * q.Z - q.W * q.X);
+	const auto m10 = 1.0f - 2.0f * (q.X * q.X + q.Y * q.Y);
+
+	const auto x = std::atan2(m6, m10);
+	const auto sx = std::sin(x);
+	const auto cx = std::cos(x);
+	*pX = x;
+	*pY = std::atan2(-m2, std::sqrt(m0 * m0 + m1 * m1));
+	*pZ = std::atan2(sx * m8 - cx * m4, cx * m5 - sx * m9);
+}
+
+// normalized linear interpolation along the shorter arc; not constant speed, but close to slerp for
+// neighbouring keys and a handful of multiplies
+inline Quaternion QuaternionNlerp(const Quaternion& a, const Quaternion& b, float t)
+{
+	const auto dot = a.X * b.X + a.Y * b.Y + a.Z * b.Z + a.W * b.W;
+	const auto u = 1.0f - t;
+	const auto v = (dot < 0.0f) ? -t : t;
+
+	const Quaternion q = { a.X * u + b.X * v, a.Y * u + b.Y * v, a.Z * u + b.Z * v, a.W * u + b.W * v };
+	const auto scale = 1.0f / std::sqrt(q.X * q.X + q.Y * q.Y + q.Z * q.Z + q.W * q.W);
+	return { q.X * scale, q.Y * scale, q.Z * scale, q.W * scale };
+}
+
+// constant speed along the shorter arc; falls back to nlerp where the two are nearly the same
+inline Quaternion QuaternionSlerp(const Quaternion& a, const Quaternion& b, float t)
+{
+	auto dot = a.X * b.X + a.Y * b.Y + a.Z * b.Z + a.W * b.W;
+	const auto sign = (dot < 0.0f) ? -1.0f : 1.0f;
+	dot *= sign;
+	if (dot > 0.9995f)
+	{
+		return QuaternionNlerp(a, b, t);
+	}
+
+	const auto angle = std::acos(dot);
+	const auto scale = 1.0f / std::sin(angle);
+	const auto u = std::sin((1.0f - t) * angle) * scale;
+	const auto v = std::sin(t * angle) * scale * sign;
+	return { a.X * u + b.X * v, a.Y * u + b.Y * v, a.Z * u + b.Z * v, a.W * u + b.W * v };
+}
+
+// scaling, then rotation, then translation, into 16 floats laid out like XMMATRIX
+// TransformStore's SIMD paths do the same operations in the same order, so they give the same bits
+inline void ComposeMatrix(const float* pScaling, const Quaternion& rotation, const float* pTranslation, float* pMatrix)
+{
+	const auto x2 = rotation.X + rotation.X;
+	const auto y2 = rotation.Y + rotation.Y;
+	const auto z2 = rotation.Z + rotation.Z;
+	const auto xx = rotation.X * x2;
+	const auto yy = rotation.Y * y2;
+	const auto zz = rotation.Z * z2;
+	const auto xy = rotation.X * y2;
+	const auto xz = rotation.X * z2;
+	const auto yz = rotation.Y * z2;
+	const auto wx = rotation.W * x2;
+	const auto wy = rotation.W * y2;
+	const auto wz = rotation.W * z2;
+
+	auto m = pMatrix;
+	m[0] = pScaling[0] * (1.0f - (yy + zz));
+	m[1] = pScaling[0] * (xy + wz);
+	m[2] = pScaling[0] * (xz - wy);
+	m[3] = 0.0f;
+
+	m[4] = pScaling[1] * (xy - wz);
+	m[5] = pScaling[1] * (1.0f - (xx + zz));
+	m[6] = pScaling[1] * (yz + wx);
+	m[7] = 0.0f;
+
+	m[8] = pScaling[2] * (xz + wy);
+	m[9] = pScaling[2] * (yz - wx);
+	m[10] = pScaling[2] * (1.0f - (xx + yy));
+	m[11] = 0.0f;
+
+	m[12] = pTranslation[0];
+	m[13] = pTranslation[1];
+	m[14] = pTranslation[2];
+	m[15] = 1.0f;
+}
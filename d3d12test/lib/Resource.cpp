@@ -142,14 +142,29 @@ HRESULT Resource::UpdateSubresources(const D3D12_SUBRESOURCE_DATA* pData, Comman
 	HRESULT result;
 
 	Resource intermediate;
-	result = ::UpdateSubresources(pDevice_, pData, firstSubresource, subresourceCount, this, pCommandList, &intermediate);
+	result = SubmitSubresources(pData, pCommandList, pCommandQueue, firstSubresource, subresourceCount, &intermediate, nullptr);
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	result = pCommandQueue->FencePtr()->WaitForCompletion();
+
+	return result;
+}
+
+HRESULT Resource::SubmitSubresources(const D3D12_SUBRESOURCE_DATA* pData, CommandList* pCommandList, CommandQueue* pCommandQueue, int firstSubresource, int subresourceCount, Resource* pIntermediate, UINT64* pFenceValue)
+{
+	HRESULT result;
+
+	result = ::UpdateSubresources(pDevice_, pData, firstSubresource, subresourceCount, this, pCommandList, pIntermediate);
 	if (FAILED(result))
 	{
 		return result;
 	}
 
 	pCommandQueue->Submit(pCommandList);
-	result = pCommandQueue->WaitForExecution();
+	result = pCommandQueue->Signal(pFenceValue);
 
 	return result;
 }
@@ -78,6 +78,10 @@ public:
 	HRESULT UpdateSubresource(const D3D12_SUBRESOURCE_DATA* pData, CommandList* pCommandList, CommandQueue* pCommandQueue, int subresource);
 	HRESULT UpdateSubresources(const D3D12_SUBRESOURCE_DATA* pData, CommandList* pCommandList, CommandQueue* pCommandQueue, int firstSubresource, int subresourceCount);
 
+	// same as UpdateSubresources() but returns after the submit; pIntermediate has to stay alive
+	// until the queue's fence reaches *pFenceValue
+	HRESULT SubmitSubresources(const D3D12_SUBRESOURCE_DATA* pData, CommandList* pCommandList, CommandQueue* pCommandQueue, int firstSubresource, int subresourceCount, Resource* pIntermediate, UINT64* pFenceValue);
+
 	D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView(int stride);
 	D3D12_INDEX_BUFFER_VIEW GetIndexBufferView(DXGI_FORMAT format);
 
@@ -4,6 +4,7 @@
 #include "ScreenContext.h"
 #include "Resource.h"
 #include "Texture.h"
+#include "Metrics.h"
 
 ResourceViewHeap::~ResourceViewHeap()
 {
@@ -44,6 +45,12 @@ HRESULT ResourceViewHeap::CreateHeap(Device* pDevice, const HeapDesc& desc)
 
 void ResourceViewHeap::Reset()
 {
+	if (pUsedGauge_ != nullptr)
+	{
+		pUsedGauge_->Add(-currentSize_);
+		pCapacityGauge_->Add(-static_cast<long long>(resourceCount_));
+	}
+
 	SafeRelease(&pDescriptorHeap_);
 	descriptorSize_ = 0U;
 	resourceCount_ = 0U;
@@ -80,7 +87,7 @@ std::vector<Resource*> ResourceViewHeap::CreateRenderTargetViewFromBackBuffer(Sc
 		
 		handle.ptr += descriptorSize_;
 
-		++currentSize_;
+		AddDescriptor_();
 	}
 
 	return resourcePtrs;
@@ -117,7 +124,7 @@ Resource* ResourceViewHeap::CreateDepthStencilView(ScreenContext* pContext, cons
 	pNativeDevice->CreateDepthStencilView(pResource->NativePtr(), &viewDesc, handle);
 	pResource->SetResourceViewHeap(this, currentSize_);
 
-	++currentSize_;
+	AddDescriptor_();
 
 	return pResource;
 }
@@ -147,7 +154,7 @@ Resource* ResourceViewHeap::CreateConstantBufferView(const CsvDesc& desc)
 	pNativeDevice->CreateConstantBufferView(&viewDesc, handle);
 	pResource->SetResourceViewHeap(this, currentSize_);
 
-	++currentSize_;
+	AddDescriptor_();
 
 	return pResource;
 }
@@ -184,7 +191,7 @@ Resource* ResourceViewHeap::CreateShaderResourceView(const SrvDesc& desc)
 	auto handle = CpuHandle(currentSize_);
 	pNativeDevice->CreateShaderResourceView(pResource->NativePtr(), &viewDesc, handle);
 
-	++currentSize_;
+	AddDescriptor_();
 
 	return pResource;
 }
@@ -214,5 +221,18 @@ HRESULT ResourceViewHeap::CreateHeapImpl_(
 	descriptorSize_ = pNativeDevice->GetDescriptorHandleIncrementSize(heapDesc.Type);
 	resourceCount_ = heapDesc.NumDescriptors;
 
+	const char* typeName =
+		(type == D3D12_DESCRIPTOR_HEAP_TYPE_RTV) ? "rtv" :
+		(type == D3D12_DESCRIPTOR_HEAP_TYPE_DSV) ? "dsv" : "cbv_srv_uav";
+	pUsedGauge_ = MetricsRegistry::Instance().Gauge(std::string("descriptors.") + typeName + ".used");
+	pCapacityGauge_ = MetricsRegistry::Instance().Gauge(std::string("descriptors.") + typeName + ".capacity");
+	pCapacityGauge_->Add(resourceCount_);
+
 	return result;
 }
+
+void ResourceViewHeap::AddDescriptor_()
+{
+	++currentSize_;
+	pUsedGauge_->Add(1);
+}
@@ -6,6 +6,7 @@ class Device;
 class ScreenContext;
 class Resource;
 class Texture;
+class MetricGauge;
 
 struct HeapDesc
 {
@@ -68,6 +69,12 @@ private:
 	UINT resourceCount_ = 0U;
 	int currentSize_ = 0;
 
+	// "descriptors.<type>.used" / ".capacity", summed over every heap of the type
+	MetricGauge* pUsedGauge_ = nullptr;
+	MetricGauge* pCapacityGauge_ = nullptr;
+
+	void AddDescriptor_();
+
 	HRESULT CreateHeapImpl_(
 		Device* pDevice,
 		const HeapDesc& desc,
@@ -0,0 +1,343 @@
+#pragma once
+#include "AlignedAllocator.h"
+#include "TaskQueue.h"
+#include "TaskGroup.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SCENE_GRAPH_SSE
+#include <emmintrin.h>
+#endif
+
+// parent/child hierarchy of local matrices, flattened for the per-frame world matrix update
+// nodes are stored sorted by depth (level order) with their parent's slot, so a level only reads
+// the level above it and can be split across workers; Prepare() re-sorts after Add()/SetParent()
+// SetLocal() and SetParent() dirty a node, and only dirty nodes and the subtrees under them are recomposed
+// matrices are 16 floats, row-major like XMMATRIX: world = local * parent world
+// everything but UpdateLevel() is single-threaded; UpdateLevel() slices of one level can run in parallel
+class SceneGraph
+{
+public:
+	typedef int Node;
+	static const Node cNoParent = -1;
+
+	SceneGraph() {}
+
+	SceneGraph(const SceneGraph&) = delete;
+	SceneGraph& operator=(const SceneGraph&) = delete;
+
+	void Reserve(int capacity)
+	{
+		parentNodes_.reserve(capacity);
+		nodeSlots_.reserve(capacity);
+		slotNodes_.reserve(capacity);
+		parentSlots_.reserve(capacity);
+		locals_.reserve(capacity);
+		worlds_.reserve(capacity);
+		isDirty_.reserve(capacity);
+		isChanged_.reserve(capacity);
+	}
+
+	// identity local; nodes live as long as the graph
+	Node Add(Node parent = cNoParent)
+	{
+		const auto node = NodeCount();
+		const auto slot = node;
+		const auto parentSlot = (parent == cNoParent) ? static_cast<int>(cNoParent) : nodeSlots_[parent];
+
+		parentNodes_.push_back(parent);
+		nodeSlots_.push_back(slot);
+		slotNodes_.push_back(node);
+		parentSlots_.push_back(parentSlot);
+		locals_.push_back(Identity_());
+		worlds_.push_back(Identity_());
+		isDirty_.push_back(0);
+		isChanged_.push_back(0);
+
+		isSorted_ = false;
+		MarkDirty_(slot);
+		return node;
+	}
+
+	// false (and nothing changes) if parent is node itself or one of its descendants
+	bool SetParent(Node node, Node parent)
+	{
+		for (auto ancestor = parent; ancestor != cNoParent; ancestor = parentNodes_[ancestor])
+		{
+			if (ancestor == node)
+			{
+				return false;
+			}
+		}
+
+		if (parentNodes_[node] != parent)
+		{
+			parentNodes_[node] = parent;
+			isSorted_ = false;
+			MarkDirty_(nodeSlots_[node]);
+		}
+		return true;
+	}
+
+	int NodeCount() { return static_cast<int>(parentNodes_.size()); }
+	Node Parent(Node node) { return parentNodes_[node]; }
+
+	// setting the matrix a node already has doesn't dirty it
+	void SetLocal(Node node, const float* pMatrix)
+	{
+		const auto slot = nodeSlots_[node];
+		if (memcmp(locals_[slot].M, pMatrix, sizeof(Matrix_)) == 0)
+		{
+			return;
+		}
+		memcpy(locals_[slot].M, pMatrix, sizeof(Matrix_));
+		MarkDirty_(slot);
+	}
+
+	const float* Local(Node node) { return locals_[nodeSlots_[node]].M; }
+
+	// as of the last update
+	const float* World(Node node) { return worlds_[nodeSlots_[node]].M; }
+
+	// level order, valid from Prepare() until the next Add()/SetParent()
+	int LevelCount() { return static_cast<int>(levelOffsets_.size()) - 1; }
+	int LevelSize(int level) { return levelOffsets_[level + 1] - levelOffsets_[level]; }
+
+	// an update is Prepare(), UpdateLevel() over every level in order, then FinishUpdate()
+	void Prepare()
+	{
+		if (!isSorted_)
+		{
+			Sort_();
+		}
+	}
+
+	// recomposes the dirty nodes among [begin, end) of level, and those whose parent was recomposed
+	void UpdateLevel(int level, int begin, int end)
+	{
+		if (level < firstDirtyLevel_)
+		{
+			return;
+		}
+
+		const auto offset = levelOffsets_[level];
+		for (auto slot = offset + begin; slot < offset + end; ++slot)
+		{
+			const auto parentSlot = parentSlots_[slot];
+			if (!isDirty_[slot] && (parentSlot == cNoParent || !isChanged_[parentSlot]))
+			{
+				continue;
+			}
+
+			if (parentSlot == cNoParent)
+			{
+				worlds_[slot] = locals_[slot];
+			}
+			else
+			{
+				Multiply_(locals_[slot], worlds_[parentSlot], &worlds_[slot]);
+			}
+			isChanged_[slot] = 1;
+		}
+	}
+
+	void FinishUpdate()
+	{
+		if (firstDirtyLevel_ < LevelCount())
+		{
+			const auto offset = levelOffsets_[firstDirtyLevel_];
+			const auto count = NodeCount() - offset;
+			memset(isDirty_.data() + offset, 0, count);
+			memset(isChanged_.data() + offset, 0, count);
+		}
+		firstDirtyLevel_ = LevelCount();
+	}
+
+	// the whole update; levels of cMinParallelLevelSize nodes or more are split across pQueue
+	// don't call it from a worker of pQueue
+	void UpdateWorld(TaskQueue* pQueue = nullptr)
+	{
+		Prepare();
+
+		for (auto level = firstDirtyLevel_; level < LevelCount(); ++level)
+		{
+			const auto levelSize = LevelSize(level);
+			if (pQueue == nullptr || levelSize < cMinParallelLevelSize)
+			{
+				UpdateLevel(level, 0, levelSize);
+				continue;
+			}
+
+			TaskGroup group;
+			pQueue->ParallelFor(0, levelSize, 0, [this, level](int begin, int end)
+			{
+				UpdateLevel(level, begin, end);
+			}, &group);
+			group.Wait();
+		}
+
+		FinishUpdate();
+	}
+
+	static const int cMinParallelLevelSize = 256;
+
+private:
+	// for Multiply_()'s _mm_load_ps()/_mm_store_ps(); std::vector's default allocator wouldn't keep it on Win32 x86
+	struct alignas(16) Matrix_
+	{
+		float M[16];
+	};
+	typedef std::vector<Matrix_, AlignedAllocator<Matrix_>> Matrices_;
+
+	std::vector<Node> parentNodes_;
+	std::vector<int> nodeSlots_;
+
+	// by slot, in level order once sorted
+	std::vector<Node> slotNodes_;
+	std::vector<int> parentSlots_;
+	Matrices_ locals_;
+	Matrices_ worlds_;
+	std::vector<uint8_t> isDirty_;
+	std::vector<uint8_t> isChanged_;	// recomposed during the current update
+
+	std::vector<int> levelOffsets_ = { 0 };
+	bool isSorted_ = true;
+	int firstDirtyLevel_ = 0;
+
+	std::vector<int> depths_;	// by node, scratch for Sort_()
+
+	static Matrix_ Identity_()
+	{
+		return { { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f } };
+	}
+
+	// until the next Sort_(), which finds the first dirty level itself
+	void MarkDirty_(int slot)
+	{
+		isDirty_[slot] = 1;
+		if (isSorted_)
+		{
+			const auto depth = static_cast<int>(std::upper_bound(levelOffsets_.begin(), levelOffsets_.end(), slot) - levelOffsets_.begin()) - 1;
+			firstDirtyLevel_ = std::min(firstDirtyLevel_, depth);
+		}
+	}
+
+	int Depth_(Node node)
+	{
+		// walk up to a root or a node whose depth is known, then fill the path in on the way back
+		auto top = node;
+		auto length = 0;
+		while (depths_[top] < 0 && parentNodes_[top] != cNoParent)
+		{
+			top = parentNodes_[top];
+			++length;
+		}
+		if (depths_[top] < 0)
+		{
+			depths_[top] = 0;
+		}
+
+		const auto depth = depths_[top] + length;
+		auto n = node;
+		for (auto d = depth; n != top; --d)
+		{
+			depths_[n] = d;
+			n = parentNodes_[n];
+		}
+		return depth;
+	}
+
+	// stable counting sort of the nodes by depth; matrices and dirty flags move with their nodes
+	void Sort_()
+	{
+		const auto nodeCount = NodeCount();
+
+		depths_.assign(nodeCount, -1);
+		auto levelCount = 0;
+		for (auto node = 0; node < nodeCount; ++node)
+		{
+			levelCount = std::max(levelCount, Depth_(node) + 1);
+		}
+
+		levelOffsets_.assign(levelCount + 1, 0);
+		for (auto node = 0; node < nodeCount; ++node)
+		{
+			++levelOffsets_[depths_[node] + 1];
+		}
+		for (auto level = 0; level < levelCount; ++level)
+		{
+			levelOffsets_[level + 1] += levelOffsets_[level];
+		}
+
+		std::vector<int> newSlots(nodeCount);
+		std::vector<int> nextSlots(levelOffsets_.begin(), levelOffsets_.end() - 1);
+		for (auto node = 0; node < nodeCount; ++node)
+		{
+			newSlots[node] = nextSlots[depths_[node]]++;
+		}
+
+		Matrices_ locals(nodeCount);
+		Matrices_ worlds(nodeCount);
+		std::vector<uint8_t> isDirty(nodeCount);
+		for (auto node = 0; node < nodeCount; ++node)
+		{
+			const auto oldSlot = nodeSlots_[node];
+			const auto slot = newSlots[node];
+			locals[slot] = locals_[oldSlot];
+			worlds[slot] = worlds_[oldSlot];
+			isDirty[slot] = isDirty_[oldSlot];
+		}
+		locals_.swap(locals);
+		worlds_.swap(worlds);
+		isDirty_.swap(isDirty);
+		isChanged_.assign(nodeCount, 0);
+
+		nodeSlots_.swap(newSlots);
+		firstDirtyLevel_ = levelCount;
+		for (auto node = 0; node < nodeCount; ++node)
+		{
+			const auto slot = nodeSlots_[node];
+			const auto parent = parentNodes_[node];
+			slotNodes_[slot] = node;
+			parentSlots_[slot] = (parent == cNoParent) ? cNoParent : nodeSlots_[parent];
+			if (isDirty_[slot])
+			{
+				firstDirtyLevel_ = std::min(firstDirtyLevel_, depths_[node]);
+			}
+		}
+
+		isSorted_ = true;
+	}
+
+	// row by row: out[i] = a[i][0] * b[0] + a[i][1] * b[1] + a[i][2] * b[2] + a[i][3] * b[3]
+	static void Multiply_(const Matrix_& a, const Matrix_& b, Matrix_* pOut)
+	{
+#if defined(SCENE_GRAPH_SSE)
+		const auto b0 = _mm_load_ps(b.M);
+		const auto b1 = _mm_load_ps(b.M + 4);
+		const auto b2 = _mm_load_ps(b.M + 8);
+		const auto b3 = _mm_load_ps(b.M + 12);
+		for (auto i = 0; i < 4; ++i)
+		{
+			const auto pRow = a.M + i * 4;
+			auto row = _mm_mul_ps(_mm_set1_ps(pRow[0]), b0);
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[1]), b1));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[2]), b2));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(pRow[3]), b3));
+			_mm_store_ps(pOut->M + i * 4, row);
+		}
+#else
+		for (auto i = 0; i < 4; ++i)
+		{
+			for (auto j = 0; j < 4; ++j)
+			{
+				pOut->M[i * 4 + j] =
+					a.M[i * 4] * b.M[j] + a.M[i * 4 + 1] * b.M[4 + j] + a.M[i * 4 + 2] * b.M[8 + j] + a.M[i * 4 + 3] * b.M[12 + j];
+			}
+		}
+#endif
+	}
+};
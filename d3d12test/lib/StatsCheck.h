@@ -0,0 +1,385 @@
+#pragma once
+#include "Clock.h"
+#include "CpuStopwatch.h"
+#include "FrameStats.h"
+#include "LatencyHistogram.h"
+#include "AllocTracker.h"
+#include "CpuProfiler.h"
+#include "GpuQueryRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// headless checks of the timing and statistics code against inputs with known answers
+// nothing here touches the GPU or the window, so they run anywhere the headers build;
+// each check prints what failed and returns the number of failures
+
+inline int StatsExpect(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("  FAILED: %s\n", what);
+		return 1;
+	}
+	return 0;
+}
+
+inline int StatsExpectNear(double value, double expected, double tolerance, const char* what)
+{
+	if (std::abs(value - expected) > tolerance)
+	{
+		printf("  FAILED: %s: %f, expected %f +- %f\n", what, value, expected, tolerance);
+		return 1;
+	}
+	return 0;
+}
+
+// Clock and CpuStopwatch: monotonic, and a sleep measures at least as long as it slept
+inline int CheckClock()
+{
+	auto failureCount = 0;
+
+	failureCount += StatsExpect(Clock::Frequency() > 0, "clock frequency");
+
+	auto isMonotonic = true;
+	auto previous = Clock::Ticks();
+	for (auto i = 0; i < 100000; ++i)
+	{
+		const auto ticks = Clock::Ticks();
+		isMonotonic = isMonotonic && ticks >= previous;
+		previous = ticks;
+	}
+	failureCount += StatsExpect(isMonotonic, "clock never goes backwards");
+
+	// sleeps only guarantee a lower bound; the upper one just catches a wrong frequency
+	const auto begin = Clock::Ticks();
+	const auto steadyBegin = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	const auto elapsed = Clock::TicksToMilliseconds(Clock::Ticks() - begin);
+	const auto steadyElapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - steadyBegin).count();
+	failureCount += StatsExpect(elapsed >= 49.9, "50 ms sleep measures at least 50 ms");
+	failureCount += StatsExpectNear(elapsed, steadyElapsed, steadyElapsed * 0.05 + 0.1, "clock agrees with steady_clock");
+
+	CpuStopwatch watch;
+	watch.Start();
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	watch.Stop();
+	failureCount += StatsExpect(watch.ElaspedMilliseconds() >= 9.9, "stopwatch measures a 10 ms sleep");
+	failureCount += StatsExpect(watch.ElaspedMilliseconds() < 1000.0, "stopwatch doesn't overshoot");
+
+	watch.Reset();
+	failureCount += StatsExpect(watch.ElaspedMilliseconds() == 0.0, "stopwatch reset");
+
+	return failureCount;
+}
+
+// FrameStats over 100 frames of 1..100 ms CPU time (GPU half of that); every 10th interval is 40 ms
+// instead of 16 ms against a 60 fps target
+inline int CheckFrameStats()
+{
+	auto failureCount = 0;
+
+	FrameStats stats(16);
+	stats.SetTargetFrameRate(60.0);
+	for (auto i = 0; i < 100; ++i)
+	{
+		const auto cpuTime = i + 1.0;
+		stats.AddFrame(cpuTime, cpuTime * 0.5, (i % 10 == 9) ? 40.0 : 16.0);
+	}
+
+	failureCount += StatsExpect(stats.FrameCount() == 100, "frame count");
+	failureCount += StatsExpectNear(stats.CpuTime(), 5050.0, 1e-9, "CPU time sum");
+	failureCount += StatsExpectNear(stats.AverageCpuTime(), 50.5, 1e-9, "average CPU time");
+	failureCount += StatsExpectNear(stats.AverageGpuTime(), 25.25, 1e-9, "average GPU time");
+	failureCount += StatsExpectNear(stats.MaxCpuTime(), 100.0, 1e-9, "max CPU time");
+	failureCount += StatsExpectNear(stats.CpuTimeStdDev(), std::sqrt((100.0 * 100.0 - 1.0) / 12.0), 1e-6, "CPU time stddev");
+	failureCount += StatsExpectNear(stats.CpuUtilization(), 50.5 * 100.0 / (1000.0 / 60.0), 1e-6, "CPU utilization");
+
+	// the histogram's buckets are ~3% wide
+	failureCount += StatsExpectNear(stats.CpuTimePercentile(50.0), 50.0, 1.5, "CPU p50");
+	failureCount += StatsExpectNear(stats.CpuTimePercentile(95.0), 95.0, 2.9, "CPU p95");
+	failureCount += StatsExpectNear(stats.CpuTimePercentile(99.0), 99.0, 3.0, "CPU p99");
+	failureCount += StatsExpect(stats.CpuTimePercentile(100.0) > 97.0 && stats.CpuTimePercentile(100.0) <= 100.0, "CPU p100 within the top bucket");
+	failureCount += StatsExpectNear(stats.GpuTimePercentile(50.0), 25.0, 0.75, "GPU p50");
+
+	failureCount += StatsExpectNear(stats.FrameRate(), 1000.0 / 18.4, 1e-6, "frame rate");
+	failureCount += StatsExpectNear(stats.IntervalPercentile(50.0), 16.0, 0.5, "interval p50");
+	failureCount += StatsExpect(stats.LateFrameCount() == 10, "late frames");
+	failureCount += StatsExpectNear(stats.AverageJitter(), 19.0 * 24.0 / 99.0, 1e-9, "average jitter");
+	failureCount += StatsExpectNear(stats.MaxJitter(), 24.0, 1e-9, "max jitter");
+
+	failureCount += StatsExpect(stats.SampleCount() == 16, "sample ring keeps its capacity");
+	failureCount += StatsExpectNear(stats.Sample(0).CpuTime, 100.0, 1e-9, "newest sample");
+	failureCount += StatsExpectNear(stats.Sample(15).CpuTime, 85.0, 1e-9, "oldest sample");
+	failureCount += StatsExpectNear(stats.Sample(0).Interval, 40.0, 1e-9, "newest interval");
+
+	stats.Reset();
+	failureCount += StatsExpect(stats.FrameCount() == 0, "reset frame count");
+	failureCount += StatsExpect(stats.CpuTimePercentile(50.0) == 0.0, "reset percentiles");
+	failureCount += StatsExpect(stats.CpuTimeStdDev() == 0.0, "reset stddev");
+	failureCount += StatsExpect(stats.LateFrameCount() == 0, "reset late frames");
+	failureCount += StatsExpectNear(stats.Sample(0).CpuTime, 100.0, 1e-9, "reset keeps the sample ring");
+
+	return failureCount;
+}
+
+// LatencyHistogram: bucket edges, exact microseconds below 64us, ~3% above, percentiles against a known
+// distribution, Merge and the clamping at both ends
+inline int CheckLatencyHistogram()
+{
+	auto failureCount = 0;
+
+	auto isExact = true;
+	for (auto i = 0; i < 64; ++i)
+	{
+		isExact = isExact && LatencyHistogram::BucketOf(i / 1000.0) == i;
+	}
+	failureCount += StatsExpect(isExact, "one bucket per microsecond below 64us");
+
+	// every bucket holds its own middle, and above the exact range is at most 1/32 of its value wide
+	auto isOrdered = true;
+	auto maxWidth = 0.0;
+	for (auto i = 0; i < LatencyHistogram::BucketCount() - 1; ++i)
+	{
+		const auto middle = LatencyHistogram::BucketMiddle(i);
+		const auto nextMiddle = LatencyHistogram::BucketMiddle(i + 1);
+		isOrdered = isOrdered && LatencyHistogram::BucketOf(middle) == i && nextMiddle > middle;
+		if (i >= 64)
+		{
+			maxWidth = std::max(maxWidth, (nextMiddle - middle) / middle);
+		}
+	}
+	failureCount += StatsExpect(isOrdered, "buckets hold their middles in order");
+	failureCount += StatsExpect(maxWidth <= 1.0 / 32.0, "bucket width within 1/32");
+	failureCount += StatsExpect(LatencyHistogram::BucketOf(-1.0) == 0, "negative values land in the first bucket");
+	failureCount += StatsExpect(LatencyHistogram::BucketOf(1e6) == LatencyHistogram::BucketCount() - 1, "overflow lands in the last bucket");
+
+	LatencyHistogram empty;
+	failureCount += StatsExpect(empty.Percentile(50.0) == 0.0 && empty.Min() == 0.0 && empty.Count() == 0, "empty histogram");
+
+	// a single value is every percentile, exactly
+	LatencyHistogram single;
+	single.Add(5.0);
+	failureCount += StatsExpect(single.Percentile(0.0) == 5.0 && single.Percentile(50.0) == 5.0 && single.Percentile(100.0) == 5.0, "single value clamps to itself");
+
+	// 10..19us, exact range: the rank-th value's bucket middle, half a microsecond above it
+	LatencyHistogram small;
+	for (auto i = 10; i < 20; ++i)
+	{
+		small.Add(i / 1000.0);
+	}
+	failureCount += StatsExpectNear(small.Percentile(50.0), 0.0145, 1e-9, "exact-range p50");
+	failureCount += StatsExpectNear(small.Percentile(10.0), 0.0105, 1e-9, "exact-range p10");
+	failureCount += StatsExpectNear(small.Percentile(-10.0), 0.0105, 1e-9, "percentile below 0 is p0");
+	failureCount += StatsExpectNear(small.Percentile(150.0), 0.019, 1e-9, "percentile above 100 clamps to the max");
+
+	// 1us..100ms uniform: p is p ms, within one bucket
+	LatencyHistogram uniform;
+	LatencyHistogram lower;
+	LatencyHistogram upper;
+	for (auto i = 1; i <= 100000; ++i)
+	{
+		const auto value = i / 1000.0;
+		uniform.Add(value);
+		((i <= 50000) ? lower : upper).Add(value);
+	}
+	failureCount += StatsExpect(uniform.Count() == 100000, "uniform count");
+	failureCount += StatsExpectNear(uniform.Min(), 0.001, 1e-12, "uniform min");
+	failureCount += StatsExpectNear(uniform.Max(), 100.0, 1e-12, "uniform max");
+	failureCount += StatsExpectNear(uniform.Average(), 50.0005, 1e-6, "uniform average");
+	const double percentiles[] = { 1.0, 10.0, 50.0, 90.0, 95.0, 99.0, 99.9 };
+	for (auto p : percentiles)
+	{
+		failureCount += StatsExpectNear(uniform.Percentile(p), p, p / 32.0, "uniform percentile");
+	}
+
+	// merging the two halves gives the same histogram as adding everything to one; merging an empty one changes nothing
+	LatencyHistogram merged;
+	merged.Merge(empty);
+	merged.Merge(upper);
+	merged.Merge(lower);
+	merged.Merge(empty);
+	auto isSame = merged.Count() == uniform.Count() && merged.Min() == uniform.Min() && merged.Max() == uniform.Max();
+	for (auto p = 0; p <= 100; ++p)
+	{
+		isSame = isSame && merged.Percentile(p) == uniform.Percentile(p);
+	}
+	failureCount += StatsExpect(isSame, "merged halves match the whole");
+	failureCount += StatsExpectNear(merged.Sum(), uniform.Sum(), 1e-6, "merged sum");
+
+	// a 100s outlier lands in the last bucket; the max still reports it
+	LatencyHistogram outlier;
+	outlier.Add(1.0);
+	outlier.Add(100000.0);
+	failureCount += StatsExpectNear(outlier.Percentile(100.0), LatencyHistogram::BucketMiddle(LatencyHistogram::BucketCount() - 1), 1e-9, "outlier percentile");
+	failureCount += StatsExpect(outlier.Max() == 100000.0, "outlier max");
+
+	uniform.Reset();
+	failureCount += StatsExpect(uniform.Count() == 0 && uniform.Percentile(99.0) == 0.0 && uniform.Max() == 0.0, "reset");
+
+	return failureCount;
+}
+
+// FrameStats after construction: adding frames and reading the statistics never touches the heap
+inline int CheckFrameStatsAllocations()
+{
+	FrameStats stats;
+	auto& tracker = AllocTracker::Instance();
+	const auto wasEnabled = tracker.IsEnabled();
+
+	tracker.SetEnabled(true);
+	tracker.Skip();
+	auto total = 0.0;
+	for (auto i = 0; i < 10000; ++i)
+	{
+		stats.AddFrame(10.0 + i % 7, 5.0 + i % 3, 16.0 + i % 5);
+		total += stats.CpuTimePercentile(99.0) + stats.IntervalPercentile(50.0) + stats.AverageJitter() + stats.Sample(0).CpuTime;
+		if (i % 1000 == 999)
+		{
+			stats.Reset();
+		}
+	}
+	const auto count = tracker.EndFrame();
+	tracker.SetEnabled(wasEnabled);
+
+	return StatsExpect(count == 0 && total > 0.0, "no allocations after construction");
+}
+
+// GpuQueryRing against a fake timestamp source standing in for the query heap: query slots, frames read back
+// only once their fence has completed and in order, the ring and zone limits, and the CPU zone each zone
+// is reported under
+inline int CheckGpuQueryRing()
+{
+	static const GpuProfileZone cOuterZone = { "outer" };
+	static const GpuProfileZone cInnerZone = { "inner" };
+	static const GpuProfileZone cNextZone = { "next" };
+	static const CpuProfileZone cCpuZone = { "cpu" };
+	static const CpuProfileZone cNestedCpuZone = { "nested_cpu" };
+
+	auto failureCount = 0;
+
+	GpuQueryRing ring;
+	ring.Setup(3, 4);
+	failureCount += StatsExpect(ring.FrameCapacity() == 3 && ring.QueryCount() == 24, "query count");
+
+	// what the GPU writes to the query heap, in ticks of 1us
+	const uint64_t frequency = 1000000ULL;
+	std::vector<uint64_t> heap(ring.QueryCount(), 0ULL);
+	const auto read = [&heap](int first, int count, uint64_t* pTimestamps)
+	{
+		std::copy(heap.begin() + first, heap.begin() + first + count, pTimestamps);
+	};
+
+	// frame n: outer takes 100 + n us with inner (50us) inside it in the same CPU zone, then next (0us) in another
+	uint64_t cpuPath = 0ULL;
+	uint64_t nextCpuPath = 0ULL;
+	auto cpuThread = -1;
+	const auto recordFrame = [&](int n)
+	{
+		auto isValid = ring.BeginFrame();
+		const auto first = ring.FrameFirstQuery();
+		const auto base = 1000ULL * (n + 1);
+
+		const auto outerBegin = ring.BeginZone(&cOuterZone, cpuThread, cpuPath);
+		const auto innerBegin = ring.BeginZone(&cInnerZone, cpuThread, cpuPath);
+		const auto innerEnd = ring.EndZone();
+		const auto outerEnd = ring.EndZone();
+		const auto nextBegin = ring.BeginZone(&cNextZone, cpuThread, nextCpuPath);
+		const auto nextEnd = ring.EndZone();
+
+		isValid = isValid && outerBegin == first && outerEnd == first + 1 && innerBegin == first + 2 && innerEnd == first + 3
+			&& nextBegin == first + 4 && nextEnd == first + 5 && ring.FrameQueryCount() == 6;
+		if (isValid)
+		{
+			heap[outerBegin] = base;
+			heap[outerEnd] = base + 100 + n;
+			heap[innerBegin] = base + 10;
+			heap[innerEnd] = base + 60;
+			heap[nextBegin] = base + 200;
+			heap[nextEnd] = base + 200;
+		}
+
+		ring.EndFrame(n + 1);
+		return isValid;
+	};
+
+	{
+		CpuProfileScope scope(&cCpuZone);
+		CpuProfiler::Instance().CurrentZone(&cpuThread, &cpuPath);
+	}
+	{
+		CpuProfileScope scope(&cCpuZone);
+		CpuProfileScope nestedScope(&cNestedCpuZone);
+		int thread;
+		CpuProfiler::Instance().CurrentZone(&thread, &nextCpuPath);
+	}
+	int outsideThread;
+	uint64_t outsidePath;
+	CpuProfiler::Instance().CurrentZone(&outsideThread, &outsidePath);
+	failureCount += StatsExpect(cpuPath != 0ULL && nextCpuPath != 0ULL && cpuPath != nextCpuPath, "CPU zones have paths");
+	failureCount += StatsExpect(outsidePath == 0ULL && outsideThread == cpuThread, "no CPU zone outside any scope");
+
+	failureCount += StatsExpect(recordFrame(0) && recordFrame(1) && recordFrame(2), "query slots of three frames");
+	failureCount += StatsExpect(ring.InFlightCount() == 3, "three frames in flight");
+
+	// every slot waits for the GPU: the frame is dropped and its zones aren't recorded
+	failureCount += StatsExpect(!ring.BeginFrame() && ring.DroppedFrameCount() == 1, "full ring drops the frame");
+	failureCount += StatsExpect(ring.BeginZone(&cOuterZone) == -1 && ring.EndZone() == -1, "dropped frame records nothing");
+	ring.EndFrame(100);
+
+	failureCount += StatsExpect(!ring.CollectFrame(0, frequency, read), "nothing read before the fence");
+
+	// the fence reached frame 0 only
+	failureCount += StatsExpect(ring.CollectFrame(1, frequency, read), "frame 0 read after its fence");
+	failureCount += StatsExpect(!ring.CollectFrame(1, frequency, read), "frame 1 waits for its fence");
+	failureCount += StatsExpect(ring.LastFrameNumber() == 0, "frame 0 number");
+
+	const auto& zones = ring.LastFrameZones();
+	if (StatsExpect(zones.size() == 3, "frame 0 zones") == 0)
+	{
+		failureCount += StatsExpectNear(zones[0].Milliseconds, 0.1, 1e-9, "outer time");
+		failureCount += StatsExpectNear(zones[1].Milliseconds, 0.05, 1e-9, "inner time");
+		failureCount += StatsExpectNear(zones[2].Milliseconds, 0.0, 1e-9, "empty zone time");
+		failureCount += StatsExpect(zones[0].Depth == 0 && zones[1].Depth == 1 && zones[2].Depth == 0, "zone depths");
+		failureCount += StatsExpect(zones[1].ParentPath == zones[0].Path && zones[2].ParentPath == 0ULL, "zone parents");
+		failureCount += StatsExpect(zones[0].OwnerThread == cpuThread && zones[0].OwnerPath == cpuPath && zones[2].OwnerPath == nextCpuPath, "CPU owners");
+		failureCount += StatsExpect(!zones[0].IsNestedInOwner && zones[1].IsNestedInOwner && !zones[2].IsNestedInOwner, "nested zones counted once");
+	}
+	else
+	{
+		++failureCount;
+	}
+
+	// frame 3 reuses frame 0's slot; frames 1-3 come back in order, each with its own timestamps
+	failureCount += StatsExpect(recordFrame(3) && ring.FrameFirstQuery() == 0, "freed slot reused");
+	failureCount += StatsExpect(ring.Latency() == 3, "latency while frames are in flight");
+	auto isInOrder = true;
+	for (auto n = 1; n <= 3; ++n)
+	{
+		isInOrder = isInOrder && ring.CollectFrame(4, frequency, read) && ring.LastFrameNumber() == n
+			&& std::abs(ring.LastFrameZones()[0].Milliseconds - (100 + n) / 1000.0) < 1e-9;
+	}
+	failureCount += StatsExpect(isInOrder, "frames read back in order with their own timestamps");
+	failureCount += StatsExpect(!ring.CollectFrame(4, frequency, read) && ring.InFlightCount() == 0 && ring.Latency() == 0, "drained");
+
+	// four zones per frame: the fifth and everything nested in it isn't recorded, and the nesting still unwinds
+	ring.BeginFrame();
+	auto isLimited = true;
+	for (auto i = 0; i < 4; ++i)
+	{
+		isLimited = isLimited && ring.BeginZone(&cOuterZone) >= 0 && ring.EndZone() >= 0;
+	}
+	isLimited = isLimited && ring.BeginZone(&cOuterZone) == -1 && ring.BeginZone(&cInnerZone) == -1;
+	isLimited = isLimited && ring.EndZone() == -1 && ring.EndZone() == -1 && ring.EndZone() == -1;
+	isLimited = isLimited && ring.FrameQueryCount() == 8;
+	failureCount += StatsExpect(isLimited, "zone limit");
+
+	// a frame that never ends is read back as empty instead of blocking the ring
+	ring.BeginFrame();
+	failureCount += StatsExpect(ring.CollectFrame(0, frequency, read) && ring.LastFrameZones().empty(), "unended frame read back empty");
+
+	return failureCount;
+}
@@ -0,0 +1,214 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+class TaskGroup;
+
+// move-only void() callable with fixed inline storage; never touches the heap
+class Task
+{
+public:
+	static const int cStorageSize = 64;
+
+public:
+	Task() {}
+
+	template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+	Task(F&& f)
+	{
+		Emplace(std::forward<F>(f));
+	}
+
+	Task(Task&& other)
+	{
+		MoveFrom_(other);
+	}
+
+	Task& operator=(Task&& other)
+	{
+		if (this != &other)
+		{
+			Reset();
+			MoveFrom_(other);
+		}
+		return *this;
+	}
+
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	~Task()
+	{
+		Reset();
+	}
+
+	explicit operator bool() const { return pOps_ != nullptr; }
+
+	TaskGroup* GroupPtr() { return pGroup_; }
+	void SetGroup(TaskGroup* pGroup) { pGroup_ = pGroup; }
+
+	void operator()()
+	{
+		pOps_->Invoke(storage_);
+	}
+
+	template<class F>
+	void Emplace(F&& f)
+	{
+		typedef typename std::decay<F>::type Fn;
+		static_assert(sizeof(Fn) <= cStorageSize, "task captures too much; capture by reference or pointer");
+		static_assert(alignof(Fn) <= alignof(std::max_align_t), "task is over-aligned");
+
+		Reset();
+		new (storage_) Fn(std::forward<F>(f));
+		pOps_ = &Ops_<Fn>::Table;
+	}
+
+	void Reset()
+	{
+		if (pOps_ != nullptr)
+		{
+			pOps_->Destroy(storage_);
+			pOps_ = nullptr;
+		}
+		pGroup_ = nullptr;
+	}
+
+private:
+	struct OpsTable_
+	{
+		void(*Invoke)(void*);
+		void(*MoveTo)(void*, void*);
+		void(*Destroy)(void*);
+	};
+
+	template<class Fn>
+	struct Ops_
+	{
+		static void Invoke(void* p) { (*static_cast<Fn*>(p))(); }
+		static void MoveTo(void* pSrc, void* pDest) { new (pDest) Fn(std::move(*static_cast<Fn*>(pSrc))); }
+		static void Destroy(void* p) { static_cast<Fn*>(p)->~Fn(); }
+
+		static const OpsTable_ Table;
+	};
+
+	alignas(std::max_align_t) unsigned char storage_[cStorageSize];
+	const OpsTable_* pOps_ = nullptr;
+	TaskGroup* pGroup_ = nullptr;
+
+	void MoveFrom_(Task& other)
+	{
+		if (other.pOps_ != nullptr)
+		{
+			other.pOps_->MoveTo(other.storage_, storage_);
+			pOps_ = other.pOps_;
+			pGroup_ = other.pGroup_;
+			other.Reset();
+		}
+	}
+};
+
+template<class Fn>
+const Task::OpsTable_ Task::Ops_<Fn>::Table = { &Task::Ops_<Fn>::Invoke, &Task::Ops_<Fn>::MoveTo, &Task::Ops_<Fn>::Destroy };
+
+// fixed set of Task slots shared by all threads (tagged lock-free free list)
+// Allocate() falls back to the heap only when every slot is in flight
+class TaskPool
+{
+public:
+	void Setup(int capacity)
+	{
+		capacity_ = capacity;
+		slots_.reset(new Slot_[capacity]);
+
+		for (auto i = 0; i < capacity; ++i)
+		{
+			// links are 1-based, 0 terminates the list
+			slots_[i].Next.store((i + 1 < capacity) ? i + 2 : 0, std::memory_order_relaxed);
+		}
+		head_.store((capacity > 0) ? 1ULL : 0ULL);
+	}
+
+	template<class F>
+	Task* Allocate(F&& f)
+	{
+		auto pTask = PopFree_();
+		if (pTask == nullptr)
+		{
+			pTask = new Task();
+		}
+
+		pTask->Emplace(std::forward<F>(f));
+		return pTask;
+	}
+
+	void Free(Task* pTask)
+	{
+		pTask->Reset();
+
+		const auto address = reinterpret_cast<uintptr_t>(pTask);
+		const auto begin = reinterpret_cast<uintptr_t>(slots_.get());
+		if (address < begin || address >= begin + sizeof(Slot_) * capacity_)
+		{
+			delete pTask;
+			return;
+		}
+
+		auto pSlot = &slots_[(address - begin) / sizeof(Slot_)];
+		const auto link = static_cast<unsigned long long>(pSlot - slots_.get()) + 1ULL;
+
+		auto head = head_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			pSlot->Next.store(static_cast<int>(head & cLinkMask), std::memory_order_relaxed);
+
+			const auto newHead = (((head >> 32) + 1ULL) << 32) | link;
+			if (head_.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+	}
+
+private:
+	struct Slot_
+	{
+		Task Body; // must stay first
+		std::atomic<int> Next;
+	};
+
+	static const unsigned long long cLinkMask = 0xFFFFFFFFULL;
+
+	std::unique_ptr<Slot_[]> slots_;
+	int capacity_ = 0;
+
+	// upper 32 bits: ABA tag, lower 32 bits: 1-based slot link
+	std::atomic<unsigned long long> head_{ 0ULL };
+
+	Task* PopFree_()
+	{
+		auto head = head_.load(std::memory_order_acquire);
+		while (true)
+		{
+			const auto link = head & cLinkMask;
+			if (link == 0)
+			{
+				return nullptr;
+			}
+
+			auto& slot = slots_[link - 1];
+			const auto next = static_cast<unsigned long long>(slot.Next.load(std::memory_order_relaxed));
+
+			const auto newHead = (((head >> 32) + 1ULL) << 32) | next;
+			if (head_.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				return &slot.Body;
+			}
+		}
+	}
+};
@@ -0,0 +1,167 @@
+#pragma once
+#include "TaskQueue.h"
+#include <functional>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+// DAG of jobs run on a TaskQueue
+// build once with AddJob/AddDependency, then Run/Wait every frame; Run does not reallocate
+// unless the graph was changed since the last Run
+class TaskGraph
+{
+public:
+	~TaskGraph()
+	{
+		Wait();
+	}
+
+	int JobCount() { return static_cast<int>(jobs_.size()); }
+
+	int AddJob(std::function<void()> job)
+	{
+		Job_ item;
+		item.Body = std::move(job);
+		jobs_.push_back(std::move(item));
+
+		isDirty_ = true;
+		return static_cast<int>(jobs_.size()) - 1;
+	}
+
+	// successor starts after predecessor has finished; the graph must stay acyclic
+	void AddDependency(int predecessor, int successor)
+	{
+		jobs_[predecessor].Successors.push_back(successor);
+		++jobs_[successor].PredecessorCount;
+
+		isDirty_ = true;
+	}
+
+	void Clear()
+	{
+		Wait();
+
+		jobs_.clear();
+		rootJobs_.clear();
+		counters_.reset();
+		isDirty_ = true;
+	}
+
+	void Run(TaskQueue* pQueue)
+	{
+		if (jobs_.empty())
+		{
+			return;
+		}
+
+		if (isDirty_)
+		{
+			Commit_();
+		}
+
+		for (auto i = 0; i < JobCount(); ++i)
+		{
+			counters_[i].store(jobs_[i].PredecessorCount, std::memory_order_relaxed);
+		}
+		remainingCount_.store(JobCount());
+
+		for (auto index : rootJobs_)
+		{
+			pQueue->Enqueue([this, pQueue, index]() { RunJob_(pQueue, index); });
+		}
+	}
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lk(doneLock_);
+		doneEvent_.wait(lk, [this]() { return remainingCount_.load() == 0; });
+	}
+
+private:
+	struct Job_
+	{
+		std::function<void()> Body;
+		std::vector<int> Successors;
+		int PredecessorCount = 0;
+	};
+
+	std::vector<Job_> jobs_;
+	std::vector<int> rootJobs_;
+	std::unique_ptr<std::atomic<int>[]> counters_;
+	bool isDirty_ = false;
+
+	std::atomic<int> remainingCount_{ 0 };
+	std::mutex doneLock_;
+	std::condition_variable doneEvent_;
+
+	void Commit_()
+	{
+		counters_.reset(new std::atomic<int>[jobs_.size()]);
+
+		rootJobs_.clear();
+		for (auto i = 0; i < JobCount(); ++i)
+		{
+			if (jobs_[i].PredecessorCount == 0)
+			{
+				rootJobs_.push_back(i);
+			}
+		}
+
+		isDirty_ = false;
+	}
+
+	void FinishJob_()
+	{
+		auto count = remainingCount_.load();
+		while (count > 1)
+		{
+			if (remainingCount_.compare_exchange_weak(count, count - 1))
+			{
+				return;
+			}
+		}
+
+		// the last decrement happens under the lock, so Wait() can't see zero and let the graph be
+		// destroyed while this thread is still about to notify
+		std::unique_lock<std::mutex> lk(doneLock_);
+		if (remainingCount_.fetch_sub(1) == 1)
+		{
+			doneEvent_.notify_all();
+		}
+	}
+
+	void RunJob_(TaskQueue* pQueue, int index)
+	{
+		while (index >= 0)
+		{
+			auto& job = jobs_[index];
+			job.Body();
+
+			// the first successor that becomes ready runs on this thread as a continuation,
+			// the others go back to the queue
+			auto next = -1;
+			for (auto successor : job.Successors)
+			{
+				if (counters_[successor].fetch_sub(1) != 1)
+				{
+					continue;
+				}
+
+				if (next < 0)
+				{
+					next = successor;
+				}
+				else
+				{
+					pQueue->Enqueue([this, pQueue, successor]() { RunJob_(pQueue, successor); });
+				}
+			}
+
+			FinishJob_();
+
+			index = next;
+		}
+	}
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// completion counter for a batch of tasks submitted to a TaskQueue
+// tasks enqueued from inside a member task join the same group before their parent finishes,
+// so Wait() also covers work spawned by ParallelFor splits
+// don't call Wait() from a worker of the same queue
+class TaskGroup
+{
+public:
+	TaskGroup() {}
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+	~TaskGroup()
+	{
+		Wait();
+	}
+
+	int Count() { return count_.load(); }
+	bool IsDone() { return count_.load() == 0; }
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lk(lock_);
+		doneEvent_.wait(lk, [this]() { return count_.load() == 0; });
+	}
+
+	void Add()
+	{
+		count_.fetch_add(1);
+	}
+
+	void Done()
+	{
+		auto count = count_.load();
+		while (count > 1)
+		{
+			if (count_.compare_exchange_weak(count, count - 1))
+			{
+				return;
+			}
+		}
+
+		// the last decrement happens under the lock so that a waiter can't return
+		// and destroy the group while we are still notifying
+		std::unique_lock<std::mutex> lk(lock_);
+		if (count_.fetch_sub(1) == 1)
+		{
+			doneEvent_.notify_all();
+		}
+	}
+
+private:
+	std::atomic<int> count_{ 0 };
+	std::mutex lock_;
+	std::condition_variable doneEvent_;
+};
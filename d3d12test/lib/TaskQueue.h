@@ -1,18 +1,62 @@
 #pragma once
+#include "WorkStealingDeque.h"
+#include "MpmcQueue.h"
+#include "Metrics.h"
+#include "Task.h"
+#include "TaskGroup.h"
+#include "ThreadUtil.h"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <vector>
-#include <queue>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
+
+enum class TaskPriority
+{
+	Critical,	// frame work; runs before anything else
+	Background,	// streaming/loading; only picked up when no critical task is runnable
+};
+
+const int cTaskPriorityCount = 2;
+const unsigned int cAllTaskPriorities = (1U << cTaskPriorityCount) - 1U;
+
+inline unsigned int TaskPriorityBit(TaskPriority priority) { return 1U << static_cast<int>(priority); }
+
+struct TaskWorkerDesc
+{
+	int Core;					// logical core to pin to, -1 leaves the worker unpinned
+	unsigned int PriorityMask;	// TaskPriorityBit()s this worker may run
+};
+
+struct TaskQueueDesc;
 
 class TaskQueue
 {
+public:
+	enum class Mode
+	{
+		SharedQueue,	// every worker pops from one locked queue
+		WorkStealing,	// per-worker deques + random-victim stealing
+		LockFree,		// every worker pops from one lock-free bounded ring; for many concurrent producers
+	};
+
+	static TaskQueueDesc DefaultDesc(int threadCount, Mode mode);
+
 public:
 	~TaskQueue()
 	{
-		isExited_ = true;
+		{
+			std::unique_lock<std::mutex> lk(queueLock_);
+			isExited_ = true;
+		}
 		enqueueEvent_.notify_all();
 
 		WaitAll();
@@ -27,73 +71,208 @@ public:
 	}
 
 	int ThreadCount() { return static_cast<int>(workers_.size()); }
+	Mode QueueMode() { return mode_; }
+
+	void Setup(int threadCount, Mode mode = Mode::SharedQueue);
 
-	void Setup(int threadCount)
+	// throws std::invalid_argument if a priority has no worker whose PriorityMask accepts it,
+	// since its tasks would never run and waiting on them would never return
+	void Setup(const TaskQueueDesc& desc);
+
+	// task is moved into a pooled slot; it must fit in Task::cStorageSize bytes
+	// pGroup (optional) is signaled when the task has finished
+	template<class F>
+	void Enqueue(F&& task, TaskGroup* pGroup = nullptr, TaskPriority priority = TaskPriority::Critical)
 	{
-		auto& queue = taskQueue_;
-		auto& queueLock = queueLock_;
-		auto& enqueueEvent = enqueueEvent_;
-		auto& emptyEvent = emptyEvent_;
-		auto& isExited = isExited_;
+		Push_(std::forward<F>(task), pGroup, priority);
+		Wake_(1, priority);
+	}
 
-		for (auto i = 0; i < threadCount; ++i)
+	// calls fn(rangeBegin, rangeEnd) over [begin, end) split into chunks of at most grain items
+	// grain <= 0 picks a chunk size from the range length and the thread count
+	// returns immediately; wait with pGroup->Wait() or WaitAll()
+	// fn is copied into every chunk, so keep its captures small
+	template<class Fn>
+	void ParallelFor(int begin, int end, int grain, Fn fn, TaskGroup* pGroup = nullptr)
+	{
+		if (begin >= end)
 		{
-			workers_.emplace_back([&queue, &queueLock, &enqueueEvent, &emptyEvent, &isExited]()
-			{
-				while (true)
-				{
-					std::function<void()> task;
+			return;
+		}
 
-					{
-						std::unique_lock<std::mutex> lk(queueLock);
-						enqueueEvent.wait(lk, [&queue, &isExited]() 
-						{
-							return isExited || !queue.empty();
-						});
+		if (grain <= 0)
+		{
+			grain = std::max(1, (end - begin) / (std::max(1, ThreadCount()) * cChunksPerThread));
+		}
 
-						if (isExited && queue.empty())
-						{
-							break;
-						}
+		if (mode_ == Mode::WorkStealing)
+		{
+			// split recursively on the workers so that idle threads can steal the larger halves
+			Enqueue([this, begin, end, grain, fn, pGroup]() { ParallelForRec_(begin, end, grain, fn, pGroup); }, pGroup);
+			return;
+		}
 
-						task = std::move(queue.front());
-						queue.pop();
-					}
+		// wake everybody once after the whole batch is queued instead of once per chunk
+		auto chunkCount = 0;
+		for (auto i = begin; i < end; i += grain)
+		{
+			const auto chunkEnd = std::min(i + grain, end);
+			Push_([i, chunkEnd, fn]() { fn(i, chunkEnd); }, pGroup, TaskPriority::Critical);
+			++chunkCount;
+		}
+		Wake_(chunkCount, TaskPriority::Critical);
+	}
 
-					task();
+	// background tasks only start while the time they used since BeginFrame() is under the budget;
+	// a task that overruns is paid back from the following frames, at most one frame's budget per task
+	// 0 (default) disables the budget; set it before waiting on background work without a frame loop
+	void SetBackgroundBudget(double milliseconds)
+	{
+		backgroundBudget_.store(static_cast<long long>(milliseconds * 1000.0));
 
-					{
-						std::unique_lock<std::mutex> lk(queueLock);
-						if (queue.empty())
-						{
-							emptyEvent.notify_all();
-						}
-					}
-				}
-			});
+		// workers parked on an exhausted budget re-check it
+		{
+			std::unique_lock<std::mutex> lk(queueLock_);
 		}
+		enqueueEvent_.notify_all();
 	}
 
-	void Enqueue(std::function<void()> task)
+	double BackgroundBudget() { return backgroundBudget_.load() / 1000.0; }
+
+	// time background tasks finished during the last frame
+	double LastFrameBackgroundMilliseconds() { return lastFrameBackgroundTime_ / 1000.0; }
+
+	// call once per frame from the thread that drives the frame loop
+	void BeginFrame()
 	{
+		const auto budget = backgroundBudget_.load();
+		const auto frameTime = frameBackgroundTime_.exchange(0);
+		lastFrameBackgroundTime_ = frameTime;
+
+		auto debt = backgroundDebt_.load();
+		while (!backgroundDebt_.compare_exchange_weak(debt, std::max(0LL, debt - budget)))
 		{
-			std::unique_lock<std::mutex> lk(queueLock_);
-			taskQueue_.emplace(task);
 		}
-		enqueueEvent_.notify_one();
+
+		auto pendingCount = 0;
+		for (auto& count : pendingCounts_)
+		{
+			pendingCount += count.load();
+		}
+		pPendingGauge_->Set(pendingCount);
+
+		if (pendingCounts_[static_cast<int>(TaskPriority::Background)].load() > 0)
+		{
+			{
+				std::unique_lock<std::mutex> lk(queueLock_);
+			}
+			enqueueEvent_.notify_all();
+		}
 	}
 
+	// waits until every task submitted so far (and everything they spawned) has finished running
 	void WaitAll()
 	{
-		auto& queue = taskQueue_;
-
 		std::unique_lock<std::mutex> lk(emptyLock_);
-		emptyEvent_.wait(lk, [&queue]() { return queue.empty(); });
+		emptyEvent_.wait(lk, [this]() { return unfinishedCount_.load() == 0; });
 	}
 
 private:
+	// FIFO of task pointers; grows only when full, so steady-state frames don't allocate
+	class TaskRing_
+	{
+	public:
+		void Setup(int capacity)
+		{
+			auto size = 1;
+			while (size < capacity)
+			{
+				size <<= 1;
+			}
+			buffer_.assign(size, nullptr);
+			head_ = 0;
+			count_ = 0;
+		}
+
+		bool Empty() { return count_ == 0; }
+
+		void Push(Task* pTask)
+		{
+			if (count_ == static_cast<int>(buffer_.size()))
+			{
+				Grow_();
+			}
+			buffer_[(head_ + count_) & (buffer_.size() - 1)] = pTask;
+			++count_;
+		}
+
+		Task* Pop()
+		{
+			if (count_ == 0)
+			{
+				return nullptr;
+			}
+			auto pTask = buffer_[head_];
+			head_ = (head_ + 1) & (buffer_.size() - 1);
+			--count_;
+			return pTask;
+		}
+
+	private:
+		std::vector<Task*> buffer_;
+		size_t head_ = 0;
+		int count_ = 0;
+
+		void Grow_()
+		{
+			std::vector<Task*> buffer(std::max<size_t>(buffer_.size() * 2, 16));
+			for (auto i = 0; i < count_; ++i)
+			{
+				buffer[i] = buffer_[(head_ + i) & (buffer_.size() - 1)];
+			}
+			buffer_.swap(buffer);
+			head_ = 0;
+		}
+	};
+
+	struct WorkerContext_
+	{
+		TaskQueue* pOwner = nullptr;
+		int index = -1;
+	};
+
+	static const int cLocalQueueCapacity = 4096;
+	static const int cChunksPerThread = 8;
+	static const int cTaskPoolCapacity = 8192;
+
+	Mode mode_ = Mode::SharedQueue;
+	std::string name_;
 	std::vector<std::thread> workers_;
-	std::queue<std::function<void()>> taskQueue_;
+	std::vector<int> workerCores_;
+	std::vector<unsigned int> workerPriorityMasks_;
+	unsigned int commonPriorityMask_ = cAllTaskPriorities; // priorities every worker accepts
+	int idleSpinCount_ = 0;
+	int idleYieldCount_ = 0;
+
+	TaskPool taskPool_;
+	TaskRing_ queues_[cTaskPriorityCount];
+
+	std::vector<std::unique_ptr<WorkStealingDeque<Task>>> localQueues_;
+	std::unique_ptr<MpmcQueue<Task*>> lockFreeQueues_[cTaskPriorityCount];
+	std::atomic<int> pendingCounts_[cTaskPriorityCount] = {};
+	std::atomic<int> lockedCounts_[cTaskPriorityCount] = {};	// WorkStealing/LockFree: tasks in queues_, read before taking queueLock_
+	std::atomic<int> unfinishedCount_{ 0 };
+
+	// "task_queue.<name>.enqueued" / ".pending" (sampled at BeginFrame())
+	MetricCounter* pEnqueuedCounter_ = nullptr;
+	MetricGauge* pPendingGauge_ = nullptr;
+
+	// microseconds
+	std::atomic<long long> backgroundBudget_{ 0 };
+	std::atomic<long long> backgroundDebt_{ 0 };
+	std::atomic<long long> frameBackgroundTime_{ 0 };
+	long long lastFrameBackgroundTime_ = 0;
+	std::atomic<int> sleepingCount_{ 0 };
 
 	std::mutex queueLock_;
 	std::condition_variable enqueueEvent_;
@@ -101,6 +280,593 @@ private:
 	std::mutex emptyLock_;
 	std::condition_variable emptyEvent_;
 
-	bool isExited_ = false;
+	std::atomic<bool> isExited_{ false };
+
+	static WorkerContext_& CurrentWorker_()
+	{
+		static thread_local WorkerContext_ context;
+		return context;
+	}
+
+	static bool CanRun_(unsigned int mask, TaskPriority priority)
+	{
+		return (mask & TaskPriorityBit(priority)) != 0;
+	}
+
+	bool HasBackgroundBudget_()
+	{
+		// never hold tasks back while shutting down, WaitAll() would not return
+		const auto budget = backgroundBudget_.load();
+		return budget <= 0 || isExited_ || backgroundDebt_.load() < budget;
+	}
+
+	bool CanStart_(unsigned int mask, TaskPriority priority)
+	{
+		return CanRun_(mask, priority) && (priority != TaskPriority::Background || HasBackgroundBudget_());
+	}
+
+	void SetupWorkerThread_(int index)
+	{
+		SetCurrentThreadName(name_ + " " + std::to_string(index));
+		if (workerCores_[index] >= 0)
+		{
+			SetCurrentThreadAffinity(workerCores_[index]);
+		}
+	}
+
+	template<class F>
+	void Push_(F&& task, TaskGroup* pGroup, TaskPriority priority)
+	{
+		auto pTask = taskPool_.Allocate(std::forward<F>(task));
+
+		pTask->SetGroup(pGroup);
+		if (pGroup != nullptr)
+		{
+			pGroup->Add();
+		}
+		unfinishedCount_.fetch_add(1);
+		pEnqueuedCounter_->Add();
+
+		if (mode_ == Mode::WorkStealing)
+		{
+			PushStealing_(pTask, priority);
+			return;
+		}
+		if (mode_ == Mode::LockFree)
+		{
+			PushLockFree_(pTask, priority);
+			return;
+		}
+
+		const auto priorityIndex = static_cast<int>(priority);
+
+		std::unique_lock<std::mutex> lk(queueLock_);
+		queues_[priorityIndex].Push(pTask);
+		pendingCounts_[priorityIndex].fetch_add(1);
+	}
+
+	// wakes parked workers for taskCount new tasks; spinning workers find them on their own
+	void Wake_(int taskCount, TaskPriority priority)
+	{
+		const auto sleepingCount = sleepingCount_.load();
+		if (sleepingCount == 0)
+		{
+			return;
+		}
+
+		if (mode_ != Mode::SharedQueue)
+		{
+			// these pushes don't take the lock; pass through it so that a worker
+			// between its last check and wait() can't miss the notification
+			std::unique_lock<std::mutex> lk(queueLock_);
+		}
+
+		// notify_one could wake a worker that isn't allowed to run this priority
+		if (taskCount >= sleepingCount || !CanRun_(commonPriorityMask_, priority))
+		{
+			enqueueEvent_.notify_all();
+			return;
+		}
+
+		for (auto i = 0; i < taskCount; ++i)
+		{
+			enqueueEvent_.notify_one();
+		}
+	}
+
+	// spin, then yield; returns false when the worker should park
+	bool SpinForPending_(unsigned int mask)
+	{
+		for (auto i = 0; i < idleSpinCount_; ++i)
+		{
+			if (isExited_ || HasRunnablePending_(mask))
+			{
+				return true;
+			}
+			CpuRelax();
+		}
+
+		for (auto i = 0; i < idleYieldCount_; ++i)
+		{
+			if (isExited_ || HasRunnablePending_(mask))
+			{
+				return true;
+			}
+			std::this_thread::yield();
+		}
+
+		return false;
+	}
+
+	Task* PopShared_(unsigned int mask, TaskPriority* pPriority)
+	{
+		for (auto i = 0; i < cTaskPriorityCount; ++i)
+		{
+			const auto priority = static_cast<TaskPriority>(i);
+			if (CanStart_(mask, priority) && !queues_[i].Empty())
+			{
+				pendingCounts_[i].fetch_sub(1);
+				*pPriority = priority;
+				return queues_[i].Pop();
+			}
+		}
+		return nullptr;
+	}
+
+	void SharedWorkerMain_(int index)
+	{
+		SetupWorkerThread_(index);
+
+		const auto mask = workerPriorityMasks_[index];
+
+		while (true)
+		{
+			Task* pTask = nullptr;
+			auto priority = TaskPriority::Critical;
+
+			SpinForPending_(mask);
+
+			{
+				std::unique_lock<std::mutex> lk(queueLock_);
+				pTask = PopShared_(mask, &priority);
+				if (pTask == nullptr && !isExited_)
+				{
+					// counted under the lock, so Wake_() after any later push sees us
+					sleepingCount_.fetch_add(1);
+					enqueueEvent_.wait(lk, [this, mask, &pTask, &priority]()
+					{
+						pTask = PopShared_(mask, &priority);
+						return isExited_ || pTask != nullptr;
+					});
+					sleepingCount_.fetch_sub(1);
+				}
+			}
+
+			if (pTask != nullptr)
+			{
+				RunTask_(pTask, priority);
+				continue;
+			}
+
+			// exiting: keep going while running tasks may still spawn work for us
+			if (unfinishedCount_.load() == 0)
+			{
+				break;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	void PushStealing_(Task* pTask, TaskPriority priority)
+	{
+		const auto priorityIndex = static_cast<int>(priority);
+
+		// count first so that a worker never sees the task before the counter
+		pendingCounts_[priorityIndex].fetch_add(1);
+
+		auto& context = CurrentWorker_();
+		const auto isLocal =
+			priority == TaskPriority::Critical
+			&& context.pOwner == this
+			&& CanRun_(workerPriorityMasks_[context.index], priority)
+			&& localQueues_[context.index]->Push(pTask);
+		if (!isLocal)
+		{
+			std::unique_lock<std::mutex> lk(queueLock_);
+			queues_[priorityIndex].Push(pTask);
+			lockedCounts_[priorityIndex].fetch_add(1);
+		}
+	}
+
+	void PushLockFree_(Task* pTask, TaskPriority priority)
+	{
+		const auto priorityIndex = static_cast<int>(priority);
+		auto& queue = *lockFreeQueues_[priorityIndex];
+
+		// count first so that a worker never sees the task before the counter
+		pendingCounts_[priorityIndex].fetch_add(1);
+
+		if (queue.TryPush(pTask))
+		{
+			return;
+		}
+
+		// full: spill into the locked ring, from any thread; workers waiting here would never finish, running
+		// other tasks inline nests without bound when those push as well, and any other thread would spin forever
+		// on a ring of background tasks held back by the budget
+		std::unique_lock<std::mutex> lk(queueLock_);
+		queues_[priorityIndex].Push(pTask);
+		lockedCounts_[priorityIndex].fetch_add(1);
+	}
+
+	Task* PopLockFree_(unsigned int mask, TaskPriority* pPriority)
+	{
+		for (auto i = 0; i < cTaskPriorityCount; ++i)
+		{
+			const auto priority = static_cast<TaskPriority>(i);
+			if (!CanStart_(mask, priority))
+			{
+				continue;
+			}
+
+			Task* pTask = nullptr;
+			if (!lockFreeQueues_[i]->TryPop(&pTask))
+			{
+				pTask = PopLocked_(priority);
+			}
+
+			if (pTask != nullptr)
+			{
+				pendingCounts_[i].fetch_sub(1);
+				*pPriority = priority;
+				return pTask;
+			}
+		}
+		return nullptr;
+	}
+
+	void LockFreeWorkerMain_(int index)
+	{
+		SetupWorkerThread_(index);
+
+		auto& context = CurrentWorker_();
+		context.pOwner = this;
+		context.index = index;
+
+		const auto mask = workerPriorityMasks_[index];
+
+		while (true)
+		{
+			auto priority = TaskPriority::Critical;
+			auto pTask = PopLockFree_(mask, &priority);
+			if (pTask != nullptr)
+			{
+				RunTask_(pTask, priority);
+				continue;
+			}
+
+			if (isExited_ && unfinishedCount_.load() == 0)
+			{
+				break;
+			}
+
+			if (SpinForPending_(mask))
+			{
+				continue;
+			}
+
+			sleepingCount_.fetch_add(1);
+			{
+				std::unique_lock<std::mutex> lk(queueLock_);
+				enqueueEvent_.wait(lk, [this, mask]()
+				{
+					return isExited_ || HasRunnablePending_(mask);
+				});
+			}
+			sleepingCount_.fetch_sub(1);
+		}
+
+		context.pOwner = nullptr;
+		context.index = -1;
+	}
+
+	// idle workers poll here between steal attempts; the count keeps them off queueLock_ while queues_ is empty
+	Task* PopLocked_(TaskPriority priority)
+	{
+		const auto priorityIndex = static_cast<int>(priority);
+		if (lockedCounts_[priorityIndex].load() == 0)
+		{
+			return nullptr;
+		}
+
+		std::unique_lock<std::mutex> lk(queueLock_);
+		auto pTask = queues_[priorityIndex].Pop();
+		if (pTask != nullptr)
+		{
+			lockedCounts_[priorityIndex].fetch_sub(1);
+		}
+		return pTask;
+	}
+
+	Task* Steal_(int index, uint32_t* pRandom)
+	{
+		const auto count = static_cast<int>(localQueues_.size());
+		if (count <= 1)
+		{
+			return nullptr;
+		}
+
+		for (auto i = 0; i < count; ++i)
+		{
+			// xorshift32
+			auto x = *pRandom;
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			*pRandom = x;
+
+			const auto victim = static_cast<int>(x % count);
+			if (victim == index)
+			{
+				continue;
+			}
+
+			auto pTask = localQueues_[victim]->Steal();
+			if (pTask != nullptr)
+			{
+				return pTask;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void RunTask_(Task* pTask, TaskPriority priority)
+	{
+		auto pGroup = pTask->GroupPtr();
+
+		if (priority == TaskPriority::Background)
+		{
+			const auto begin = std::chrono::steady_clock::now();
+			(*pTask)();
+			const auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+
+			// a long task (an FBX import) would otherwise hold background work back for hundreds of frames
+			const auto budget = backgroundBudget_.load();
+			backgroundDebt_.fetch_add((budget > 0) ? std::min<long long>(time, budget) : time);
+			frameBackgroundTime_.fetch_add(time);
+		}
+		else
+		{
+			(*pTask)();
+		}
+		taskPool_.Free(pTask);
+
+		if (pGroup != nullptr)
+		{
+			pGroup->Done();
+		}
+
+		// tasks spawned by this task were counted before it finished,
+		// so reaching zero here means the whole tree is done
+		if (unfinishedCount_.fetch_sub(1) == 1)
+		{
+			std::unique_lock<std::mutex> lk(emptyLock_);
+			emptyEvent_.notify_all();
+		}
+	}
+
+	template<class Fn>
+	void ParallelForRec_(int begin, int end, int grain, const Fn& fn, TaskGroup* pGroup)
+	{
+		while (end - begin > grain)
+		{
+			const auto mid = begin + (end - begin) / 2;
+			Enqueue([this, mid, end, grain, fn, pGroup]() { ParallelForRec_(mid, end, grain, fn, pGroup); }, pGroup);
+			end = mid;
+		}
+
+		fn(begin, end);
+	}
+
+	bool HasRunnablePending_(unsigned int mask)
+	{
+		for (auto i = 0; i < cTaskPriorityCount; ++i)
+		{
+			if (CanStart_(mask, static_cast<TaskPriority>(i)) && pendingCounts_[i].load() > 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void StealingWorkerMain_(int index)
+	{
+		SetupWorkerThread_(index);
+
+		auto& context = CurrentWorker_();
+		context.pOwner = this;
+		context.index = index;
+
+		const auto mask = workerPriorityMasks_[index];
+		const auto canRunCritical = CanRun_(mask, TaskPriority::Critical);
+		const auto canRunBackground = CanRun_(mask, TaskPriority::Background);
+
+		auto& localQueue = *localQueues_[index];
+		auto random = static_cast<uint32_t>(index) * 2654435761U + 1U;
+
+		while (true)
+		{
+			Task* pTask = nullptr;
+			auto priority = TaskPriority::Critical;
+
+			if (canRunCritical)
+			{
+				pTask = localQueue.Pop();
+				if (pTask == nullptr)
+				{
+					pTask = PopLocked_(TaskPriority::Critical);
+				}
+				if (pTask == nullptr)
+				{
+					pTask = Steal_(index, &random);
+				}
+			}
+			// checked at every task boundary, so critical work preempts loading as soon as a background task ends
+			if (pTask == nullptr && canRunBackground && HasBackgroundBudget_())
+			{
+				pTask = PopLocked_(TaskPriority::Background);
+				priority = TaskPriority::Background;
+			}
+
+			if (pTask != nullptr)
+			{
+				pendingCounts_[static_cast<int>(priority)].fetch_sub(1);
+
+				RunTask_(pTask, priority);
+				continue;
+			}
+
+			if (isExited_ && unfinishedCount_.load() == 0)
+			{
+				break;
+			}
+
+			if (SpinForPending_(mask))
+			{
+				continue;
+			}
+
+			// nothing to run or steal: park until Enqueue() wakes us up
+			sleepingCount_.fetch_add(1);
+			{
+				std::unique_lock<std::mutex> lk(queueLock_);
+				enqueueEvent_.wait(lk, [this, mask]()
+				{
+					return isExited_ || HasRunnablePending_(mask);
+				});
+			}
+			sleepingCount_.fetch_sub(1);
+		}
+
+		context.pOwner = nullptr;
+		context.index = -1;
+	}
 };
 
+struct TaskQueueDesc
+{
+	TaskQueue::Mode Mode;
+	std::vector<TaskWorkerDesc> Workers;
+	std::string Name;			// workers show up as "<Name> <index>" in debuggers and profilers
+	bool PinWorkers;			// workers with Core < 0 are spread over the logical cores in order
+	bool ReserveMainThreadCore;	// pins the thread calling Setup() to core 0 and keeps workers off it
+
+	// idle workers poll this many times with a pause instruction, then this many times with a yield,
+	// before they park on the condition variable (0/0 parks right away)
+	int IdleSpinCount;
+	int IdleYieldCount;
+};
+
+inline TaskQueueDesc TaskQueue::DefaultDesc(int threadCount, Mode mode)
+{
+	const TaskWorkerDesc worker = { -1, cAllTaskPriorities };
+
+	TaskQueueDesc desc;
+	desc.Mode = mode;
+	desc.Workers.assign(threadCount, worker);
+	desc.Name = "TaskQueue";
+	desc.PinWorkers = false;
+	desc.ReserveMainThreadCore = false;
+	desc.IdleSpinCount = 2000;
+	desc.IdleYieldCount = 16;
+	return desc;
+}
+
+inline void TaskQueue::Setup(int threadCount, Mode mode)
+{
+	Setup(DefaultDesc(threadCount, mode));
+}
+
+inline void TaskQueue::Setup(const TaskQueueDesc& desc)
+{
+	auto acceptedPriorityMask = 0U;
+	for (const auto& worker : desc.Workers)
+	{
+		acceptedPriorityMask |= worker.PriorityMask;
+	}
+	if ((acceptedPriorityMask & cAllTaskPriorities) != cAllTaskPriorities)
+	{
+		throw std::invalid_argument("TaskQueue::Setup(): a task priority has no worker that accepts it");
+	}
+
+	mode_ = desc.Mode;
+	name_ = desc.Name;
+	pEnqueuedCounter_ = MetricsRegistry::Instance().Counter("task_queue." + name_ + ".enqueued");
+	pPendingGauge_ = MetricsRegistry::Instance().Gauge("task_queue." + name_ + ".pending");
+	idleSpinCount_ = desc.IdleSpinCount;
+	idleYieldCount_ = desc.IdleYieldCount;
+
+	const auto threadCount = static_cast<int>(desc.Workers.size());
+	const auto coreCount = HardwareThreadCount();
+	const auto firstCore = (desc.ReserveMainThreadCore && coreCount > 1) ? 1 : 0;
+
+	if (desc.ReserveMainThreadCore)
+	{
+		SetCurrentThreadAffinity(0);
+	}
+
+	commonPriorityMask_ = cAllTaskPriorities;
+	for (auto i = 0; i < threadCount; ++i)
+	{
+		const auto& worker = desc.Workers[i];
+
+		auto core = worker.Core;
+		if (core < 0 && desc.PinWorkers)
+		{
+			core = firstCore + i % (coreCount - firstCore);
+		}
+
+		workerCores_.push_back(core);
+		workerPriorityMasks_.push_back(worker.PriorityMask);
+		commonPriorityMask_ &= worker.PriorityMask;
+	}
+
+	taskPool_.Setup(cTaskPoolCapacity);
+	for (auto& queue : queues_)
+	{
+		queue.Setup(cTaskPoolCapacity);
+	}
+
+	if (mode_ == Mode::WorkStealing)
+	{
+		for (auto i = 0; i < threadCount; ++i)
+		{
+			localQueues_.emplace_back(new WorkStealingDeque<Task>(cLocalQueueCapacity));
+		}
+	}
+	else if (mode_ == Mode::LockFree)
+	{
+		for (auto& pQueue : lockFreeQueues_)
+		{
+			pQueue.reset(new MpmcQueue<Task*>(cTaskPoolCapacity));
+		}
+	}
+
+	for (auto i = 0; i < threadCount; ++i)
+	{
+		if (mode_ == Mode::WorkStealing)
+		{
+			workers_.emplace_back([this, i]() { StealingWorkerMain_(i); });
+		}
+		else if (mode_ == Mode::LockFree)
+		{
+			workers_.emplace_back([this, i]() { LockFreeWorkerMain_(i); });
+		}
+		else
+		{
+			workers_.emplace_back([this, i]() { SharedWorkerMain_(i); });
+		}
+	}
+}
@@ -0,0 +1,480 @@
+#pragma once
+#include "TaskQueue.h"
+#include "TaskGroup.h"
+#include "AllocTracker.h"
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+// fixed width, for the probe and check tables
+inline const char* TaskQueueModeName(TaskQueue::Mode mode)
+{
+	switch (mode)
+	{
+		case TaskQueue::Mode::SharedQueue: return "shared  ";
+		case TaskQueue::Mode::WorkStealing: return "stealing";
+		case TaskQueue::Mode::LockFree: return "lockfree";
+	}
+	return "";
+}
+
+// enqueue-to-start latency, in microseconds
+struct TaskLatencyReport
+{
+	int SampleCount;
+	double P50;
+	double P99;
+	double P999;
+	double Max;
+};
+
+// submits burstCount bursts of burstSize tasks, sleeping intervalMicroseconds between bursts
+// so that the workers go idle the way they do between frames
+inline TaskLatencyReport MeasureTaskStartLatency(TaskQueue* pQueue, int burstCount, int burstSize, int intervalMicroseconds)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<double> samples(burstCount * burstSize);
+	auto pSamples = samples.data();
+
+	for (auto i = 0; i < burstCount; ++i)
+	{
+		TaskGroup group;
+		for (auto j = 0; j < burstSize; ++j)
+		{
+			const auto index = i * burstSize + j;
+			const auto begin = Clock::now();
+			pQueue->Enqueue([pSamples, index, begin]()
+			{
+				pSamples[index] = std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+			}, &group);
+		}
+		group.Wait();
+
+		std::this_thread::sleep_for(std::chrono::microseconds(intervalMicroseconds));
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	const auto percentile = [&samples](double p)
+	{
+		const auto index = std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+		return samples[index];
+	};
+
+	TaskLatencyReport report = {};
+	if (samples.empty())
+	{
+		return report;
+	}
+
+	report.SampleCount = static_cast<int>(samples.size());
+	report.P50 = percentile(0.5);
+	report.P99 = percentile(0.99);
+	report.P999 = percentile(0.999);
+	report.Max = samples.back();
+	return report;
+}
+
+// producerCount threads enqueue tasksPerProducer empty tasks each, all at once
+// returns finished tasks per second, measured until the last one has run
+inline double MeasureTaskThroughput(TaskQueue* pQueue, int producerCount, int tasksPerProducer)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	TaskGroup group;
+	std::atomic<bool> isStarted{ false };
+
+	std::vector<std::thread> producers;
+	for (auto i = 0; i < producerCount; ++i)
+	{
+		producers.emplace_back([pQueue, tasksPerProducer, &group, &isStarted]()
+		{
+			while (!isStarted)
+			{
+				std::this_thread::yield();
+			}
+
+			for (auto j = 0; j < tasksPerProducer; ++j)
+			{
+				pQueue->Enqueue([]() {}, &group);
+			}
+		});
+	}
+
+	const auto begin = Clock::now();
+	isStarted = true;
+
+	for (auto& producer : producers)
+	{
+		producer.join();
+	}
+	group.Wait();
+
+	const auto seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+	return producerCount * tasksPerProducer / seconds;
+}
+
+struct TaskStressReport
+{
+	long long EnqueuedCount;
+	long long FinishedCount;	// tasks that had run when WaitAll() returned
+	long long OrderErrorCount;	// tasks not finished yet when Wait() on their group or WaitAll() returned
+	int UnfinishedGroupCount;	// groups still counting when WaitAll() returned
+	double Milliseconds;
+};
+
+// taskCount tasks in all: parents in one outer group, each spawning childCount children from its worker
+// into one of groupCount inner groups, every other child at background priority
+// everything is queued at once; waiterCount threads each take every waiterCount-th inner group, wait on the
+// outer group and then on the inner group, and check that the tasks of the group they waited on had finished,
+// while this thread does the same for the whole tree with WaitAll()
+inline TaskStressReport StressTaskQueue(TaskQueue* pQueue, int taskCount, int childCount, int groupCount, int waiterCount)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	std::atomic<long long> finishedCount{ 0 };
+	auto pFinishedCount = &finishedCount;
+
+	// by task: parent i is i * (1 + childCount), its children follow it
+	const auto parentCount = taskCount / (1 + childCount);
+	const auto enqueuedCount = parentCount * (1 + childCount);
+	std::unique_ptr<std::atomic<int>[]> isDone(new std::atomic<int>[enqueuedCount]);
+	for (auto i = 0; i < enqueuedCount; ++i)
+	{
+		isDone[i].store(0, std::memory_order_relaxed);
+	}
+	auto pIsDone = isDone.get();
+
+	TaskGroup outerGroup;
+	std::unique_ptr<TaskGroup[]> innerGroups(new TaskGroup[groupCount]);
+
+	const auto begin = Clock::now();
+
+	for (auto i = 0; i < parentCount; ++i)
+	{
+		auto pInnerGroup = &innerGroups[i % groupCount];
+		const auto parent = i * (1 + childCount);
+		pQueue->Enqueue([pQueue, pInnerGroup, pFinishedCount, pIsDone, parent, childCount]()
+		{
+			for (auto j = 0; j < childCount; ++j)
+			{
+				const auto priority = ((j & 1) == 0) ? TaskPriority::Critical : TaskPriority::Background;
+				const auto child = parent + 1 + j;
+				pQueue->Enqueue([pFinishedCount, pIsDone, child]()
+				{
+					pFinishedCount->fetch_add(1);
+					pIsDone[child].store(1);
+				}, pInnerGroup, priority);
+			}
+			pFinishedCount->fetch_add(1);
+			pIsDone[parent].store(1);
+		}, &outerGroup);
+	}
+
+	// counted per task rather than per wait, so a wait that returns early shows how much it missed
+	std::atomic<long long> orderErrorCount{ 0 };
+	const auto countUnfinished = [pIsDone, &orderErrorCount](int first, int count)
+	{
+		for (auto i = first; i < first + count; ++i)
+		{
+			if (pIsDone[i].load() == 0)
+			{
+				orderErrorCount.fetch_add(1);
+			}
+		}
+	};
+
+	// started once every parent is queued, so the outer group can't be done before it has all of them;
+	// the inner groups have all their children once the outer group is done
+	std::vector<std::thread> waiters;
+	for (auto w = 0; w < waiterCount; ++w)
+	{
+		waiters.emplace_back([&outerGroup, &innerGroups, &countUnfinished, w, waiterCount, groupCount, parentCount, childCount]()
+		{
+			for (auto g = w; g < groupCount; g += waiterCount)
+			{
+				outerGroup.Wait();
+				for (auto i = g; i < parentCount; i += groupCount)
+				{
+					countUnfinished(i * (1 + childCount), 1);
+				}
+
+				innerGroups[g].Wait();
+				for (auto i = g; i < parentCount; i += groupCount)
+				{
+					countUnfinished(i * (1 + childCount) + 1, childCount);
+				}
+			}
+		});
+	}
+
+	pQueue->WaitAll();
+	countUnfinished(0, enqueuedCount);
+
+	TaskStressReport report = {};
+	report.Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	report.EnqueuedCount = enqueuedCount;
+	report.FinishedCount = finishedCount.load();
+	report.UnfinishedGroupCount = outerGroup.IsDone() ? 0 : 1;
+	for (auto i = 0; i < groupCount; ++i)
+	{
+		if (!innerGroups[i].IsDone())
+		{
+			++report.UnfinishedGroupCount;
+		}
+	}
+
+	for (auto& waiter : waiters)
+	{
+		waiter.join();
+	}
+	report.OrderErrorCount = orderErrorCount.load();
+	return report;
+}
+
+struct MpmcStressReport
+{
+	long long PushedCount;
+	long long MissingCount;		// pushed, never popped
+	long long DuplicateCount;	// popped more than once
+	long long OrderErrorCount;	// a consumer saw a producer's values out of order
+	double Milliseconds;
+};
+
+// producerCount threads push itemsPerProducer values each through a capacity-slot MpmcQueue while
+// consumerCount threads pop them; a small capacity keeps the ring running full and empty by turns
+// every value is tagged with its producer, so each pop can be checked off once and in order
+inline MpmcStressReport StressMpmcQueue(int producerCount, int consumerCount, int itemsPerProducer, int capacity)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const auto itemCount = static_cast<long long>(producerCount) * itemsPerProducer;
+
+	MpmcQueue<long long> queue(capacity);
+	std::unique_ptr<std::atomic<int>[]> popCounts(new std::atomic<int>[itemCount]);
+	for (auto i = 0LL; i < itemCount; ++i)
+	{
+		popCounts[i].store(0, std::memory_order_relaxed);
+	}
+
+	std::atomic<long long> poppedCount{ 0 };
+	std::atomic<long long> orderErrorCount{ 0 };
+	std::atomic<bool> isStarted{ false };
+
+	std::vector<std::thread> threads;
+	for (auto i = 0; i < producerCount; ++i)
+	{
+		threads.emplace_back([&queue, &isStarted, i, itemsPerProducer]()
+		{
+			while (!isStarted)
+			{
+				std::this_thread::yield();
+			}
+
+			const auto first = static_cast<long long>(i) * itemsPerProducer;
+			for (auto j = 0; j < itemsPerProducer; ++j)
+			{
+				while (!queue.TryPush(first + j))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	for (auto i = 0; i < consumerCount; ++i)
+	{
+		threads.emplace_back([&, producerCount, itemsPerProducer, itemCount]()
+		{
+			// the last value seen from every producer
+			std::vector<long long> lastValues(producerCount, -1);
+
+			while (poppedCount.load() < itemCount)
+			{
+				long long value;
+				if (!queue.TryPop(&value))
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				auto& lastValue = lastValues[static_cast<size_t>(value / itemsPerProducer)];
+				if (value <= lastValue)
+				{
+					orderErrorCount.fetch_add(1);
+				}
+				lastValue = value;
+
+				popCounts[value].fetch_add(1);
+				poppedCount.fetch_add(1);
+			}
+		});
+	}
+
+	const auto begin = Clock::now();
+	isStarted = true;
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	MpmcStressReport report = {};
+	report.Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	report.PushedCount = itemCount;
+	report.OrderErrorCount = orderErrorCount.load();
+	for (auto i = 0LL; i < itemCount; ++i)
+	{
+		const auto count = popCounts[i].load();
+		if (count == 0)
+		{
+			++report.MissingCount;
+		}
+		else if (count > 1)
+		{
+			report.DuplicateCount += count - 1;
+		}
+	}
+	return report;
+}
+
+// the same through a TaskQueue in LockFree mode: producerCount threads enqueue tasksPerProducer tasks each
+// while workers also push, and every task checks itself off; returns the tasks that didn't run exactly once
+inline long long StressLockFreeTaskQueue(int threadCount, int producerCount, int tasksPerProducer)
+{
+	const auto taskCount = static_cast<long long>(producerCount) * tasksPerProducer;
+	std::unique_ptr<std::atomic<int>[]> runCounts(new std::atomic<int>[taskCount]);
+	for (auto i = 0LL; i < taskCount; ++i)
+	{
+		runCounts[i].store(0, std::memory_order_relaxed);
+	}
+	auto pRunCounts = runCounts.get();
+
+	{
+		TaskQueue queue;
+		queue.Setup(threadCount, TaskQueue::Mode::LockFree);
+		auto pQueue = &queue;
+
+		std::vector<std::thread> producers;
+		for (auto i = 0; i < producerCount; ++i)
+		{
+			producers.emplace_back([pQueue, pRunCounts, i, tasksPerProducer]()
+			{
+				const auto first = static_cast<long long>(i) * tasksPerProducer;
+				for (auto j = 0; j < tasksPerProducer; j += 2)
+				{
+					// every other task is pushed from the worker that runs its parent
+					const auto index = first + j;
+					const auto hasChild = j + 1 < tasksPerProducer;
+					pQueue->Enqueue([pQueue, pRunCounts, index, hasChild]()
+					{
+						if (hasChild)
+						{
+							pQueue->Enqueue([pRunCounts, index]() { pRunCounts[index + 1].fetch_add(1); });
+						}
+						pRunCounts[index].fetch_add(1);
+					});
+				}
+			});
+		}
+
+		for (auto& producer : producers)
+		{
+			producer.join();
+		}
+		queue.WaitAll();
+	}
+
+	auto errorCount = 0LL;
+	for (auto i = 0LL; i < taskCount; ++i)
+	{
+		if (runCounts[i].load() != 1)
+		{
+			++errorCount;
+		}
+	}
+	return errorCount;
+}
+
+// a LockFree queue whose background budget is used up gets more background tasks than its ring holds from this
+// (non-worker) thread; Enqueue() must return rather than wait for workers the budget holds back
+// returns the tasks that didn't run exactly once after the budget is lifted
+inline long long StressLockFreeBackgroundBacklog(int threadCount, int taskCount)
+{
+	std::unique_ptr<std::atomic<int>[]> runCounts(new std::atomic<int>[taskCount]);
+	for (auto i = 0; i < taskCount; ++i)
+	{
+		runCounts[i].store(0, std::memory_order_relaxed);
+	}
+	auto pRunCounts = runCounts.get();
+
+	{
+		TaskQueue queue;
+		queue.Setup(threadCount, TaskQueue::Mode::LockFree);
+
+		// one task longer than the budget leaves it exhausted until the next BeginFrame()
+		queue.SetBackgroundBudget(0.001);
+		TaskGroup group;
+		queue.Enqueue([]() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }, &group, TaskPriority::Background);
+		group.Wait();
+
+		for (auto i = 0; i < taskCount; ++i)
+		{
+			queue.Enqueue([pRunCounts, i]() { pRunCounts[i].fetch_add(1); }, nullptr, TaskPriority::Background);
+		}
+
+		queue.SetBackgroundBudget(0.0);
+		queue.WaitAll();
+	}
+
+	auto errorCount = 0LL;
+	for (auto i = 0; i < taskCount; ++i)
+	{
+		if (runCounts[i].load() != 1)
+		{
+			++errorCount;
+		}
+	}
+	return errorCount;
+}
+
+// heap allocations per task over taskCount tasks, submitted in bursts of burstSize that are waited on
+// like a frame's tasks; half of each burst spawns a child from the worker it runs on
+// one burst runs first so the rings have grown to their steady-state size, after that every mode should
+// report 0 as long as a burst fits the task pool (tasks beyond it come from the heap)
+inline double MeasureTaskAllocations(TaskQueue* pQueue, int taskCount, int burstSize)
+{
+	auto& tracker = AllocTracker::Instance();
+	const auto wasEnabled = tracker.IsEnabled();
+
+	const auto burst = [pQueue, burstSize]()
+	{
+		TaskGroup group;
+		auto pGroup = &group;
+		for (auto i = 0; i < burstSize / 2; ++i)
+		{
+			pQueue->Enqueue([pQueue, pGroup]()
+			{
+				pQueue->Enqueue([]() {}, pGroup);
+			}, pGroup);
+		}
+		group.Wait();
+	};
+
+	burst();
+
+	tracker.SetEnabled(true);
+	tracker.Skip();
+	for (auto i = 0; i < taskCount / burstSize; ++i)
+	{
+		burst();
+	}
+	const auto count = tracker.EndFrame();
+	tracker.SetEnabled(wasEnabled);
+
+	return static_cast<double>(count) / taskCount;
+}
@@ -2,12 +2,15 @@
 #include "common.h"
 #include "Device.h"
 #include "Resource.h"
+#include "CommandQueue.h"
+#include "GpuFence.h"
 #include <DirectXTex.h>
 
 #pragma comment(lib, "DirectXTex.lib")
 
 Texture::~Texture()
 {
+	SafeDelete(&pIntermediate_);
 	SafeDelete(&pResource_);
 	SafeDelete(&pData_);
 }
@@ -53,6 +56,22 @@ HRESULT Texture::UpdateSubresource(CommandList* pCommandList, CommandQueue* pCom
 {
 	HRESULT result;
 
+	result = SubmitSubresource(pCommandList, pCommandQueue, nullptr);
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	result = pCommandQueue->FencePtr()->WaitForCompletion();
+	ReleaseIntermediate();
+
+	return result;
+}
+
+HRESULT Texture::SubmitSubresource(CommandList* pCommandList, CommandQueue* pCommandQueue, UINT64* pFenceValue)
+{
+	HRESULT result;
+
 	DirectX::ScratchImage image;
 	result = DirectX::LoadFromDDSFile(filepath_.c_str(), DirectX::DDS_FLAGS_NONE, pData_, image);
 	if (FAILED(result))
@@ -69,9 +88,17 @@ HRESULT Texture::UpdateSubresource(CommandList* pCommandList, CommandQueue* pCom
 		data[i].SlicePitch = pSubImage.slicePitch;
 	}
 
-	result = pResource_->UpdateSubresources(data, pCommandList, pCommandQueue, 0, static_cast<int>(image.GetImageCount()));
+	// the pixels are copied into the intermediate before this returns, only the intermediate has to wait for the GPU
+	SafeDelete(&pIntermediate_);
+	pIntermediate_ = new Resource();
+	result = pResource_->SubmitSubresources(data, pCommandList, pCommandQueue, 0, static_cast<int>(image.GetImageCount()), pIntermediate_, pFenceValue);
 
 	SafeDeleteArray(&data);
 
 	return result;
 }
+
+void Texture::ReleaseIntermediate()
+{
+	SafeDelete(&pIntermediate_);
+}
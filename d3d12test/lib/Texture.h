@@ -23,9 +23,15 @@ public:
 	HRESULT UpdateResources(Device* pDevice);
 	HRESULT UpdateSubresource(CommandList* pCommandList, CommandQueue* pCommandQueue);
 
+	// reads the file and submits the copy without waiting for it; call ReleaseIntermediate()
+	// once the queue's fence has reached *pFenceValue
+	HRESULT SubmitSubresource(CommandList* pCommandList, CommandQueue* pCommandQueue, UINT64* pFenceValue);
+	void ReleaseIntermediate();
+
 private:
 	DirectX::TexMetadata* pData_ = nullptr;
 	std::wstring filepath_;
 	Resource* pResource_ = nullptr;
+	Resource* pIntermediate_ = nullptr;
 };
 
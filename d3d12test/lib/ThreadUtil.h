@@ -0,0 +1,75 @@
+#pragma once
+#include <thread>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// thin platform layer for worker threads; every function degrades to a no-op (returning false)
+// where the OS doesn't support it
+
+inline int HardwareThreadCount()
+{
+	const auto count = static_cast<int>(std::thread::hardware_concurrency());
+	return (count > 0) ? count : 1;
+}
+
+// pause hint for spin-wait loops
+inline void CpuRelax()
+{
+#if defined(_WIN32)
+	YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#endif
+}
+
+inline bool SetCurrentThreadAffinity(int core)
+{
+	if (core < 0 || core >= HardwareThreadCount())
+	{
+		return false;
+	}
+
+#if defined(_WIN32)
+	// only the calling thread's processor group (first 64 logical cores) is addressable here
+	if (core >= 64)
+	{
+		return false;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), 1ULL << core) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+inline bool SetCurrentThreadName(const std::string& name)
+{
+#if defined(_WIN32)
+	// SetThreadDescription exists from Windows 10 1607; look it up so older systems still run
+	typedef HRESULT(WINAPI *SetThreadDescriptionFunc)(HANDLE, PCWSTR);
+	static const auto pSetThreadDescription = reinterpret_cast<SetThreadDescriptionFunc>(
+		GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription"));
+	if (pSetThreadDescription == nullptr)
+	{
+		return false;
+	}
+
+	const std::wstring wideName(name.begin(), name.end());
+	return SUCCEEDED(pSetThreadDescription(GetCurrentThread(), wideName.c_str()));
+#elif defined(__linux__)
+	// the kernel keeps at most 15 characters
+	return pthread_setname_np(pthread_self(), name.substr(0, 15).c_str()) == 0;
+#else
+	return false;
+#endif
+}
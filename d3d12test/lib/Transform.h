@@ -1,101 +1,81 @@
 #pragma once
-#include <DirectXMath.h>
-#include <utility>
-#include <cstring>
+#include "MatrixMath.h"
+#include "TransformStore.h"
 
+// handle to a slot of a TransformStore (TransformStore::Instance() unless another store is given)
+// copies get a slot of their own with the same values, so it still behaves like a value
 class Transform
 {
 public:
-	Transform()
-		: matrix_(DirectX::XMMatrixIdentity())
+	explicit Transform(TransformStore* pStore = &TransformStore::Instance())
+		: pStore_(pStore), handle_(pStore->Add())
 	{ }
 
-	DirectX::XMMATRIX& Matrix() { return matrix_; }
-	const DirectX::XMMATRIX& Matrix() const { return matrix_; }
-
-	void SetScaling(float x, float y, float z)
+	Transform(const Transform& other)
+		: Transform(other.pStore_)
 	{
-		scale_[0] = x;
-		scale_[1] = y;
-		scale_[2] = z;
+		CopyFrom_(other);
 	}
 
-	void SetRotation(float x, float y, float z)
+	Transform& operator=(const Transform& other)
 	{
-		rotation_[0] = x;
-		rotation_[1] = y;
-		rotation_[2] = z;
+		if (this != &other)
+		{
+			CopyFrom_(other);
+		}
+		return *this;
 	}
 
-	void SetTranslation(float x, float y, float z)
+	~Transform()
 	{
-		translation_[0] = x;
-		translation_[1] = y;
-		translation_[2] = z;
+		pStore_->Remove(handle_);
 	}
 
-	void UpdateMatrix()
-	{
-		const auto& s = scale_;
-		const auto& r = rotation_;
-		const auto& t = translation_;
-
-		const auto
-			sx = (float)sin(r[0]), cx = (float)cos(r[0]),
-			sy = (float)sin(r[1]), cy = (float)cos(r[1]),
-			sz = (float)sin(r[2]), cz = (float)cos(r[2]);
+	TransformStore* StorePtr() const { return pStore_; }
+	TransformStore::Handle Handle() const { return handle_; }
 
-		// XYZ
-		const auto
-			r11 = cy * cz,
-			r12 = cy * sz,
-			r13 = -sy,
-			r21 = sx * sy * cz - cx * sz,
-			r22 = sx * sy * sz + cx * cz,
-			r23 = sx * cy,
-			r31 = cx * sy * cz + sx * sz,
-			r32 = cx * sy * sz - sx * cz,
-			r33 = cx * cy;
+	// as of the last UpdateMatrix(), or the store's update over this handle; 16 floats laid out like XMMATRIX
+	const float* Matrix() const { return pStore_->Matrix(handle_); }
 
-		auto& m = matrix_;
+	TransformStore::Vector3 Scaling() const { return pStore_->Scaling(handle_); }
+	TransformStore::Vector3 Rotation() const { return pStore_->Rotation(handle_); }
+	TransformStore::Vector3 Translation() const { return pStore_->Translation(handle_); }
+	Quaternion RotationQuaternion() const { return pStore_->RotationQuaternion(handle_); }
 
-		m.r[0].m128_f32[0] = s[0] * r11;
-		m.r[0].m128_f32[1] = s[0] * r12;
-		m.r[0].m128_f32[2] = s[0] * r13;
-		m.r[0].m128_f32[3] = 0.0f;
+	void SetScaling(float x, float y, float z) { pStore_->SetScaling(handle_, x, y, z); }
+	void SetRotation(float x, float y, float z) { pStore_->SetRotation(handle_, x, y, z); }
+	void SetTranslation(float x, float y, float z) { pStore_->SetTranslation(handle_, x, y, z); }
+	void SetRotation(const Quaternion& rotation) { pStore_->SetRotation(handle_, rotation); }
 
-		m.r[1].m128_f32[0] = s[1] * r21;
-		m.r[1].m128_f32[1] = s[1] * r22;
-		m.r[1].m128_f32[2] = s[1] * r23;
-		m.r[1].m128_f32[3] = 0.0f;
-
-		m.r[2].m128_f32[0] = s[2] * r31;
-		m.r[2].m128_f32[1] = s[2] * r32;
-		m.r[2].m128_f32[2] = s[2] * r33;
-		m.r[2].m128_f32[3] = 0.0f;
-
-		m.r[3].m128_f32[0] = t[0];
-		m.r[3].m128_f32[1] = t[1];
-		m.r[3].m128_f32[2] = t[2];
-		m.r[3].m128_f32[3] = 1.0f;
+	// this transform alone; per-frame updates should go through TransformStore::UpdateDirtyMatrices()
+	void UpdateMatrix()
+	{
+		pStore_->UpdateMatrices(handle_, handle_ + 1);
 	}
 
 	Transform Clone()
 	{
-		Transform other;
-
-		other.matrix_ = matrix_;
-		memcpy(other.scale_, scale_, sizeof(scale_));
-		memcpy(other.rotation_, rotation_, sizeof(rotation_));
-		memcpy(other.translation_, translation_, sizeof(translation_));
-
-		return std::move(other);
+		return *this;
 	}
 
 private:
-	DirectX::XMMATRIX matrix_;
-	float scale_[3] = { 1.0f, 1.0f, 1.0f };
-	float rotation_[3] = { 0.0f, 0.0f, 0.0f };
-	float translation_[3] = { 0.0f, 0.0f, 0.0f };
+	TransformStore* pStore_;
+	TransformStore::Handle handle_;
+
+	void CopyFrom_(const Transform& other)
+	{
+		const auto s = other.Scaling();
+		const auto t = other.Translation();
+		SetScaling(s.X, s.Y, s.Z);
+		SetRotation(other.RotationQuaternion());
+		SetTranslation(t.X, t.Y, t.Z);
+		UpdateMatrix();
+	}
 };
 
+// a mesh's world matrix: its animation key, global in the FBX scene, placed under the model's world matrix
+// (Model::SetTransform(), FrameBench)
+inline void MeshWorldMatrix(const float* pAnimation, const float* pModelWorld, float* pWorld)
+{
+	MatrixMultiply(pAnimation, pModelWorld, pWorld);
+}
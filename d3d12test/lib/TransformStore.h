@@ -0,0 +1,560 @@
+#pragma once
+#include "AlignedAllocator.h"
+#include "Quaternion.h"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(SIN_COS_SSE)
+#define TRANSFORM_STORE_SSE
+#endif
+#if defined(__AVX__)
+#define TRANSFORM_STORE_AVX
+#include <immintrin.h>
+#endif
+
+// structure-of-arrays storage for Transform
+// scaling, rotation (a quaternion), translation and Euler angles are kept as contiguous float streams so that
+// UpdateMatrices() can compose world matrices 8 (AVX) or 4 (SSE) at a time; the matrices themselves
+// are 16-byte aligned (AlignedAllocator), row-major like XMMATRIX, so consumers can load them directly
+// Euler angles are kept as set and turned into the quaternion by the update that composes them, 4 at a time
+// with the SSE SinCos(); every path does QuaternionFromEuler()'s and ComposeMatrix()'s operations, so a matrix
+// doesn't depend on which path composed it
+// setters that change a value put the handle on a dirty list, and UpdateDirtyMatrices() composes only those;
+// a static scene costs nothing per frame
+// Add()/Remove(), setters and ClearDirty() are for the thread that owns the store, and never while an update runs
+// on it: Add() can grow the streams and move every matrix, so Matrix() pointers are only good until the next Add()
+class TransformStore
+{
+public:
+	typedef int Handle;
+
+	struct Vector3
+	{
+		float X, Y, Z;
+	};
+
+	// the store Transform uses by default
+	static TransformStore& Instance()
+	{
+		static TransformStore store;
+		return store;
+	}
+
+	TransformStore() {}
+
+	TransformStore(const TransformStore&) = delete;
+	TransformStore& operator=(const TransformStore&) = delete;
+
+	void Reserve(int capacity)
+	{
+		for (auto& stream : streams_)
+		{
+			stream.reserve(capacity);
+		}
+		matrices_.reserve(capacity);
+		isDirty_.reserve(capacity);
+		eulerStates_.reserve(capacity);
+		dirtyHandles_.reserve(capacity);
+	}
+
+	// identity; handles of removed transforms are reused
+	Handle Add()
+	{
+		Handle handle;
+		if (!freeHandles_.empty())
+		{
+			handle = freeHandles_.back();
+			freeHandles_.pop_back();
+		}
+		else
+		{
+			handle = Capacity();
+			for (auto& stream : streams_)
+			{
+				stream.push_back(0.0f);
+			}
+			matrices_.push_back(Matrix_());
+			isDirty_.push_back(0);
+			eulerStates_.push_back(EulerConverted_);
+		}
+
+		// composed right away, so a new transform isn't dirty
+		const float one[] = { 1.0f, 1.0f, 1.0f };
+		const float zero[] = { 0.0f, 0.0f, 0.0f };
+		Write_<3>(ScalingX_, handle, one);
+		Write_<4>(RotationX_, handle, &cQuaternionIdentity.X);
+		Write_<3>(EulerX_, handle, zero);
+		Write_<3>(TranslationX_, handle, zero);
+		eulerStates_[handle] = EulerConverted_;
+		ComposeScalar_(handle);
+		return handle;
+	}
+
+	void Remove(Handle handle)
+	{
+		freeHandles_.push_back(handle);
+	}
+
+	// number of slots, removed ones included; the range UpdateMatrices() works on
+	int Capacity() { return static_cast<int>(matrices_.size()); }
+	int Count() { return Capacity() - static_cast<int>(freeHandles_.size()); }
+
+	void SetScaling(Handle handle, float x, float y, float z) { Set3_(ScalingX_, handle, x, y, z); }
+	void SetTranslation(Handle handle, float x, float y, float z) { Set3_(TranslationX_, handle, x, y, z); }
+
+	// Euler angles, about X, then Y, then Z; converted by the next update covering handle
+	void SetRotation(Handle handle, float x, float y, float z)
+	{
+		const float values[] = { x, y, z };
+		if (Set_<3>(EulerX_, handle, values))
+		{
+			eulerStates_[handle] = EulerPending_;
+			hasPendingEuler_ = true;
+		}
+	}
+
+	// a unit quaternion; replaces Euler angles not converted yet, and the next Euler angles always count as a change
+	void SetRotation(Handle handle, const Quaternion& rotation)
+	{
+		if (eulerStates_[handle] != EulerReplaced_)
+		{
+			const auto nan = std::numeric_limits<float>::quiet_NaN();
+			const float values[] = { nan, nan, nan };
+			Write_<3>(EulerX_, handle, values);
+			eulerStates_[handle] = EulerReplaced_;
+		}
+		Set_<4>(RotationX_, handle, &rotation.X);
+	}
+
+	Vector3 Scaling(Handle handle) { return Get_(ScalingX_, handle); }
+	Vector3 Translation(Handle handle) { return Get_(TranslationX_, handle); }
+
+	// Euler angles of the stored quaternion, which needn't be the ones that were set (see QuaternionToEuler())
+	Vector3 Rotation(Handle handle)
+	{
+		Vector3 v;
+		QuaternionToEuler(RotationQuaternion(handle), &v.X, &v.Y, &v.Z);
+		return v;
+	}
+
+	Quaternion RotationQuaternion(Handle handle)
+	{
+		if (eulerStates_[handle] == EulerPending_)
+		{
+			return QuaternionFromEuler(streams_[EulerX_][handle], streams_[EulerY_][handle], streams_[EulerZ_][handle]);
+		}
+		return { streams_[RotationX_][handle], streams_[RotationY_][handle], streams_[RotationZ_][handle], streams_[RotationW_][handle] };
+	}
+
+	// 16 floats, row-major, as of the last update covering handle
+	const float* Matrix(Handle handle) { return matrices_[handle].M; }
+
+	// handles whose values changed since the last ClearDirty(), each once, in the order they were first set
+	int DirtyCount() { return static_cast<int>(dirtyHandles_.size()); }
+	const Handle* DirtyHandles() { return dirtyHandles_.data(); }
+
+	// composes the matrices of dirty list entries [begin, end); slices that don't overlap can be updated in parallel
+	void UpdateDirtyMatrices(int begin, int end)
+	{
+		Compose_(dirtyHandles_.data() + begin, end - begin);
+	}
+
+	// once every slice of the dirty list has been updated
+	void ClearDirty()
+	{
+		auto hasPendingEuler = false;
+		for (const auto handle : dirtyHandles_)
+		{
+			isDirty_[handle] = 0;
+			hasPendingEuler = hasPendingEuler || eulerStates_[handle] == EulerPending_;
+		}
+		dirtyHandles_.clear();
+		hasPendingEuler_ = hasPendingEuler;
+	}
+
+	void UpdateDirtyMatrices()
+	{
+		UpdateDirtyMatrices(0, DirtyCount());
+		ClearDirty();
+	}
+
+	// composes the matrices of handles [begin, end), dirty or not; ranges that don't overlap can be updated in parallel
+	void UpdateMatrices(int begin, int end)
+	{
+		for (auto i = begin; i < end; i += cBatchSize)
+		{
+			Handle handles[cBatchSize];
+			const auto count = (end - i < cBatchSize) ? end - i : cBatchSize;
+			for (auto j = 0; j < count; ++j)
+			{
+				handles[j] = i + j;
+			}
+			Compose_(handles, count);
+		}
+	}
+
+	void UpdateMatrices()
+	{
+		UpdateMatrices(0, Capacity());
+		ClearDirty();
+	}
+
+	// one transform at a time, for comparison
+	void UpdateMatricesScalar(int begin, int end)
+	{
+		for (auto i = begin; i < end; ++i)
+		{
+			if (eulerStates_[i] == EulerPending_)
+			{
+				ConvertEulerScalar_(i);
+			}
+			ComposeScalar_(i);
+		}
+	}
+
+private:
+	enum Stream_
+	{
+		ScalingX_, ScalingY_, ScalingZ_,
+		RotationX_, RotationY_, RotationZ_, RotationW_,
+		TranslationX_, TranslationY_, TranslationZ_,
+		EulerX_, EulerY_, EulerZ_,	// as last set; NaN once a quaternion was set
+		StreamCount_,
+	};
+
+	// what the Euler streams of a handle hold
+	enum EulerState_ : uint8_t
+	{
+		EulerConverted_,	// the angles the quaternion was made from
+		EulerPending_,		// angles not converted yet
+		EulerReplaced_,		// NaN, a quaternion was set since
+	};
+
+	// for _mm_store_ps(); std::vector's default allocator wouldn't keep it on Win32 x86
+	struct alignas(16) Matrix_
+	{
+		float M[16];
+	};
+
+	static const int cBatchSize = 64;
+
+	std::vector<float> streams_[StreamCount_];
+	std::vector<Matrix_, AlignedAllocator<Matrix_>> matrices_;
+	std::vector<Handle> freeHandles_;
+	std::vector<uint8_t> isDirty_;
+	std::vector<uint8_t> eulerStates_;
+	bool hasPendingEuler_ = false;	// without any, updates skip the conversion
+	std::vector<Handle> dirtyHandles_;
+
+	template<int N>
+	void Write_(int first, Handle handle, const float* pValues)
+	{
+		for (auto i = 0; i < N; ++i)
+		{
+			streams_[first + i][handle] = pValues[i];
+		}
+	}
+
+	void Set3_(int first, Handle handle, float x, float y, float z)
+	{
+		const float values[] = { x, y, z };
+		Set_<3>(first, handle, values);
+	}
+
+	// setting the value a transform already has doesn't dirty it, so replaying a static scene stays free
+	// returns whether the value changed
+	template<int N>
+	bool Set_(int first, Handle handle, const float* pValues)
+	{
+		auto isChanged = false;
+		for (auto i = 0; i < N; ++i)
+		{
+			isChanged = isChanged || streams_[first + i][handle] != pValues[i];
+		}
+		if (!isChanged)
+		{
+			return false;
+		}
+		Write_<N>(first, handle, pValues);
+
+		if (!isDirty_[handle])
+		{
+			isDirty_[handle] = 1;
+			dirtyHandles_.push_back(handle);
+		}
+		return true;
+	}
+
+	// pending Euler angles are converted right before their matrices are composed, while the quaternions are in cache
+	void Compose_(const Handle* pHandles, int count)
+	{
+		auto i = 0;
+#if defined(TRANSFORM_STORE_AVX)
+		for (; i + 8 <= count; i += 8)
+		{
+			if (hasPendingEuler_)
+			{
+				ConvertEuler_(pHandles + i, 8);
+			}
+			ComposeAvx_(pHandles + i);
+		}
+#endif
+#if defined(TRANSFORM_STORE_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			if (hasPendingEuler_)
+			{
+				ConvertEuler_(pHandles + i, 4);
+			}
+			ComposeSse_(pHandles + i);
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			if (eulerStates_[pHandles[i]] == EulerPending_)
+			{
+				ConvertEulerScalar_(pHandles[i]);
+			}
+			ComposeScalar_(pHandles[i]);
+		}
+	}
+
+	template<int N>
+	static bool IsContiguous_(const Handle* pHandles)
+	{
+		for (auto i = 1; i < N; ++i)
+		{
+			if (pHandles[i] != pHandles[0] + i)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void ConvertEulerScalar_(Handle handle)
+	{
+		eulerStates_[handle] = EulerConverted_;
+		const auto rotation = QuaternionFromEuler(streams_[EulerX_][handle], streams_[EulerY_][handle], streams_[EulerZ_][handle]);
+		Write_<4>(RotationX_, handle, &rotation.X);
+	}
+
+	Vector3 Get_(int first, Handle handle)
+	{
+		return { streams_[first][handle], streams_[first + 1][handle], streams_[first + 2][handle] };
+	}
+
+	void ComposeScalar_(int i)
+	{
+		const float scaling[] = { streams_[ScalingX_][i], streams_[ScalingY_][i], streams_[ScalingZ_][i] };
+		const float translation[] = { streams_[TranslationX_][i], streams_[TranslationY_][i], streams_[TranslationZ_][i] };
+		ComposeMatrix(scaling, RotationQuaternion(i), translation, matrices_[i].M);
+	}
+
+#if defined(TRANSFORM_STORE_SSE)
+	// one value of four handles; a single load when they are neighbours, as in a full update
+	__m128 LoadSse_(int stream, const Handle* pHandles, bool isContiguous)
+	{
+		return LoadSse_(streams_[stream].data(), pHandles, isContiguous);
+	}
+
+	static __m128 LoadSse_(const float* pStream, const Handle* pHandles, bool isContiguous)
+	{
+		if (isContiguous)
+		{
+			return _mm_loadu_ps(pStream + pHandles[0]);
+		}
+		return _mm_setr_ps(pStream[pHandles[0]], pStream[pHandles[1]], pStream[pHandles[2]], pStream[pHandles[3]]);
+	}
+
+	// the pending Euler angles among the handles into their quaternions, 4 at a time
+	void ConvertEuler_(const Handle* pHandles, int count)
+	{
+		Handle pending[4];
+		auto pendingCount = 0;
+		for (auto i = 0; i < count; ++i)
+		{
+			const auto handle = pHandles[i];
+			if (eulerStates_[handle] != EulerPending_)
+			{
+				continue;
+			}
+			eulerStates_[handle] = EulerConverted_;
+
+			pending[pendingCount++] = handle;
+			if (pendingCount == 4)
+			{
+				ConvertEulerSse_(pending);
+				pendingCount = 0;
+			}
+		}
+
+		for (auto i = 0; i < pendingCount; ++i)
+		{
+			ConvertEulerScalar_(pending[i]);
+		}
+	}
+
+	void ConvertEulerSse_(const Handle* pHandles)
+	{
+		const auto isContiguous = IsContiguous_<4>(pHandles);
+
+		__m128 rotation[4];
+		QuaternionFromEuler(
+			LoadSse_(streams_[EulerX_].data(), pHandles, isContiguous),
+			LoadSse_(streams_[EulerY_].data(), pHandles, isContiguous),
+			LoadSse_(streams_[EulerZ_].data(), pHandles, isContiguous),
+			&rotation[0], &rotation[1], &rotation[2], &rotation[3]);
+
+		for (auto i = 0; i < 4; ++i)
+		{
+			const auto pStream = streams_[RotationX_ + i].data();
+			if (isContiguous)
+			{
+				_mm_storeu_ps(pStream + pHandles[0], rotation[i]);
+				continue;
+			}
+
+			alignas(16) float values[4];
+			_mm_store_ps(values, rotation[i]);
+			for (auto j = 0; j < 4; ++j)
+			{
+				pStream[pHandles[j]] = values[j];
+			}
+		}
+	}
+
+	// lanes hold the same element of four matrices; transposing four such vectors gives one row of each
+	void StoreRowsSse_(const Handle* pHandles, int row, __m128 x, __m128 y, __m128 z, __m128 w)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_store_ps(matrices_[pHandles[0]].M + row * 4, x);
+		_mm_store_ps(matrices_[pHandles[1]].M + row * 4, y);
+		_mm_store_ps(matrices_[pHandles[2]].M + row * 4, z);
+		_mm_store_ps(matrices_[pHandles[3]].M + row * 4, w);
+	}
+
+	void ComposeSse_(const Handle* pHandles)
+	{
+		const auto isContiguous = IsContiguous_<4>(pHandles);
+
+		const auto x = LoadSse_(RotationX_, pHandles, isContiguous);
+		const auto y = LoadSse_(RotationY_, pHandles, isContiguous);
+		const auto z = LoadSse_(RotationZ_, pHandles, isContiguous);
+		const auto w = LoadSse_(RotationW_, pHandles, isContiguous);
+
+		const auto x2 = _mm_add_ps(x, x);
+		const auto y2 = _mm_add_ps(y, y);
+		const auto z2 = _mm_add_ps(z, z);
+		const auto xx = _mm_mul_ps(x, x2);
+		const auto yy = _mm_mul_ps(y, y2);
+		const auto zz = _mm_mul_ps(z, z2);
+		const auto xy = _mm_mul_ps(x, y2);
+		const auto xz = _mm_mul_ps(x, z2);
+		const auto yz = _mm_mul_ps(y, z2);
+		const auto wx = _mm_mul_ps(w, x2);
+		const auto wy = _mm_mul_ps(w, y2);
+		const auto wz = _mm_mul_ps(w, z2);
+
+		const auto scaleX = LoadSse_(ScalingX_, pHandles, isContiguous);
+		const auto scaleY = LoadSse_(ScalingY_, pHandles, isContiguous);
+		const auto scaleZ = LoadSse_(ScalingZ_, pHandles, isContiguous);
+
+		const auto zero = _mm_setzero_ps();
+		const auto one = _mm_set1_ps(1.0f);
+
+		StoreRowsSse_(pHandles, 0,
+			_mm_mul_ps(scaleX, _mm_sub_ps(one, _mm_add_ps(yy, zz))),
+			_mm_mul_ps(scaleX, _mm_add_ps(xy, wz)),
+			_mm_mul_ps(scaleX, _mm_sub_ps(xz, wy)),
+			zero);
+		StoreRowsSse_(pHandles, 1,
+			_mm_mul_ps(scaleY, _mm_sub_ps(xy, wz)),
+			_mm_mul_ps(scaleY, _mm_sub_ps(one, _mm_add_ps(xx, zz))),
+			_mm_mul_ps(scaleY, _mm_add_ps(yz, wx)),
+			zero);
+		StoreRowsSse_(pHandles, 2,
+			_mm_mul_ps(scaleZ, _mm_add_ps(xz, wy)),
+			_mm_mul_ps(scaleZ, _mm_sub_ps(yz, wx)),
+			_mm_mul_ps(scaleZ, _mm_sub_ps(one, _mm_add_ps(xx, yy))),
+			zero);
+		StoreRowsSse_(pHandles, 3,
+			LoadSse_(TranslationX_, pHandles, isContiguous),
+			LoadSse_(TranslationY_, pHandles, isContiguous),
+			LoadSse_(TranslationZ_, pHandles, isContiguous),
+			one);
+	}
+#endif
+
+#if defined(TRANSFORM_STORE_AVX)
+	__m256 LoadAvx_(int stream, const Handle* pHandles, bool isContiguous)
+	{
+		const auto pStream = streams_[stream].data();
+		if (isContiguous)
+		{
+			return _mm256_loadu_ps(pStream + pHandles[0]);
+		}
+		return _mm256_setr_ps(
+			pStream[pHandles[0]], pStream[pHandles[1]], pStream[pHandles[2]], pStream[pHandles[3]],
+			pStream[pHandles[4]], pStream[pHandles[5]], pStream[pHandles[6]], pStream[pHandles[7]]);
+	}
+
+	void StoreRowsAvx_(const Handle* pHandles, int row, __m256 x, __m256 y, __m256 z, __m256 w)
+	{
+		StoreRowsSse_(pHandles, row, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), _mm256_castps256_ps128(w));
+		StoreRowsSse_(pHandles + 4, row, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1));
+	}
+
+	void ComposeAvx_(const Handle* pHandles)
+	{
+		const auto isContiguous = IsContiguous_<8>(pHandles);
+
+		const auto x = LoadAvx_(RotationX_, pHandles, isContiguous);
+		const auto y = LoadAvx_(RotationY_, pHandles, isContiguous);
+		const auto z = LoadAvx_(RotationZ_, pHandles, isContiguous);
+		const auto w = LoadAvx_(RotationW_, pHandles, isContiguous);
+
+		const auto x2 = _mm256_add_ps(x, x);
+		const auto y2 = _mm256_add_ps(y, y);
+		const auto z2 = _mm256_add_ps(z, z);
+		const auto xx = _mm256_mul_ps(x, x2);
+		const auto yy = _mm256_mul_ps(y, y2);
+		const auto zz = _mm256_mul_ps(z, z2);
+		const auto xy = _mm256_mul_ps(x, y2);
+		const auto xz = _mm256_mul_ps(x, z2);
+		const auto yz = _mm256_mul_ps(y, z2);
+		const auto wx = _mm256_mul_ps(w, x2);
+		const auto wy = _mm256_mul_ps(w, y2);
+		const auto wz = _mm256_mul_ps(w, z2);
+
+		const auto scaleX = LoadAvx_(ScalingX_, pHandles, isContiguous);
+		const auto scaleY = LoadAvx_(ScalingY_, pHandles, isContiguous);
+		const auto scaleZ = LoadAvx_(ScalingZ_, pHandles, isContiguous);
+
+		const auto zero = _mm256_setzero_ps();
+		const auto one = _mm256_set1_ps(1.0f);
+
+		StoreRowsAvx_(pHandles, 0,
+			_mm256_mul_ps(scaleX, _mm256_sub_ps(one, _mm256_add_ps(yy, zz))),
+			_mm256_mul_ps(scaleX, _mm256_add_ps(xy, wz)),
+			_mm256_mul_ps(scaleX, _mm256_sub_ps(xz, wy)),
+			zero);
+		StoreRowsAvx_(pHandles, 1,
+			_mm256_mul_ps(scaleY, _mm256_sub_ps(xy, wz)),
+			_mm256_mul_ps(scaleY, _mm256_sub_ps(one, _mm256_add_ps(xx, zz))),
+			_mm256_mul_ps(scaleY, _mm256_add_ps(yz, wx)),
+			zero);
+		StoreRowsAvx_(pHandles, 2,
+			_mm256_mul_ps(scaleZ, _mm256_add_ps(xz, wy)),
+			_mm256_mul_ps(scaleZ, _mm256_sub_ps(yz, wx)),
+			_mm256_mul_ps(scaleZ, _mm256_sub_ps(one, _mm256_add_ps(xx, yy))),
+			zero);
+		StoreRowsAvx_(pHandles, 3,
+			LoadAvx_(TranslationX_, pHandles, isContiguous),
+			LoadAvx_(TranslationY_, pHandles, isContiguous),
+			LoadAvx_(TranslationZ_, pHandles, isContiguous),
+			one);
+	}
+#endif
+};
@@ -3,6 +3,9 @@
 #include "Device.h"
 #include "CommandList.h"
 #include "Resource.h"
+#include "AllocTracker.h"
+#include "Metrics.h"
+#include "CopyRows.h"
 #include <Windows.h>
 
 UINT64 GetSubresourcesFootprint_(ID3D12Device* pDevice, int start, int count, const D3D12_RESOURCE_DESC& desc);
@@ -106,6 +109,8 @@ HRESULT UpdateSubresourcesImpl_(
 	ID3D12Resource* pIntermediate,
 	UINT64 offset, UINT start, UINT count)
 {
+	ALLOC_SCOPE("upload");
+
 	HRESULT result;
 
 	const auto singleBufferSize = static_cast<UINT64>(sizeof(D3D12_PLACED_SUBRESOURCE_FOOTPRINT) + sizeof(UINT) + sizeof(UINT64));
@@ -121,6 +126,7 @@ HRESULT UpdateSubresourcesImpl_(
 	{
 		return S_FALSE;
 	}
+	AllocTracker::Instance().RecordAllocation(static_cast<size_t>(bufferSize));
 
 	auto pLayouts = reinterpret_cast<D3D12_PLACED_SUBRESOURCE_FOOTPRINT*>(buffer);
 	auto pRowSizesInBytes = reinterpret_cast<UINT64*>(pLayouts + count);
@@ -134,6 +140,11 @@ HRESULT UpdateSubresourcesImpl_(
 		pLayouts, pRowCounts, pRowSizesInBytes,
 		&requiredSize);
 
+	static auto pUploadBytes = MetricsRegistry::Instance().Counter("upload.bytes");
+	static auto pUploadCount = MetricsRegistry::Instance().Counter("upload.count");
+	pUploadBytes->Add(static_cast<long long>(requiredSize));
+	pUploadCount->Add();
+
 	result = UpdateSubresourcesImpl_(
 		pData,
 		pCommandList,
@@ -143,6 +154,7 @@ HRESULT UpdateSubresourcesImpl_(
 		pLayouts, pRowCounts, pRowSizesInBytes);
 
 	HeapFree(GetProcessHeap(), 0, buffer);
+	AllocTracker::Instance().RecordFree();
 
 	return result;
 }
@@ -203,17 +215,8 @@ HRESULT UpdateSubresourcesImpl_(
 
 void CopySubresource_(const D3D12_MEMCPY_DEST* pDest, const D3D12_SUBRESOURCE_DATA* pSource, UINT64 rowSizeInBytes, UINT rowCount, UINT sliceCount)
 {
-	for (UINT i = 0; i < sliceCount; ++i)
-	{
-		auto pDestSlice = reinterpret_cast<byte*>(pDest->pData) + pDest->SlicePitch * i;
-		const auto pSrcSlice = reinterpret_cast<const byte*>(pSource->pData) + pSource->SlicePitch * i;
-
-		for (UINT j = 0; j < rowCount; ++j)
-		{
-			memcpy(
-				pDestSlice + pDest->RowPitch * j,
-				pSrcSlice + pSource->RowPitch * j,
-				rowSizeInBytes);
-		}
-	}
+	CopyRows(
+		pDest->pData, pDest->RowPitch, pDest->SlicePitch,
+		pSource->pData, pSource->RowPitch, pSource->SlicePitch,
+		static_cast<size_t>(rowSizeInBytes), rowCount, sliceCount);
 }
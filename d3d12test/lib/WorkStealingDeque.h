@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+// Chase-Lev deque
+// Push/Pop are owner-thread only (LIFO), Steal may be called from any thread (FIFO)
+template<class T>
+class WorkStealingDeque
+{
+public:
+	// capacity must be a power of two
+	explicit WorkStealingDeque(int capacity)
+		: buffer_(capacity), mask_(capacity - 1)
+	{
+		for (auto& item : buffer_)
+		{
+			item.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	int Capacity() { return static_cast<int>(mask_ + 1); }
+
+	int Size()
+	{
+		const auto b = bottom_.load(std::memory_order_relaxed);
+		const auto t = top_.load(std::memory_order_relaxed);
+		return (b > t) ? static_cast<int>(b - t) : 0;
+	}
+
+	bool Push(T* pItem)
+	{
+		const auto b = bottom_.load(std::memory_order_relaxed);
+		const auto t = top_.load(std::memory_order_acquire);
+		if (b - t > mask_)
+		{
+			return false;
+		}
+
+		buffer_[b & mask_].store(pItem, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom_.store(b + 1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	T* Pop()
+	{
+		const auto b = bottom_.load(std::memory_order_relaxed) - 1;
+		bottom_.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto t = top_.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			bottom_.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		auto pItem = buffer_[b & mask_].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			// last item: race against thieves
+			if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				pItem = nullptr;
+			}
+			bottom_.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return pItem;
+	}
+
+	T* Steal()
+	{
+		auto t = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const auto b = bottom_.load(std::memory_order_acquire);
+
+		if (t >= b)
+		{
+			return nullptr;
+		}
+
+		auto pItem = buffer_[t & mask_].load(std::memory_order_relaxed);
+		if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+
+		return pItem;
+	}
+
+private:
+	// owner/thieves touch different ends, keep them on separate cache lines
+	alignas(64) std::atomic<long long> top_{ 0 };
+	alignas(64) std::atomic<long long> bottom_{ 0 };
+
+	std::vector<std::atomic<T*>> buffer_;
+	long long mask_;
+};
@@ -1,14 +1,25 @@
 #pragma once
 #include "common.h"
 #include "fbxCommon.h"
+#include "Quaternion.h"
 #include <Windows.h>
 #include <DirectXMath.h>
+#include <cmath>
 
 namespace fbx
 {
+	// keys are kept as scaling, rotation quaternion and translation (40 bytes a key against a matrix's 64)
+	// and composed when they are used, so two keys can be blended without decomposing matrices
 	class AnimStack
 	{
 	public:
+		struct Key
+		{
+			float Scaling[3];
+			Quaternion Rotation;
+			float Translation[3];
+		};
+
 		static int Count(FbxImporter* pSceneImporter)
 		{
 			return pSceneImporter->GetAnimStackCount();
@@ -24,28 +35,69 @@ namespace fbx
 			return new AnimStack(pMesh, pTakeInfo, pScene->GetGlobalSettings().GetTimeMode());
 		}
 
+		// keys given directly instead of sampled from a take (benchmarks, procedural animation)
+		// the matrices have to decompose into scaling, rotation and translation
+		static AnimStack* Create(const DirectX::XMMATRIX* pMatrices, int count)
+		{
+			auto pStack = new AnimStack();
+			pStack->start_ = 0;
+			pStack->stop_ = count - 1;
+			pStack->keys_ = new Key[count];
+			for (auto i = 0; i < count; ++i)
+			{
+				SetKey_(pMatrices[i], &pStack->keys_[i]);
+			}
+			return pStack;
+		}
+
 	public:
 		~AnimStack()
 		{
-			SafeDeleteArray(&matrices_);
+			SafeDeleteArray(&keys_);
 		}
 
-		const DirectX::XMMATRIX& Matrix(int frame) { return matrices_[frame]; }
+		const Key& KeyAt(int frame) { return keys_[frame]; }
+		DirectX::XMMATRIX Matrix(int frame) { return Compose_(keys_[frame]); }
 		int FrameCount() { return stop_ - start_ + 1; }
 		int StartFrame() { return start_; }
 		int StopFrame() { return stop_; }
 
-		const DirectX::XMMATRIX& NextFrame()
+		// index of the key NextFrame() returns next
+		int CurrentFrame() { return current_; }
+		void SetCurrentFrame(int frame) { current_ = frame % FrameCount(); }
+
+		DirectX::XMMATRIX NextFrame()
 		{
-			const auto& m = matrices_[current_];
+			const auto& key = keys_[current_];
 			if (++current_ >= FrameCount())
 			{
 				current_ = 0;
 			}
-			return m;
+			return Compose_(key);
+		}
+
+		// between keys, frame in [0, FrameCount()), the last key blending back into the first
+		// scaling and translation are lerped and the rotation nlerped; no key matrix is touched
+		DirectX::XMMATRIX Sample(float frame)
+		{
+			const auto first = static_cast<int>(std::floor(frame));
+			const auto t = frame - first;
+			const auto& a = keys_[first % FrameCount()];
+			const auto& b = keys_[(first + 1) % FrameCount()];
+
+			Key key;
+			for (auto i = 0; i < 3; ++i)
+			{
+				key.Scaling[i] = a.Scaling[i] + (b.Scaling[i] - a.Scaling[i]) * t;
+				key.Translation[i] = a.Translation[i] + (b.Translation[i] - a.Translation[i]) * t;
+			}
+			key.Rotation = QuaternionNlerp(a.Rotation, b.Rotation, t);
+			return Compose_(key);
 		}
 
 	private:
+		AnimStack() { }
+
 		AnimStack(FbxMesh* pMesh, fbxsdk::FbxTakeInfo* pTakeInfo, fbxsdk::FbxTime::EMode mode)
 		{
 			fbxsdk::FbxTime period;
@@ -58,24 +110,42 @@ namespace fbx
 			stop_ = (int)(stop.Get() / period.Get());
 
 			const auto count = stop_ - start_ + 1;
-			matrices_ = new DirectX::XMMATRIX[count];
+			keys_ = new Key[count];
 
+			// global: the FBX ancestors, animated or not, are part of every key
 			const auto pNode = pMesh->GetNode();
 			for (auto i = start_; i <= stop_; ++i)
 			{
 				const auto& m = pNode->EvaluateGlobalTransform(period * i);
-				new (&matrices_[i]) DirectX::XMMATRIX(
+				const DirectX::XMMATRIX matrix(
 					(float)m.Get(0, 0), (float)m.Get(0, 1), (float)m.Get(0, 2), (float)m.Get(0, 3),
 					(float)m.Get(1, 0), (float)m.Get(1, 1), (float)m.Get(1, 2), (float)m.Get(1, 3),
 					(float)m.Get(2, 0), (float)m.Get(2, 1), (float)m.Get(2, 2), (float)m.Get(2, 3),
 					(float)m.Get(3, 0), (float)m.Get(3, 1), (float)m.Get(3, 2), (float)m.Get(3, 3));
+				SetKey_(matrix, &keys_[i - start_]);
 			}
 		}
 
+		static void SetKey_(DirectX::FXMMATRIX matrix, Key* pKey)
+		{
+			DirectX::XMVECTOR scaling, rotation, translation;
+			DirectX::XMMatrixDecompose(&scaling, &rotation, &translation, matrix);
+			DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(pKey->Scaling), scaling);
+			DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&pKey->Rotation), rotation);
+			DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(pKey->Translation), translation);
+		}
+
+		static DirectX::XMMATRIX Compose_(const Key& key)
+		{
+			DirectX::XMFLOAT4X4A m;
+			ComposeMatrix(key.Scaling, key.Rotation, key.Translation, &m.m[0][0]);
+			return DirectX::XMLoadFloat4x4A(&m);
+		}
+
 	private:
 		int start_;
 		int stop_;
-		DirectX::XMMATRIX* matrices_ = nullptr;
+		Key* keys_ = nullptr;
 
 		int current_ = 0;
 	};
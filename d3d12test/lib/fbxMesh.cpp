@@ -5,6 +5,7 @@
 #include "fbxMaterial.h"
 #include "fbxCommon.h"
 #include "fbxAnimStack.h"
+#include "AllocTracker.h"
 #include <vector>
 #include <iostream>
 
@@ -31,27 +32,13 @@ Mesh::~Mesh()
 
 HRESULT Mesh::UpdateResources(FbxMesh* pMesh, FbxPose* pBindPose, Device* pDevice)
 {
+	ALLOC_SCOPE("fbx");
+
 	Setup_();
 
 	UpdateVertexResources_(pMesh, pDevice);
 	UpdateIndexResources_(pMesh, pDevice);
 
-	{
-		auto pNode = pMesh->GetNode();
-
-		float v[3];
-		toFloat3(v, pNode->LclScaling.Get());
-		initialPose_.SetScaling(v[0], v[1], v[2]);
-
-		toFloat3Radian(v, pNode->LclRotation.Get());
-		initialPose_.SetRotation(v[0], v[1], v[2]);
-
-		toFloat3(v, pNode->LclTranslation.Get());
-		initialPose_.SetTranslation(v[0], v[1], v[2]);
-
-		initialPose_.UpdateMatrix();
-	}
-
 	for (auto i = 0; i < pMesh->GetDeformerCount(); ++i)
 	{
 		auto pSkin = static_cast<FbxSkin*>(pMesh->GetDeformer(i));
@@ -97,7 +84,6 @@ Mesh* Mesh::CreateReference()
 	other->pIndexCount_ = pIndexCount_;
 
 	other->pMaterial_ = pMaterial_->CreateReference();
-	other->initialPose_ = initialPose_;
 
 	return other;
 }
@@ -58,10 +58,11 @@ namespace fbx
 			transformCbv_.Setup(pHeap);
 		}
 
+		// t: the world matrix; the mesh's own local pose is already part of its animation keys
 		void SetTransform(const DirectX::XMMATRIX& t)
 		{
 			TransformBuffer buffer;
-			buffer.World = initialPose_.Matrix() * t;
+			buffer.World = t;
 			transformCbv_.SetBuffer(buffer);
 		}
 
@@ -80,7 +81,6 @@ namespace fbx
 		int* pIndexCount_ = nullptr;
 
 		Material* pMaterial_ = nullptr;
-		Transform initialPose_;
 
 		int animStackCount_;
 		AnimStack** pAnimStacks_ = nullptr;
@@ -94,6 +94,13 @@ Model* Model::CreateReference()
 	return other;
 }
 
+void Model::AttachToSceneGraph(SceneGraph* pGraph, SceneGraph::Node parent)
+{
+	pGraph_ = pGraph;
+	rootNode_ = pGraph->Add(parent);
+	UpdateSceneGraph();
+}
+
 HRESULT Model::UpdateResourcesRec_(FbxNode* pNode, Device* pDevice)
 {
 	if (!pNode)
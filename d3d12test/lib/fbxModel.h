@@ -1,6 +1,7 @@
 #pragma once
 #include "common.h"
 #include "Transform.h"
+#include "SceneGraph.h"
 #include <fbxsdk.h>
 #include <Windows.h>
 #include <DirectXMath.h>
@@ -43,6 +44,24 @@ namespace fbx
 
 		Model* CreateReference();
 
+		// one node for the model, driven by its transform; the FBX node hierarchy isn't added, mesh animation keys
+		// are already global in the FBX scene (see World())
+		void AttachToSceneGraph(SceneGraph* pGraph, SceneGraph::Node parent = SceneGraph::cNoParent);
+		SceneGraph::Node SceneGraphNode() { return rootNode_; }
+
+		// the transform then places this model relative to pParent; false if pParent is attached under this model
+		bool AttachTo(Model* pParent) { return pGraph_->SetParent(rootNode_, pParent->rootNode_); }
+
+		// copies the transform's matrix into the model's node, once per frame before the scene graph update
+		void UpdateSceneGraph()
+		{
+			pGraph_->SetLocal(rootNode_, transform_.StorePtr()->Matrix(transform_.Handle()));
+		}
+
+		// world matrix of the model's node, which mesh animation is relative to: the keys are the meshes'
+		// global transforms in the FBX scene, so the nodes of the FBX hierarchy must not be applied again
+		const float* World() { return pGraph_->World(rootNode_); }
+
 	private:
 		bool isReference_ = false;
 
@@ -51,6 +70,9 @@ namespace fbx
 		FbxImporter* pSceneImporter_ = nullptr;
 		std::vector<Mesh*> meshPtrs_;
 
+		SceneGraph* pGraph_ = nullptr;
+		SceneGraph::Node rootNode_ = SceneGraph::cNoParent;
+
 		Transform transform_;
 
 		ulonglong shaderHash_;
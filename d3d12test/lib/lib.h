@@ -4,11 +4,13 @@
 #include "Window.h"
 #include "Device.h"
 #include "ScreenContext.h"
+#include "GraphicsInterface.h"
 #include "GpuFence.h"
 #include "CommandQueue.h"
 #include "CommandList.h"
 #include "ResourceViewHeap.h"
 #include "Resource.h"
+#include "Texture.h"
 #include "Shader.h"
 #include "fbxCommon.h"
 #include "fbxModel.h"
@@ -16,14 +18,30 @@
 #include "fbxAnimation.h"
 #include "fbxAnimStack.h"
 #include "fbxMaterial.h"
+#include "Clock.h"
 #include "CpuStopwatch.h"
-#include "GpuStopwatch.h"
+#include "GpuQueryRing.h"
+#include "GpuProfiler.h"
+#include "LatencyHistogram.h"
+#include "FrameStats.h"
 #include "FrameCounter.h"
-#include "CpuStopwatchBatch.h"
+#include "CpuProfiler.h"
+#include "AllocTracker.h"
+#include "Metrics.h"
+#include "SinCos.h"
+#include "Quaternion.h"
+#include "TransformStore.h"
 #include "Camera.h"
 #include "ShaderManager.h"
 #include "CommandListManager.h"
 #include "TaskQueue.h"
+#include "TaskGraph.h"
+#include "SceneGraph.h"
+#include "TaskQueueProbe.h"
+#include "StatsCheck.h"
+#include "NullGraphics.h"
+#include "FrameCapture.h"
+#include "FrameBench.h"
 #include "ConstantBuffer.h"
 
 #pragma comment(lib, "D3d12.lib")
@@ -9,10 +9,13 @@
 #include <Windows.h>
 #include <tchar.h>
 #include <string>
+#include <cstring>
 #include <iostream>
 #include <algorithm>
+#include <mutex>
 
 #include "lib/lib.h"
+#include "lib/Async.h"
 #include "Graphics.h"
 #include "Model.h"
 
@@ -21,8 +24,16 @@ using Microsoft::WRL::ComPtr;
 const int cScreenWidth = 1280;
 const int cScreenHeight = 720;
 const int cBufferCount = 2;
+const double cTargetFrameRate = 60.0;
 const int cModelGridSize = 1;
 const int cThreadCount = 3;
+const double cBackgroundBudgetMilliseconds = 4.0;
+const int cTraceFrameCount = 120;
+const double cTraceSpikeMilliseconds = 50.0;
+const int cGpuProfileFrameCount = cBufferCount + 1;
+const int cGpuProfileZoneCount = 64;
+const int cAllocCheckWarmupFrameCount = 120;
+const double cMetricsIntervalMilliseconds = 1000.0;
 
 struct Scene
 {
@@ -34,8 +45,7 @@ struct Scene
 
 	ResourceViewHeap cbSrUavHeap;
 
-	TransformBuffer modelBuffers[cThreadCount];
-	CameraBuffer cameraBuffers[cThreadCount];
+	CameraBuffer cameraBuffer;
 
 	Camera camera;
 	ShaderManager shaders;
@@ -45,29 +55,37 @@ struct Scene
 
 	CommandListManager commandLists;
 	TaskQueue taskQueue;
+	TaskGraph frameGraph;
+	SceneGraph sceneGraph;
+
+	fbx::Animation animation;
+	TaskGroup loadGroup;
+	bool isLoaded;
+
+	// textures go up on their own queue, so the loader never touches the frame queue's fence
+	CommandQueue uploadQueue;
+	CommandList* pUploadCommandList;
+	FenceWaitList<GpuFence> uploadFenceWaits;
+
+	FrameInput frameInput;
+	FrameCaptureWriter capture;
+	FrameCaptureReader replay;
 };
 Scene* pScene = nullptr;
 
 void CreateModelCommand(Graphics& g)
 {
 	auto& lists = pScene->commandLists.GetCommandList("model_bundles");
+	std::mutex listsLock;
+	TaskGroup group;
 
 	const auto threadCount = pScene->taskQueue.ThreadCount();
-	const auto countPerThread = pScene->modelPtrs.size() / threadCount;
+	const auto modelCount = static_cast<int>(pScene->modelPtrs.size());
+	const auto countPerThread = std::max(1, modelCount / threadCount);
 
-	for (auto i = 0; i < threadCount; ++i)
+	pScene->taskQueue.ParallelFor(0, modelCount, countPerThread, [&g, &lists, &listsLock](int start, int end)
 	{
-		auto count = countPerThread;
-		if (i == threadCount - 1)
-		{
-			count = pScene->modelPtrs.size() - countPerThread * i;
-		}
-
-		const auto start = countPerThread * i;
-		const auto end = start + count;
-
 		auto pList = g.CreateCommandList(CommandList::SubmitType::Bundle, 1);
-		lists.push_back(pList);
 
 		pList->Open(nullptr);
 
@@ -86,22 +104,187 @@ void CreateModelCommand(Graphics& g)
 			if (lastShader != shader)
 			{
 				const auto& name = pScene->shaders.Name(shader);
-				pNativeList->SetPipelineState(pScene->pPipelineStates[name].Get());
+				pNativeList->SetPipelineState(pScene->pPipelineStates.at(name).Get());
 				lastShader = shader;
 			}
 			pModel->CreateDrawCommand(pNativeList);
 		}
 
 		pList->Close();
+
+		std::unique_lock<std::mutex> lk(listsLock);
+		lists.push_back(pList);
+	}, &group);
+
+	group.Wait();
+}
+
+void UpdateCamera()
+{
+	UpdateCameraBuffer(&pScene->camera, pScene->frameInput.Camera, &pScene->cameraBuffer);
+}
+
+// transform[0] -+                 +-> level 0[0] -+
+// transform[1] -+-> transforms ---+-> level 0[1] -+-> level 0 -> level 1[*] -> ... -> scene graph -+-> cbuffer[0]
+// ...                                                                                              +-> cbuffer[1]
+//                                                                                                  +-> ...
+// camera -----------------------------------------------------------------------------------------> cbuffer[*]
+// transform jobs compose slices of the TransformStore's dirty list, which don't line up with the models of
+// a cbuffer job, so every cbuffer job waits for all of them; the transforms barrier then clears the list
+// and hands the model matrices to the scene graph, which is updated one level after the other
+// the levels are laid out here, so attaching models after this needs BuildFrameGraph() again
+void BuildFrameGraph(Graphics& g)
+{
+	auto& graph = pScene->frameGraph;
+	graph.Clear();
+
+	const auto cameraJob = graph.AddJob([]()
+	{
+		CPU_PROFILE_SCOPE("camera");
+		UpdateCamera();
+	});
+
+	auto& models = pScene->modelPtrs;
+	const auto modelCount = static_cast<int>(models.size());
+	const auto chunkCount = std::min(modelCount, pScene->taskQueue.ThreadCount() * 4);
+
+	// the dirty list is filled by UpdateFrameInput() before the graph runs, so each job takes its slice then
+	auto& transforms = TransformStore::Instance();
+
+	auto& sceneGraph = pScene->sceneGraph;
+
+	const auto transformsJob = graph.AddJob([&transforms, &models]()
+	{
+		transforms.ClearDirty();
+		for (auto pModel : models)
+		{
+			pModel->UpdateSceneGraph();
+		}
+	});
+	for (auto i = 0; i < chunkCount; ++i)
+	{
+		const auto transformJob = graph.AddJob([&transforms, i, chunkCount]()
+		{
+			CPU_PROFILE_SCOPE("transform");
+			const auto dirtyCount = transforms.DirtyCount();
+			transforms.UpdateDirtyMatrices(dirtyCount * i / chunkCount, dirtyCount * (i + 1) / chunkCount);
+		});
+		graph.AddDependency(transformJob, transformsJob);
+	}
+
+	sceneGraph.Prepare();
+	auto levelJob = transformsJob;
+	for (auto level = 0; level < sceneGraph.LevelCount(); ++level)
+	{
+		const auto levelSize = sceneGraph.LevelSize(level);
+		const auto levelChunkCount = std::max(1, std::min(chunkCount, levelSize / SceneGraph::cMinParallelLevelSize));
+
+		const auto nextLevelJob = graph.AddJob([]() {});
+		for (auto i = 0; i < levelChunkCount; ++i)
+		{
+			const auto start = levelSize * i / levelChunkCount;
+			const auto end = levelSize * (i + 1) / levelChunkCount;
+
+			const auto job = graph.AddJob([&sceneGraph, level, start, end]()
+			{
+				CPU_PROFILE_SCOPE("scene_graph");
+				sceneGraph.UpdateLevel(level, start, end);
+			});
+			graph.AddDependency(levelJob, job);
+			graph.AddDependency(job, nextLevelJob);
+		}
+		levelJob = nextLevelJob;
+	}
+
+	const auto sceneGraphJob = graph.AddJob([&sceneGraph]()
+	{
+		sceneGraph.FinishUpdate();
+	});
+	graph.AddDependency(levelJob, sceneGraphJob);
+
+	for (auto i = 0; i < chunkCount; ++i)
+	{
+		const auto start = modelCount * i / chunkCount;
+		const auto end = modelCount * (i + 1) / chunkCount;
+
+		const auto cbufferJob = graph.AddJob([&models, start, end]()
+		{
+			CPU_PROFILE_SCOPE("cbuffer");
+			for (auto j = start; j < end; ++j)
+			{
+				models[j]->SetTransform(pScene->cameraBuffer);
+			}
+		});
+
+		graph.AddDependency(sceneGraphJob, cbufferJob);
+		graph.AddDependency(cameraJob, cbufferJob);
 	}
 }
 
+// file loading runs on the background lane while frames keep going, texture uploads wait for their fence
+// without holding a thread; FinishSceneSetup() picks the result up on the main thread once it is done
+Async<HRESULT> LoadSceneAsync(Device* pDevice)
+{
+	auto pQueue = &pScene->taskQueue;
+	auto pModel = pScene->modelPtrs[0];
+
+	co_await RunOn(pQueue, [pModel, pDevice]()
+	{
+		pModel->Setup(pDevice, "assets/test_anim.fbx");
+		return S_OK;
+	});
+
+	auto result = co_await RunOn(pQueue, []()
+	{
+		return pScene->animation.LoadFromFile("assets/test_anim.fbx");
+	});
+	if (FAILED(result))
+	{
+		co_return result;
+	}
+
+	// one texture at a time: the upload list can only be reset once the GPU is done with the previous copy
+	for (auto i = 0; i < pModel->MeshCount(); ++i)
+	{
+		auto pTexture = pModel->FbxModel().MeshPtr(i)->MaterialPtr()->TexturePtr();
+		if (pTexture == nullptr)
+		{
+			continue;
+		}
+
+		UINT64 fenceValue = 0;
+		result = co_await RunOn(pQueue, [pTexture, &fenceValue]()
+		{
+			return pTexture->SubmitSubresource(pScene->pUploadCommandList, &pScene->uploadQueue, &fenceValue);
+		});
+		if (FAILED(result))
+		{
+			co_return result;
+		}
+
+		co_await pScene->uploadFenceWaits.Wait(pScene->uploadQueue.FencePtr(), fenceValue);
+		pTexture->ReleaseIntermediate();
+	}
+
+	co_return result;
+}
+
 bool SetupScene(Graphics& g)
 {
-	pScene->taskQueue.Setup(cThreadCount);
+	// only the last worker takes background tasks: frame work always has the other workers,
+	// and the FBX SDK never sees two imports at once
+	auto taskQueueDesc = TaskQueue::DefaultDesc(cThreadCount, TaskQueue::Mode::WorkStealing);
+	taskQueueDesc.Name = "frame";
+	taskQueueDesc.PinWorkers = true;
+	taskQueueDesc.ReserveMainThreadCore = true;
+	for (auto i = 0; i < cThreadCount - 1; ++i)
+	{
+		taskQueueDesc.Workers[i].PriorityMask = TaskPriorityBit(TaskPriority::Critical);
+	}
+	pScene->taskQueue.Setup(taskQueueDesc);
+	pScene->taskQueue.SetBackgroundBudget(cBackgroundBudgetMilliseconds);
 
 	auto pDevice = g.DevicePtr();
-	auto pNativeDevice = pDevice->NativePtr();
 
 	auto& commandListPtrs = pScene->commandLists.CreateCommandLists("main", 0);
 	pScene->commandLists.CreateCommandLists("model_bundles", -1);
@@ -110,17 +293,25 @@ bool SetupScene(Graphics& g)
 	auto pCommandList = g.CreateCommandList(CommandList::SubmitType::Direct, 1);
 	commandListPtrs.push_back(pCommandList);
 
+	pScene->uploadQueue.Create(pDevice);
+	pScene->pUploadCommandList = g.CreateCommandList(CommandList::SubmitType::Direct, 1);
+	pScene->uploadFenceWaits.Setup(&pScene->taskQueue);
+
 	for (auto& pModel : pScene->modelPtrs)
 	{
 		pModel = new Model();
 	}
-	Model* rootModels[] = { pScene->modelPtrs[0] };
 
-	rootModels[0]->Setup(pDevice, "assets/test_anim.fbx");
-	rootModels[0]->UpdateSubresources(pCommandList, g.CommandQueuePtr());
+	pScene->isLoaded = false;
+	LoadSceneAsync(pDevice).Start(&pScene->taskQueue, &pScene->loadGroup);
 
-	fbx::Animation anim;
-	anim.LoadFromFile("assets/test_anim.fbx");
+	return true;
+}
+
+bool FinishSceneSetup(Graphics& g)
+{
+	auto pDevice = g.DevicePtr();
+	auto pNativeDevice = pDevice->NativePtr();
 
 	auto meshCount = 0;
 	for (auto pModel : pScene->modelPtrs)
@@ -135,6 +326,9 @@ bool SetupScene(Graphics& g)
 		pModel->SetupBuffers(&pScene->cbSrUavHeap);
 	}
 
+	pScene->frameInput.Transforms.resize(pScene->modelPtrs.size());
+	pScene->frameInput.AnimationFrames.resize(meshCount);
+
 	for (auto i = 0; i < cModelGridSize; ++i)
 	{
 		for (auto j = 0; j < cModelGridSize; ++j)
@@ -154,6 +348,11 @@ bool SetupScene(Graphics& g)
 		}
 	}
 
+	for (auto pModel : pScene->modelPtrs)
+	{
+		pModel->AttachToSceneGraph(&pScene->sceneGraph);
+	}
+
 	{
 		CD3DX12_DESCRIPTOR_RANGE1 ranges[3];
 		ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
@@ -241,101 +440,117 @@ bool SetupScene(Graphics& g)
 	pScene->rotateAngle = 0.f;
 
 	CreateModelCommand(g);
+	BuildFrameGraph(g);
 
+	pScene->isLoaded = true;
 	return true;
 }
 
-CpuStopwatchBatch sw;
-
-void Calc()
+// fills pScene->frameInput from the running scene, or applies the next frame of a replayed capture to it,
+// and records it when capturing; returns false once the replay has run out
+bool UpdateFrameInput(Graphics& g)
 {
-	sw.Start(100, "calc");
-
-	pScene->rotateAngle += 0.01f;
+	auto& input = pScene->frameInput;
+	auto& models = pScene->modelPtrs;
 
-#if false
-	for (auto i = 0; i < cModelGridSize * cModelGridSize * cModelGridSize; ++i)
+	if (pScene->replay.IsOpen())
 	{
-		auto pModel = pScene->modelPtrs[i];
+		if (pScene->replay.TransformCount() != static_cast<int>(input.Transforms.size())
+			|| pScene->replay.AnimationFrameCount() != static_cast<int>(input.AnimationFrames.size()))
+		{
+			printf("[replay] the capture was taken from a different scene\n");
+			return false;
+		}
 
-		auto t = pModel->TransformPtr();
-		t->SetRotation(0.0f, pScene->rotateAngle, 0.0f);
-		t->UpdateMatrix();
-	}
-#else
-	const auto threadCount = pScene->taskQueue.ThreadCount();
+		const auto pFrame = pScene->replay.Next();
+		if (pFrame == nullptr)
+		{
+			return false;
+		}
+		input = *pFrame;
 
-	auto& models = pScene->modelPtrs;
-	const auto countPerThread = models.size() / threadCount;
+		pScene->rotateAngle = input.RotateAngle;
 
-	for (auto i = 0; i < threadCount; ++i)
-	{
-		auto count = countPerThread;
-		if (i == threadCount - 1)
+		auto mesh = 0;
+		for (auto i = 0; i < static_cast<int>(models.size()); ++i)
 		{
-			count = pScene->modelPtrs.size() - countPerThread * i;
+			const auto& transform = input.Transforms[i];
+			auto t = models[i]->TransformPtr();
+			t->SetScaling(transform.Scaling[0], transform.Scaling[1], transform.Scaling[2]);
+			t->SetRotation(transform.Rotation[0], transform.Rotation[1], transform.Rotation[2]);
+			t->SetTranslation(transform.Translation[0], transform.Translation[1], transform.Translation[2]);
+
+			for (auto j = 0; j < models[i]->MeshCount(); ++j)
+			{
+				models[i]->AnimStackPtr(j)->SetCurrentFrame(input.AnimationFrames[mesh++]);
+			}
 		}
+	}
+	else
+	{
+		pScene->rotateAngle += 0.01f;
 
-		const auto start = countPerThread * i;
-		const auto end = start + count;
+		input.Camera = { { 10.0f, 5.0f, -10.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, DirectX::XM_PIDIV4, g.ScreenPtr()->AspectRatio(), 0.1f, 1000.0f };
+		input.RotateAngle = pScene->rotateAngle;
 
-		pScene->taskQueue.Enqueue([i, start, end, &models]()
+		auto mesh = 0;
+		for (auto i = 0; i < static_cast<int>(models.size()); ++i)
 		{
-			for (auto j = start; j < end; ++j)
+			auto& transform = input.Transforms[i];
+			const auto t = models[i]->TransformPtr();
+			const auto scaling = t->Scaling();
+			const auto rotation = t->Rotation();
+			const auto translation = t->Translation();
+			transform = { { scaling.X, scaling.Y, scaling.Z }, { rotation.X, rotation.Y, rotation.Z }, { translation.X, translation.Y, translation.Z } };
+
+			for (auto j = 0; j < models[i]->MeshCount(); ++j)
 			{
-				auto pModel = models[j];
-
-				auto t = pModel->TransformPtr();
-				//t->SetRotation(0.0f, pScene->rotateAngle, 0.0f);
-				t->UpdateMatrix();
+				input.AnimationFrames[mesh++] = models[i]->AnimStackPtr(j)->CurrentFrame();
 			}
-		});
+		}
 	}
-#endif
 
-	sw.Stop(100);
+	if (pScene->capture.IsOpen())
+	{
+		pScene->capture.Write(input);
+	}
+	return true;
 }
 
-void Draw(Graphics& g, GpuStopwatch* pStopwatch)
+void Calc(Graphics& g)
 {
-	sw.Start(200, "all");
+	CPU_PROFILE_SCOPE("calc");
+	ALLOC_SCOPE("calc");
 
-	sw.Start(201, "camera");
+	if (pScene->isLoaded && !UpdateFrameInput(g))
 	{
-		auto& c = pScene->camera;
+		PostQuitMessage(0);
+	}
 
-		c.SetPosition({ 10.0f, 5.0f, -10.0f });
-		c.SetFocus({ 0.0f, 0.0f, 0.0f });
-		c.SetUp({ 0.0f, 1.0f, 0.0f });
+	pScene->frameGraph.Run(&pScene->taskQueue);
+}
 
-		c.SetFovY(DirectX::XM_PIDIV4);
-		c.SetAspect(g.ScreenPtr()->AspectRatio());
-		c.SetNearPlane(0.1f);
-		c.SetFarPlane(1000.0f);
+void Draw(Graphics& g, GpuProfiler* pGpuProfiler)
+{
+	CPU_PROFILE_SCOPE("all");
+	ALLOC_SCOPE("draw");
 
-		c.UpdateMatrix();
-
-		for (auto i = 0; i < pScene->taskQueue.ThreadCount(); ++i)
-		{
-			pScene->cameraBuffers[i].View = c.View();
-			pScene->cameraBuffers[i].Proj = c.Proj();
-		}
-	}
-	sw.Stop(201);
+	pGpuProfiler->BeginFrame();
 
 	auto pGraphicsList = pScene->commandLists.GetCommandList("main")[0];
 	pGraphicsList->Open(nullptr);
 
 	auto pNativeGraphicsList = pGraphicsList->GraphicsList();
 
+	if (pScene->isLoaded)
 	{
 		auto heap = pScene->cbSrUavHeap.NativePtr();
 		pNativeGraphicsList->SetDescriptorHeaps(1, &heap);
 	}
-	pStopwatch->Start(g.CommandQueuePtr()->NativePtr(), pNativeGraphicsList);
 
-	sw.Start(210, "RS");
 	{
+		CPU_PROFILE_SCOPE("RS");
+
 		const auto& screen = g.ScreenPtr()->Desc();
 		pScene->viewport = { 0.0f, 0.0f, (float)screen.Width, (float)screen.Height, 0.0f, 1.0f };
 		pNativeGraphicsList->RSSetViewports(1, &pScene->viewport);
@@ -343,10 +558,11 @@ void Draw(Graphics& g, GpuStopwatch* pStopwatch)
 		pScene->scissorRect = { 0, 0, screen.Width, screen.Height };
 		pNativeGraphicsList->RSSetScissorRects(1, &pScene->scissorRect);
 	}
-	sw.Stop(210);
 
-	sw.Start(220, "OM");
 	{
+		CPU_PROFILE_SCOPE("OM");
+		GPU_PROFILE_SCOPE(pGpuProfiler, pNativeGraphicsList, "clear");
+
 		const auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 			g.CurrentRenderTargetPtr()->NativePtr(),
 			D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET
@@ -362,53 +578,11 @@ void Draw(Graphics& g, GpuStopwatch* pStopwatch)
 		pNativeGraphicsList->ClearRenderTargetView(handleRTV, clearValue, 0, nullptr);
 		pNativeGraphicsList->ClearDepthStencilView(handleDSV, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 	}
-	sw.Stop(220);
-
-	sw.Start(225, "wait_calc");
-	{
-		pScene->taskQueue.WaitAll();
-	}
-	sw.Stop(225);
 
-	const auto threadCount = pScene->taskQueue.ThreadCount();
-
-	sw.Start(230, "models_cbuffer_update");
 	{
-		auto& models = pScene->modelPtrs;
-		const auto countPerThread = models.size() / threadCount;
-
-		for (auto i = 0; i < threadCount; ++i)
-		{
-			auto count = countPerThread;
-			if (i == threadCount - 1)
-			{
-				count = pScene->modelPtrs.size() - countPerThread * i;
-			}
+		CPU_PROFILE_SCOPE("models-draw");
+		GPU_PROFILE_SCOPE(pGpuProfiler, pNativeGraphicsList, "models");
 
-			const auto start = countPerThread * i;
-			const auto end = start + count;
-
-			pScene->taskQueue.Enqueue([i, start, end, &models]()
-			{
-				for (auto j = start; j < end; ++j)
-				{
-					auto pModel = models[j];
-					pScene->modelBuffers[i].World = pModel->TransformPtr()->Matrix();
-					pModel->SetTransform(pScene->modelBuffers[i].World, pScene->cameraBuffers[i]);
-				}
-			});
-		}
-
-		//for (auto pModel : pScene->modelPtrs)
-		//{
-		//	pScene->modelTransforms[0].World = pModel->TransformPtr()->Matrix();
-		//	pModel->SetTransform(pScene->modelTransforms[0]);
-		//}
-	}
-	sw.Stop(230);
-
-	sw.Start(240, "models-draw");
-	{
 		for (auto pBundle : pScene->commandLists.GetCommandList("model_bundles"))
 		{
 			//pScene->taskQueue.Enqueue([pNativeGraphicsList, pBundle]()
@@ -417,67 +591,103 @@ void Draw(Graphics& g, GpuStopwatch* pStopwatch)
 			//});
 		}
 	}
-	sw.Stop(240);
 
-	sw.Start(250, "wait_OM");
 	{
+		CPU_PROFILE_SCOPE("wait_OM");
+		GPU_PROFILE_SCOPE(pGpuProfiler, pNativeGraphicsList, "present_barrier");
+
 		const auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 			g.CurrentRenderTargetPtr()->NativePtr(),
 			D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT
 		);
 		pNativeGraphicsList->ResourceBarrier(1, &barrier);
 	}
-	sw.Stop(250);
 
-	pStopwatch->Stop();
+	pGpuProfiler->Resolve(pNativeGraphicsList);
 
-	sw.Start(260, "close_cmdlist");
 	{
+		CPU_PROFILE_SCOPE("close_cmdlist");
+
 		pGraphicsList->Close();
 	}
-	sw.Stop(260);
 
-	sw.Start(265, "wait_models_cbuffer_update");
 	{
-		pScene->taskQueue.WaitAll();
+		CPU_PROFILE_SCOPE("wait_frame_graph");
+
+		pScene->frameGraph.Wait();
 	}
-	sw.Stop(265);
 
-	sw.Start(270, "submit_cmdlist");
 	{
+		CPU_PROFILE_SCOPE("submit_cmdlist");
+
 		pScene->commandLists.Execute(g.CommandQueuePtr());
+		pGpuProfiler->EndFrame();
 	}
-	sw.Stop(270);
 
-	sw.Start(280, "swap");
 	{
+		CPU_PROFILE_SCOPE("swap");
+
 		g.SwapBuffers(1);
 	}
-	sw.Stop(280);
 
-	sw.Start(290, "wait_cmdlist");
 	{
-		g.WaitForCommandExecution();
-	}
-	sw.Stop(290);
+		CPU_PROFILE_SCOPE("wait_cmdlist");
 
-	sw.Stop(200);
-	if (sw.DumpAll(200, 60))
-	{
-		sw.Reset();
+		g.WaitForCommandExecution();
 	}
 }
 
 void ShutdownScene()
 {
+	// nobody calls BeginFrame() any more to pay the background debt down, or polls the upload fence
+	pScene->taskQueue.SetBackgroundBudget(0.0);
+	while (!pScene->loadGroup.IsDone())
+	{
+		pScene->uploadFenceWaits.Poll();
+		std::this_thread::yield();
+	}
+	SafeDelete(&pScene->pUploadCommandList);
+
 	for (auto& pModel : pScene->modelPtrs)
 	{
 		SafeDelete(&pModel);
 	}
 }
 
-int MainImpl(int, char**)
+int MainImpl(int argc, char** argv)
 {
+	auto isAllocCheck = false;
+	const char* capturePath = nullptr;
+	const char* replayPath = nullptr;
+
+	for (auto i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+		{
+			capturePath = argv[++i];
+		}
+		if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replayPath = argv[++i];
+		}
+		if (strcmp(argv[i], "--alloc-telemetry") == 0)
+		{
+			AllocTracker::Instance().SetEnabled(true);
+		}
+		if ((strcmp(argv[i], "--metrics-csv") == 0 || strcmp(argv[i], "--metrics-json") == 0) && i + 1 < argc)
+		{
+			const auto format = (strcmp(argv[i], "--metrics-csv") == 0) ? MetricsRegistry::Format::Csv : MetricsRegistry::Format::JsonLines;
+			MetricsRegistry::Instance().SetOutput(argv[i + 1], format, cMetricsIntervalMilliseconds);
+			++i;
+		}
+		if (strcmp(argv[i], "--alloc-check") == 0)
+		{
+			// no allocations allowed once the scene has been loaded and warmed up
+			AllocTracker::Instance().SetEnabled(true);
+			isAllocCheck = true;
+		}
+	}
+
 	fbx::Setup();
 
 	Window window;
@@ -509,35 +719,102 @@ int MainImpl(int, char**)
 
 	graphics.ResizeScreen(desc);
 
+	{
+		auto& profiler = CpuProfiler::Instance();
+		profiler.SetThreadName("main");
+		profiler.SetTraceFrameCount(cTraceFrameCount);
+		profiler.SetSpikeTrigger(cTraceSpikeMilliseconds, "frame_spike_");
+	}
+
 	pScene = new Scene();
 	SetupScene(graphics);
 
+	if (capturePath != nullptr && !pScene->capture.Open(capturePath))
+	{
+		printf("[capture] cannot open %s\n", capturePath);
+	}
+	if (replayPath != nullptr && !pScene->replay.Open(replayPath))
+	{
+		printf("[replay] cannot read %s\n", replayPath);
+	}
+
 	CpuStopwatch sw;
-	GpuStopwatch gsw;
-	gsw.Create(graphics.DevicePtr()->NativePtr(), 1);
+	GpuProfiler gpuProfiler;
+	gpuProfiler.Create(graphics.DevicePtr(), graphics.CommandQueuePtr(), cGpuProfileFrameCount, cGpuProfileZoneCount);
+
+	FrameCounter counter(&sw, &gpuProfiler);
+	counter.SetTargetFrameRate(cTargetFrameRate);
 
-	FrameCounter counter(&sw, &gsw);
+	auto steadyFrameCount = 0;
+	auto pCpuTimeHistogram = MetricsRegistry::Instance().Histogram("frame.cpu_ms");
+	auto pGpuTimeHistogram = MetricsRegistry::Instance().Histogram("frame.gpu_ms");
 
-	window.MessageLoop([&graphics, &counter]()
+	window.MessageLoop([&graphics, &counter, &steadyFrameCount, isAllocCheck, pCpuTimeHistogram, pGpuTimeHistogram]()
 	{
 		counter.CpuWatchPtr()->Start();
 
-		Calc();
-		Draw(graphics, counter.GpuWatchPtr());
+		pScene->taskQueue.BeginFrame();
+		pScene->uploadFenceWaits.Poll();
+		if (!pScene->isLoaded && pScene->loadGroup.IsDone())
+		{
+			FinishSceneSetup(graphics);
+		}
+
+		Calc(graphics);
+		Draw(graphics, counter.GpuProfilerPtr());
 
 		counter.CpuWatchPtr()->Stop();
 		counter.NextFrame();
 
+		const auto& sample = counter.StatsPtr()->Sample(0);
+		pCpuTimeHistogram->Add(sample.CpuTime);
+		pGpuTimeHistogram->Add(sample.GpuTime);
+
+		auto& allocTracker = AllocTracker::Instance();
+		allocTracker.EndFrame();
+		if (isAllocCheck && pScene->isLoaded && ++steadyFrameCount == cAllocCheckWarmupFrameCount)
+		{
+			allocTracker.SetNoAllocationCheck(true);
+		}
+
+		auto& profiler = CpuProfiler::Instance();
+		profiler.EndFrame();
+		if (profiler.FrameCount() >= 60)
+		{
+			profiler.Dump();
+			profiler.Reset();
+
+			if (allocTracker.IsEnabled())
+			{
+				allocTracker.Dump();
+				allocTracker.Reset();
+			}
+		}
+
 		if (counter.CpuTime() > 1000.0)
 		{
 			const auto frames = counter.FrameCount();
 			printf(
-				"fps: %d, CPU: %.4f %%, GPU: %.4f %%\n",
+				"fps: %d (%.1f), CPU: %.4f %%, GPU: %.4f %%, CPU p50/p95/p99/max: %.3f/%.3f/%.3f/%.3f ms, CPU stddev: %.3f ms, jitter: %.3f ms, late: %d%s\n",
 				counter.FrameCount(),
-				counter.CpuUtilization(60),
-				counter.GpuUtilization(60));
+				counter.FrameRate(),
+				counter.CpuUtilization(),
+				counter.GpuUtilization(),
+				counter.CpuTimePercentile(50.0),
+				counter.CpuTimePercentile(95.0),
+				counter.CpuTimePercentile(99.0),
+				counter.MaxCpuTime(),
+				counter.CpuTimeStdDev(),
+				counter.AverageJitter(),
+				counter.LateFrameCount(),
+				pScene->isLoaded ? "" : " (loading)");
 			counter.Reset();
 		}
+
+		MetricsRegistry::Instance().Tick();
+
+		// the reports above aren't part of the frame
+		allocTracker.Skip();
 	});
 
 	graphics.WaitForCommandExecution();
@@ -551,6 +828,12 @@ int MainImpl(int, char**)
 
 	//graphics.DevicePtr()->ReportLiveObjects();
 
+	if (isAllocCheck && AllocTracker::Instance().ViolationCount() > 0)
+	{
+		printf("[alloc] %d steady-state frames allocated\n", AllocTracker::Instance().ViolationCount());
+		return 1;
+	}
+
 	return 0;
 }
 
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+#include "lib/Async.h"
+#include "lib/GraphicsInterface.h"
+#include "lib/StatsCheck.h"
+#include "lib/TaskGroup.h"
+#include "lib/TaskQueue.h"
+
+// d3d12check_async: Async.h's coroutines against a fence the check completes by hand, the way
+// LoadSceneAsync() waits for texture uploads; its own executable because the coroutines need C++20
+// (CMakeLists.txt only builds it where the compiler has them)
+
+const int cThreadCount = 3;
+
+// stands in for the upload queue's GpuFence
+class FakeFence : public IFence
+{
+public:
+	uint64_t CompletedValue() override { return value_.load(); }
+
+	void WaitForCompletion(uint64_t value) override
+	{
+		while (value_.load() < value)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void Complete(uint64_t value) { value_.store(value); }
+
+private:
+	std::atomic<uint64_t> value_{ 0 };
+};
+
+// what the coroutines saw, for the checks on the main thread
+struct AsyncTrace
+{
+	std::atomic<int> Step{ 0 };
+	std::atomic<uint64_t> CompletedAtResume{ 0 };
+	std::thread::id ResumeThread;
+	int Result = 0;
+};
+
+template<class Predicate>
+bool WaitUntil(Predicate predicate)
+{
+	const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (!predicate())
+	{
+		if (std::chrono::steady_clock::now() > timeout)
+		{
+			return false;
+		}
+		std::this_thread::yield();
+	}
+	return true;
+}
+
+Async<int> LoadPartAsync(TaskQueue* pQueue, int value)
+{
+	co_return co_await RunOn(pQueue, [value]() { return value; });
+}
+
+// LoadSceneAsync()'s shape: a load on the background lane, then two uploads, each awaiting its fence value
+Async<int> LoadAsync(TaskQueue* pQueue, FenceWaitList<IFence>* pWaits, FakeFence* pFence, AsyncTrace* pTrace)
+{
+	auto result = co_await LoadPartAsync(pQueue, 40);
+	pTrace->Step = 1;
+
+	for (auto i = 1; i <= 2; ++i)
+	{
+		const auto fenceValue = co_await RunOn(pQueue, [i]() { return static_cast<uint64_t>(i); });
+		co_await pWaits->Wait(pFence, fenceValue);
+
+		pTrace->CompletedAtResume = pFence->CompletedValue();
+		pTrace->ResumeThread = std::this_thread::get_id();
+		pTrace->Step = 1 + i;
+		++result;
+	}
+
+	pTrace->Result = result;
+	co_return result;
+}
+
+// a fence value that has already completed doesn't suspend, so it never goes through Poll()
+Async<int> CompletedWaitAsync(FenceWaitList<IFence>* pWaits, FakeFence* pFence, AsyncTrace* pTrace)
+{
+	co_await pWaits->Wait(pFence, 1);
+	pTrace->Result = 1;
+	co_return 1;
+}
+
+Async<int> ThrowingAsync(TaskQueue* pQueue, AsyncTrace* pTrace)
+{
+	try
+	{
+		co_await RunOn(pQueue, []() -> int { throw std::runtime_error("load failed"); });
+		pTrace->Result = 1;
+	}
+	catch (const std::runtime_error&)
+	{
+		pTrace->Result = -1;
+	}
+	co_return pTrace->Result;
+}
+
+int CheckFenceWait()
+{
+	auto failureCount = 0;
+
+	TaskQueue queue;
+	queue.Setup(cThreadCount, TaskQueue::Mode::WorkStealing);
+
+	FenceWaitList<IFence> waits;
+	waits.Setup(&queue);
+
+	FakeFence fence;
+	AsyncTrace trace;
+	TaskGroup group;
+	LoadAsync(&queue, &waits, &fence, &trace).Start(&queue, &group);
+
+	failureCount += StatsExpect(WaitUntil([&waits]() { return waits.WaitingCount() == 1; }), "suspends on the first fence value");
+	failureCount += StatsExpect(trace.Step == 1, "the background load ran before the wait");
+	failureCount += StatsExpect(waits.Poll() == 0, "nothing resumes before the fence completes");
+	failureCount += StatsExpect(!group.IsDone(), "not done while waiting");
+
+	fence.Complete(1);
+	failureCount += StatsExpect(waits.Poll() == 1, "the completed wait resumes");
+	failureCount += StatsExpect(WaitUntil([&trace, &waits]() { return trace.Step == 2 && waits.WaitingCount() == 1; }), "suspends on the second fence value");
+	failureCount += StatsExpect(trace.CompletedAtResume == 1, "resumed only after the fence reached its value");
+	failureCount += StatsExpect(trace.ResumeThread != std::this_thread::get_id(), "resumed on a worker, not on the thread that polled");
+	failureCount += StatsExpect(waits.Poll() == 0, "the second wait holds at fence value 1");
+
+	// past the awaited value, like a fence that has moved on by the time it is polled
+	fence.Complete(5);
+	failureCount += StatsExpect(waits.Poll() == 1, "the second wait resumes");
+	group.Wait();
+	failureCount += StatsExpect(trace.Step == 3 && trace.Result == 42, "runs to the end with its result");
+	failureCount += StatsExpect(waits.WaitingCount() == 0, "no waits left");
+
+	AsyncTrace completedTrace;
+	TaskGroup completedGroup;
+	CompletedWaitAsync(&waits, &fence, &completedTrace).Start(&queue, &completedGroup);
+	completedGroup.Wait();
+	failureCount += StatsExpect(completedTrace.Result == 1 && waits.WaitingCount() == 0, "a completed fence value doesn't suspend");
+
+	return failureCount;
+}
+
+int CheckException()
+{
+	TaskQueue queue;
+	queue.Setup(cThreadCount, TaskQueue::Mode::WorkStealing);
+
+	AsyncTrace trace;
+	TaskGroup group;
+	ThrowingAsync(&queue, &trace).Start(&queue, &group);
+	group.Wait();
+
+	return StatsExpect(trace.Result == -1, "RunOn() rethrows in the coroutine what its function threw");
+}
+
+int main()
+{
+	auto failureCount = 0;
+
+	printf("fence wait\n");
+	failureCount += CheckFenceWait();
+	printf("exception\n");
+	failureCount += CheckException();
+
+	printf("%d failed\n", failureCount);
+	return (failureCount == 0) ? 0 : 1;
+}
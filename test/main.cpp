@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "lib/SinCos.h"
+#include "lib/StatsCheck.h"
+#include "lib/TaskQueue.h"
+#include "lib/TaskQueueProbe.h"
+
+// headless checks of d3d12test/lib's CPU-side code; no window, D3D12 device or FBX SDK needed
+// d3d12check [name...] runs the named checks (all of them without a name) and exits non-zero if one fails;
+// CMakeLists.txt registers each one with ctest
+
+// the app's worker count (main.cpp)
+const int cThreadCount = 3;
+
+// StatsCheck.h's checks return their failure count
+int ReturnCode(int failureCount)
+{
+	return (failureCount == 0) ? 0 : 1;
+}
+
+int RunClockCheck() { return ReturnCode(CheckClock()); }
+int RunFrameStatsCheck() { return ReturnCode(CheckFrameStats()); }
+int RunLatencyHistogramCheck() { return ReturnCode(CheckLatencyHistogram()); }
+int RunFrameStatsAllocCheck() { return ReturnCode(CheckFrameStatsAllocations()); }
+int RunGpuQueryRingCheck() { return ReturnCode(CheckGpuQueryRing()); }
+
+// task_alloc
+// fails if enqueuing and running tasks allocates once a queue has warmed up, in any mode
+int RunTaskAllocCheck()
+{
+	auto result = 0;
+	for (const auto mode : { TaskQueue::Mode::SharedQueue, TaskQueue::Mode::WorkStealing, TaskQueue::Mode::LockFree })
+	{
+		TaskQueue queue;
+		queue.Setup(cThreadCount, mode);
+
+		const auto allocationsPerTask = MeasureTaskAllocations(&queue, 1000000, 4096);
+		printf("%s %.6f allocations/task\n", TaskQueueModeName(mode), allocationsPerTask);
+		if (allocationsPerTask > 0.0)
+		{
+			result = 1;
+		}
+	}
+	return result;
+}
+
+// task_stress
+// fails unless WaitAll() returns with every task of a 1M-task tree of nested groups run, and every Wait() on one
+// of its groups returns only once the group's tasks have finished, in every mode
+int RunTaskStress()
+{
+	auto result = 0;
+	for (const auto mode : { TaskQueue::Mode::SharedQueue, TaskQueue::Mode::WorkStealing, TaskQueue::Mode::LockFree })
+	{
+		for (const auto threadCount : { 1, cThreadCount })
+		{
+			TaskQueue queue;
+			queue.Setup(threadCount, mode);
+
+			const auto report = StressTaskQueue(&queue, 1000000, 7, 64, 4);
+			const auto isPassed =
+				report.FinishedCount == report.EnqueuedCount && report.UnfinishedGroupCount == 0 && report.OrderErrorCount == 0;
+			printf(
+				"%s threads: %d, tasks: %lld/%lld, unfinished groups: %d, finished after their wait: %lld, %8.1f ms%s\n",
+				TaskQueueModeName(mode), threadCount, report.FinishedCount, report.EnqueuedCount,
+				report.UnfinishedGroupCount, report.OrderErrorCount, report.Milliseconds, isPassed ? "" : " FAILED");
+			if (!isPassed)
+			{
+				result = 1;
+			}
+		}
+	}
+	return result;
+}
+
+// task_masks
+// fails unless Setup() rejects worker priority masks that leave a priority without a worker, and accepts
+// masks that split the priorities between workers (main.cpp gives background tasks to its last worker only)
+int RunTaskMaskCheck()
+{
+	const auto isAccepted = [](unsigned int firstMask, unsigned int secondMask)
+	{
+		auto desc = TaskQueue::DefaultDesc(2, TaskQueue::Mode::WorkStealing);
+		desc.Workers[0].PriorityMask = firstMask;
+		desc.Workers[1].PriorityMask = secondMask;
+		try
+		{
+			TaskQueue queue;
+			queue.Setup(desc);
+		}
+		catch (const std::invalid_argument&)
+		{
+			return false;
+		}
+		return true;
+	};
+
+	const auto critical = TaskPriorityBit(TaskPriority::Critical);
+	const auto background = TaskPriorityBit(TaskPriority::Background);
+
+	auto failureCount = 0;
+	failureCount += StatsExpect(isAccepted(critical, background), "one worker per priority");
+	failureCount += StatsExpect(isAccepted(cAllTaskPriorities, critical), "a worker that accepts every priority");
+	failureCount += StatsExpect(!isAccepted(critical, critical), "no worker accepts background tasks");
+	failureCount += StatsExpect(!isAccepted(background, 0U), "no worker accepts critical tasks");
+	return ReturnCode(failureCount);
+}
+
+// mpmc_stress
+// fails if a value pushed through MpmcQueue, or a task queued in LockFree mode, is lost, duplicated or
+// seen out of its producer's order, with producers and consumers on both sides of the ring, or if a producer
+// blocks on a full ring of background tasks
+int RunMpmcStress()
+{
+	const int configs[][2] = { { 1, 1 }, { 4, 4 }, { 8, 2 }, { 2, 8 } };
+
+	auto result = 0;
+	for (const auto& config : configs)
+	{
+		for (const auto capacity : { 4, 1024 })
+		{
+			const auto report = StressMpmcQueue(config[0], config[1], 200000, capacity);
+			const auto isPassed = report.MissingCount == 0 && report.DuplicateCount == 0 && report.OrderErrorCount == 0;
+			printf(
+				"mpmc producers: %d, consumers: %d, capacity: %4d, values: %lld, missing: %lld, duplicates: %lld, out of order: %lld, %8.1f ms%s\n",
+				config[0], config[1], capacity, report.PushedCount, report.MissingCount, report.DuplicateCount,
+				report.OrderErrorCount, report.Milliseconds, isPassed ? "" : " FAILED");
+			if (!isPassed)
+			{
+				result = 1;
+			}
+		}
+	}
+
+	for (const auto producerCount : { 1, 4, 8 })
+	{
+		const auto errorCount = StressLockFreeTaskQueue(cThreadCount, producerCount, 200000);
+		printf("lockfree producers: %d, consumers: %d, tasks not run once: %lld%s\n", producerCount, cThreadCount, errorCount, (errorCount == 0) ? "" : " FAILED");
+		if (errorCount != 0)
+		{
+			result = 1;
+		}
+	}
+
+	// twice the ring (8192 tasks), so the producer overflows it while the workers are held back
+	const auto backlogErrorCount = StressLockFreeBackgroundBacklog(cThreadCount, 16384);
+	printf("lockfree background backlog, tasks not run once: %lld%s\n", backlogErrorCount, (backlogErrorCount == 0) ? "" : " FAILED");
+	if (backlogErrorCount != 0)
+	{
+		result = 1;
+	}
+	return result;
+}
+
+// sincos
+// sweeps [-cSinCosMaxInput, cSinCosMaxInput] and compares SinCos() against double-precision sin/cos;
+// fails if the error exceeds cSinCosMaxError or a SIMD lane differs from the scalar result
+int RunSinCosCheck()
+{
+	const auto sampleCount = 1 << 24;
+	const auto laneCount = 8;
+
+	auto maxSinError = 0.0;
+	auto maxCosError = 0.0;
+	auto mismatchCount = 0;
+
+	const auto check = [&](const float* pAngles, const float* pSin, const float* pCos, int count)
+	{
+		for (auto i = 0; i < count; ++i)
+		{
+			float sinValue, cosValue;
+			SinCos(pAngles[i], &sinValue, &cosValue);
+			if (memcmp(&sinValue, &pSin[i], sizeof(float)) != 0 || memcmp(&cosValue, &pCos[i], sizeof(float)) != 0)
+			{
+				++mismatchCount;
+			}
+			maxSinError = std::max(maxSinError, std::abs(sinValue - std::sin(static_cast<double>(pAngles[i]))));
+			maxCosError = std::max(maxCosError, std::abs(cosValue - std::cos(static_cast<double>(pAngles[i]))));
+		}
+	};
+
+	for (auto i = 0; i < sampleCount; i += laneCount)
+	{
+		alignas(16) float angles[laneCount], sinValues[laneCount], cosValues[laneCount];
+		for (auto j = 0; j < laneCount; ++j)
+		{
+			angles[j] = cSinCosMaxInput * (2.0f * (i + j) / sampleCount - 1.0f);
+		}
+
+#if !defined(SIN_COS_SSE)
+		for (auto j = 0; j < laneCount; ++j)
+		{
+			SinCos(angles[j], &sinValues[j], &cosValues[j]);
+		}
+		check(angles, sinValues, cosValues, laneCount);
+#endif
+#if defined(SIN_COS_SSE)
+		for (auto j = 0; j < laneCount; j += 4)
+		{
+			__m128 sinValue, cosValue;
+			SinCos(_mm_load_ps(angles + j), &sinValue, &cosValue);
+			_mm_store_ps(sinValues + j, sinValue);
+			_mm_store_ps(cosValues + j, cosValue);
+		}
+		check(angles, sinValues, cosValues, laneCount);
+#endif
+	}
+
+	printf("sin: max error %.3g\n", maxSinError);
+	printf("cos: max error %.3g\n", maxCosError);
+	printf("simd lanes differing from scalar: %d\n", mismatchCount);
+
+	return (maxSinError <= cSinCosMaxError && maxCosError <= cSinCosMaxError && mismatchCount == 0) ? 0 : 1;
+}
+
+struct Check
+{
+	const char* Name;
+	int(*Run)();
+};
+
+const Check cChecks[] =
+{
+	{ "clock", RunClockCheck },
+	{ "frame_stats", RunFrameStatsCheck },
+	{ "latency_histogram", RunLatencyHistogramCheck },
+	{ "frame_stats_alloc", RunFrameStatsAllocCheck },
+	{ "gpu_query_ring", RunGpuQueryRingCheck },
+	{ "task_alloc", RunTaskAllocCheck },
+	{ "task_stress", RunTaskStress },
+	{ "task_masks", RunTaskMaskCheck },
+	{ "mpmc_stress", RunMpmcStress },
+	{ "sincos", RunSinCosCheck },
+};
+
+int RunCheck(const Check& check)
+{
+	printf("[%s]\n", check.Name);
+	const auto result = check.Run();
+	printf("[%s] %s\n", check.Name, (result == 0) ? "passed" : "FAILED");
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	auto failedCount = 0;
+	if (argc < 2)
+	{
+		for (const auto& check : cChecks)
+		{
+			failedCount += (RunCheck(check) == 0) ? 0 : 1;
+		}
+	}
+	for (auto i = 1; i < argc; ++i)
+	{
+		const auto pEnd = cChecks + sizeof(cChecks) / sizeof(cChecks[0]);
+		const auto pCheck = std::find_if(cChecks, pEnd, [argv, i](const Check& check) { return strcmp(check.Name, argv[i]) == 0; });
+		if (pCheck == pEnd)
+		{
+			printf("unknown check %s\n", argv[i]);
+			++failedCount;
+			continue;
+		}
+		failedCount += (RunCheck(*pCheck) == 0) ? 0 : 1;
+	}
+
+	if (failedCount > 0)
+	{
+		printf("%d failed\n", failedCount);
+	}
+	return (failedCount == 0) ? 0 : 1;
+}